@@ -78,6 +78,16 @@ extern "C"
     void ggkLogRegisterAlways(GGKLogReceiver receiver);
     void ggkLogRegisterTrace(GGKLogReceiver receiver);
 
+    // Starts writing every Bluetooth Management packet sent or received to `pFilename` in btsnoop format (readable with
+    // `btmon -r` or Wireshark) instead of hex dumping them to the debug log. When the file would grow past `maxFileBytes` it is
+    // moved to `<pFilename>.1` and a new file is started. A `maxFileBytes` of 0 means no limit.
+    //
+    // Returns 1 on success, otherwise 0
+    int ggkHciTraceStart(const char *pFilename, unsigned long maxFileBytes);
+
+    // Stops packet tracing started with `ggkHciTraceStart()`
+    void ggkHciTraceStop();
+
     // -----------------------------------------------------------------------------------------------------------------------------
     // SERVER DATA
     // -----------------------------------------------------------------------------------------------------------------------------
@@ -128,6 +138,11 @@ extern "C"
     // Adds a named update to the front of the queue. Generally, this routine should not be used directly. Instead, use the
     // `ggkNofifyUpdatedCharacteristic()` instead.
     //
+    // If the same object path and interface is already waiting in the queue, the update is coalesced with the pending one (which
+    // keeps its place in the queue) so that each interface is updated at most once per pass.
+    //
+    // If the object path is a characteristic that caches its ReadValue reply, the cached reply is dropped before this returns.
+    //
     // Returns non-zero value on success or 0 on failure.
     int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName);
 
@@ -155,6 +170,39 @@ extern "C"
     // Removes all entries from the queue
     void ggkUpdateQueueClear();
 
+    // Returns the total number of updates that were coalesced with an update already waiting in the queue
+    unsigned long ggkUpdateQueueCoalescedCount();
+
+    // What to do when an update is queued while the update queue is full
+    //
+    // Updates are coalesced while they wait, so the queue holds each characteristic (or object path) at most once and only fills
+    // up if the server falls far behind.
+    //
+    //     EUpdateQueueOverflowSpill - Queue the update anyway, past the queue's capacity. Nothing is lost. (Default)
+    //     EUpdateQueueOverflowDrop  - Drop the update and count it (see `ggkUpdateQueueDroppedCount()`)
+    //     EUpdateQueueOverflowBlock - Wait until the server has made room. Never use this if updates are queued from the server
+    //                                 thread itself, as that would block forever.
+    enum GGKUpdateQueueOverflowPolicy
+    {
+        EUpdateQueueOverflowSpill,
+        EUpdateQueueOverflowDrop,
+        EUpdateQueueOverflowBlock
+    };
+
+    // Sets what happens when an update is queued while the update queue is full
+    //
+    // See `GGKUpdateQueueOverflowPolicy` (enumeration) for more information.
+    void ggkSetUpdateQueueOverflowPolicy(enum GGKUpdateQueueOverflowPolicy policy);
+
+    // Returns the total number of updates that were dropped because the queue was full
+    unsigned long ggkUpdateQueueDroppedCount();
+
+    // Sets the maximum number of queued updates the server will process in a single pass of its main loop
+    //
+    // Updates beyond this budget are left on the queue and processed on the next pass, so that a flood of updates cannot starve
+    // D-Bus method calls and other main loop work. A value of 0 (or less) removes the limit. The default is 32.
+    void ggkSetUpdateQueueBudget(int maxUpdatesPerPass);
+
     // -----------------------------------------------------------------------------------------------------------------------------
     // SERVER CONTROL
     // -----------------------------------------------------------------------------------------------------------------------------
@@ -91,13 +91,13 @@ DBusObject &DBusInterface::getOwner() const
 }
 
 // Returns the path node of this interface's owner
-DBusObjectPath DBusInterface::getPathNode() const
+const DBusObjectPath &DBusInterface::getPathNode() const
 {
     return owner.getPathNode();
 }
 
 // Returns the full path of this interface's owner
-DBusObjectPath DBusInterface::getPath() const
+const DBusObjectPath &DBusInterface::getPath() const
 {
     return owner.getPath();
 }
@@ -111,10 +111,47 @@ DBusObjectPath DBusInterface::getPath() const
 // This method returns a reference to `this` in order to enable chaining inside the server description.
 DBusInterface &DBusInterface::addMethod(const std::string &name, const char *pInArgs[], const char *pOutArgs, DBusMethod::Callback callback)
 {
-    methods.push_back(DBusMethod(this, name, pInArgs, pOutArgs, callback));
+    addMethod(DBusMethod(this, name, pInArgs, pOutArgs, callback));
     return *this;
 }
 
+// Adds a method to this interface and its dispatch tables
+//
+// As with a search of the method list, the first method added with a given name is the one that is found.
+void DBusInterface::addMethod(DBusMethod &&method)
+{
+    methods.push_back(std::move(method));
+    const DBusMethod *pMethod = &methods.back();
+
+    DBusMethod::WellKnownId id = DBusMethod::getWellKnownId(pMethod->getName());
+    if (id != DBusMethod::ECustom)
+    {
+        if (nullptr == wellKnownMethods[id])
+        {
+            wellKnownMethods[id] = pMethod;
+        }
+    }
+    else
+    {
+        customMethods.emplace(pMethod->getName(), pMethod);
+    }
+}
+
+// Finds a method by name within this interface
+//
+// Returns nullptr if the method is not found
+const DBusMethod *DBusInterface::findMethod(const std::string &methodName) const
+{
+    DBusMethod::WellKnownId id = DBusMethod::getWellKnownId(methodName);
+    if (id != DBusMethod::ECustom)
+    {
+        return wellKnownMethods[id];
+    }
+
+    auto it = customMethods.find(methodName);
+    return it == customMethods.end() ? nullptr : it->second;
+}
+
 // Calls a named method on this interface
 //
 // This method returns false if the method could not be found, otherwise it returns true. Note that the return value is not related
@@ -124,16 +161,14 @@ DBusInterface &DBusInterface::addMethod(const std::string &name, const char *pIn
 // their subclass type.
 bool DBusInterface::callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-    for (const DBusMethod &method : methods)
+    const DBusMethod *pMethod = findMethod(methodName);
+    if (nullptr == pMethod)
     {
-        if (methodName == method.getName())
-        {
-            method.call<DBusInterface>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
-            return true;
-        }
+        return false;
     }
 
-    return false;
+    pMethod->call<DBusInterface>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
+    return true;
 }
 
 // Add an event to this interface
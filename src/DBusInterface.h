@@ -25,6 +25,7 @@
 #include <gio/gio.h>
 #include <string>
 #include <list>
+#include <unordered_map>
 
 #include "TickEvent.h"
 #include "DBusMethod.h"
@@ -80,6 +81,10 @@ struct DBusInterface
     DBusInterface(DBusObject &owner, const std::string &name);
     virtual ~DBusInterface();
 
+    // Our dispatch tables point into `methods`, so a copy would dispatch to the original's methods
+    DBusInterface(DBusInterface const&) = delete;
+    void operator=(DBusInterface const&) = delete;
+
     // Returns a string identifying the type of interface
     virtual const std::string getInterfaceType() const { return DBusInterface::kInterfaceType; }
 
@@ -95,8 +100,8 @@ struct DBusInterface
     //
 
     DBusObject &getOwner() const;
-    DBusObjectPath getPathNode() const;
-    DBusObjectPath getPath() const;
+    const DBusObjectPath &getPathNode() const;
+    const DBusObjectPath &getPath() const;
 
     //
     // D-Bus interface methods
@@ -104,6 +109,11 @@ struct DBusInterface
 
     DBusInterface &addMethod(const std::string &name, const char *pInArgs[], const char *pOutArgs, DBusMethod::Callback callback);
 
+    // Finds a method by name within this interface
+    //
+    // Returns nullptr if the method is not found
+    const DBusMethod *findMethod(const std::string &methodName) const;
+
     // NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
     // their subclass type.
     virtual bool callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
@@ -125,10 +135,18 @@ struct DBusInterface
     virtual std::string generateIntrospectionXML(int depth) const;
 
 protected:
+    // Adds a method to this interface and its dispatch tables
+    void addMethod(DBusMethod &&method);
+
     DBusObject &owner;
     std::string name;
     std::list<DBusMethod> methods;
     std::list<TickEvent> events;
+
+private:
+    // Dispatch tables for our methods: well-known GATT methods by ID, all others by name
+    const DBusMethod *wellKnownMethods[DBusMethod::EWellKnownCount] = {};
+    std::unordered_map<std::string, const DBusMethod *> customMethods;
 };
 
 }; // namespace ggk
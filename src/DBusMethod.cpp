@@ -48,6 +48,35 @@ DBusMethod::DBusMethod(const DBusInterface *pOwner, const std::string &name, con
     }
 }
 
+// Returns the well-known ID for a method name, or `ECustom` if it isn't one of the well-known GATT methods
+//
+// The well-known names all differ in length, except for WriteValue and StopNotify, so we switch on the length and need at most
+// one full comparison.
+DBusMethod::WellKnownId DBusMethod::getWellKnownId(const std::string &name)
+{
+    switch (name.length())
+    {
+        case 9:
+            if (name == "ReadValue") { return EReadValue; }
+            break;
+        case 10:
+            if (name[0] == 'W' && name == "WriteValue") { return EWriteValue; }
+            if (name[0] == 'S' && name == "StopNotify") { return EStopNotify; }
+            break;
+        case 11:
+            if (name == "StartNotify") { return EStartNotify; }
+            break;
+        case 12:
+            if (name == "AcquireWrite") { return EAcquireWrite; }
+            break;
+        case 13:
+            if (name == "AcquireNotify") { return EAcquireNotify; }
+            break;
+    }
+
+    return ECustom;
+}
+
 // Internal method used to generate introspection XML used to describe our services on D-Bus
 std::string DBusMethod::generateIntrospectionXML(int depth) const
 {
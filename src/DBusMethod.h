@@ -43,6 +43,25 @@ struct DBusInterface;
 
 struct DBusMethod
 {
+    // The well-known GATT methods
+    //
+    // These are dispatched through a table indexed by this ID rather than by comparing names (see `DBusInterface::findMethod()`.)
+    // All other methods are `ECustom`.
+    enum WellKnownId
+    {
+        EReadValue,
+        EWriteValue,
+        EStartNotify,
+        EStopNotify,
+        EAcquireWrite,
+        EAcquireNotify,
+        EWellKnownCount,
+        ECustom = EWellKnownCount
+    };
+
+    // Returns the well-known ID for a method name, or `ECustom` if it isn't one of the well-known GATT methods
+    static WellKnownId getWellKnownId(const std::string &name);
+
     // A method callback delegate
     typedef void (*Callback)(const DBusInterface &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
 
@@ -104,7 +123,7 @@ struct DBusMethod
             return;
         }
 
-        Logger::info(SSTR << "Calling method: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
+        GGK_INFO("Calling method: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
         callback(*static_cast<const T *>(pOwner), pConnection, methodName, pParameters, pInvocation, pUserData);
     }
 
@@ -52,15 +52,17 @@ namespace ggk {
 //
 // We'll include a publish flag since only root objects can be published
 DBusObject::DBusObject(const DBusObjectPath &path, bool publish)
-: publish(publish), path(path), pParent(nullptr)
+: publish(publish), path(path), fullPath(path), pParent(nullptr)
 {
 }
 
 // Construct a node object
 //
 // Nodes inherit their parent's publish path
+//
+// The server description never changes once a node is attached, so the full path is computed once, here.
 DBusObject::DBusObject(DBusObject *pParent, const DBusObjectPath &pathElement)
-: publish(pParent->publish), path(pathElement), pParent(pParent)
+: publish(pParent->publish), path(pathElement), fullPath(pParent->getPath() + pathElement), pParent(pParent)
 {
 }
 
@@ -85,19 +87,9 @@ const DBusObjectPath &DBusObject::getPathNode() const
 // Returns the full path for this object within the hierarchy
 //
 // This method returns the full path. To get the current node, use `getPathNode()`
-DBusObjectPath DBusObject::getPath() const
+const DBusObjectPath &DBusObject::getPath() const
 {
-    DBusObjectPath path = getPathNode();
-    const DBusObject *pCurrent = pParent;
-
-    // Traverse up my chain, adding nodes to the path until we have the full thing
-    while(nullptr != pCurrent)
-    {
-        path = pCurrent->getPathNode() + path;
-        pCurrent = pCurrent->pParent;
-    }
-
-    return path;
+    return fullPath;
 }
 
 // Returns the parent object in the hierarchy
@@ -142,9 +134,9 @@ GattService &DBusObject::gattServiceBegin(const std::string &pathElement, const
 //
 
 // Finds an interface by name within this D-Bus object
-std::shared_ptr<const DBusInterface> DBusObject::findInterface(const DBusObjectPath &path, const std::string &interfaceName, const DBusObjectPath &basePath) const
+std::shared_ptr<const DBusInterface> DBusObject::findInterface(const DBusObjectPath &path, const std::string &interfaceName) const
 {
-    if ((basePath + getPathNode()) == path)
+    if (getPath() == path)
     {
         for (std::shared_ptr<const DBusInterface> interface : interfaces)
         {
@@ -157,7 +149,7 @@ std::shared_ptr<const DBusInterface> DBusObject::findInterface(const DBusObjectP
 
     for (const DBusObject &child : getChildren())
     {
-        std::shared_ptr<const DBusInterface> pInterface = child.findInterface(path, interfaceName, basePath + getPathNode());
+        std::shared_ptr<const DBusInterface> pInterface = child.findInterface(path, interfaceName);
         if (nullptr != pInterface)
         {
             return pInterface;
@@ -168,9 +160,9 @@ std::shared_ptr<const DBusInterface> DBusObject::findInterface(const DBusObjectP
 }
 
 // Finds a BlueZ method by name within the specified D-Bus interface
-bool DBusObject::callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData, const DBusObjectPath &basePath) const
+bool DBusObject::callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-    if ((basePath + getPathNode()) == path)
+    if (getPath() == path)
     {
         for (std::shared_ptr<const DBusInterface> interface : interfaces)
         {
@@ -186,7 +178,7 @@ bool DBusObject::callMethod(const DBusObjectPath &path, const std::string &inter
 
     for (const DBusObject &child : getChildren())
     {
-        if (child.callMethod(path, interfaceName, methodName, pConnection, pParameters, pInvocation, pUserData, basePath + getPathNode()))
+        if (child.callMethod(path, interfaceName, methodName, pConnection, pParameters, pInvocation, pUserData))
         {
             return true;
         }
@@ -235,7 +227,7 @@ std::string DBusObject::generateIntrospectionXML(int depth) const
         xml += interface->generateIntrospectionXML(depth + 1);
     }
 
-    for (DBusObject child : getChildren())
+    for (const DBusObject &child : getChildren())
     {
         xml += child.generateIntrospectionXML(depth + 1);
     }
@@ -66,7 +66,7 @@ struct DBusObject
     // Returns the full path for this object within the hierarchy
     //
     // This method returns the full path. To get the current node, use `getPathNode()`
-    DBusObjectPath getPath() const;
+    const DBusObjectPath &getPath() const;
 
     // Returns the parent object in the hierarchy
     DBusObject &getParent();
@@ -103,10 +103,10 @@ struct DBusObject
     //
 
     // Finds an interface by name within this D-Bus object
-    std::shared_ptr<const DBusInterface> findInterface(const DBusObjectPath &path, const std::string &interfaceName, const DBusObjectPath &basePath = DBusObjectPath()) const;
+    std::shared_ptr<const DBusInterface> findInterface(const DBusObjectPath &path, const std::string &interfaceName) const;
 
     // Finds a BlueZ method by name within the specified D-Bus interface
-    bool callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData, const DBusObjectPath &basePath = DBusObjectPath()) const;
+    bool callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
 
     // Periodic timer tick propagation
     void tickEvents(GDBusConnection *pConnection, void *pUserData = nullptr) const;
@@ -121,6 +121,7 @@ struct DBusObject
 private:
     bool publish;
     DBusObjectPath path;
+    DBusObjectPath fullPath;
     InterfaceList interfaces;
     std::list<DBusObject> children;
     DBusObject *pParent;
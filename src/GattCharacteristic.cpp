@@ -20,8 +20,30 @@
 // A GATT characteristic is the component within the Bluetooth LE standard that holds and serves data over Bluetooth. This class
 // is intended to be used within the server description. For an explanation of how this class is used, see the detailed discussion
 // in Server.cpp.
+//
+// Handlers registered with `onReadValueAsync()`/`onWriteValueAsync()` don't run on the main loop. The method call is handed to
+// the worker pool (see WorkerPool.cpp) along with a reference to its parameters, the handler runs on a worker thread, and its
+// result is handed back to the main loop (with `g_main_context_invoke()`) where the method call is completed. Each characteristic
+// limits how many of these calls it has in progress; calls beyond the limit are refused rather than queued.
+//
+// A characteristic may also cache its ReadValue reply (see `cacheFor()`.) The reply tuple is kept by reference as it is sent and
+// re-sent as-is while it is fresh. Updates bump an atomic generation counter rather than touching the cache itself, so they can
+// come from any thread; a reply is only cached if the generation hasn't moved since its ReadValue call arrived.
+//
+// Values longer than the ATT MTU are read in pieces, with BlueZ passing the offset of each piece in the ReadValue options. The
+// onReadValue callbacks know nothing of this, so the framework handles it: the reply to a read at offset 0 is kept as a snapshot
+// for that peer and characteristic, and later offsets are answered with slices of it (sharing its bytes.) The snapshot is
+// released once its last piece is sent, when the peer starts another read, or when it disconnects. When BlueZ doesn't name the
+// peer, the characteristic has one snapshot for every peer, which is replaced by the next read at offset 0.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+
 #include "GattCharacteristic.h"
 #include "GattDescriptor.h"
 #include "GattProperty.h"
@@ -30,9 +52,115 @@
 #include "GattService.h"
 #include "Utils.h"
 #include "Logger.h"
+#include "WorkerPool.h"
 
 namespace ggk {
 
+// An async handler call on its way through the worker pool
+struct GattCharacteristic::AsyncCall
+{
+    const GattCharacteristic *pCharacteristic;
+    bool isRead;
+    GVariant *pParameters;
+    GDBusMethodInvocation *pInvocation;
+    void *pUserData;
+
+    // The read cache generation when the call was made (see `readCacheCallGeneration`)
+    unsigned int readCacheGeneration;
+
+    // The handler's result
+    GVariant *pValue;
+    bool succeeded;
+
+    // The idle source that completes the call on the main loop, once the handler has returned
+    GSource *pCompletion;
+};
+
+// Async calls whose handler has returned but whose completion hasn't run on the main loop yet
+//
+// If the main loop stops first, `cancelAsyncCalls()` answers these rather than leaving them to a loop that will never run them
+static std::mutex asyncCompletionMutex;
+static std::set<GattCharacteristic::AsyncCall *> asyncCompletions;
+
+// Values being read in pieces (long reads), by peer device name and characteristic
+//
+// Each is the whole "(ay)" reply taken when the peer read at offset 0. Reads at later offsets are served from it, so the value
+// can't change (or be rebuilt) part way through.
+static std::mutex longReadMutex;
+static std::map<std::pair<std::string, const GattCharacteristic *>, GVariant *> longReadSnapshots;
+
+// The most an ATT read response can carry on a link using the default ATT MTU (23 bytes, less the opcode)
+//
+// Every link's MTU is at least this, so a value no longer than this is always read in one piece
+static const gsize kDefaultAttPayload = 22;
+
+// Keeps a peer's snapshot of a characteristic's value, replacing any previous one
+static void storeLongReadSnapshot(const std::string &device, const GattCharacteristic *pCharacteristic, GVariant *pReply)
+{
+    GVariant *pSnapshot = g_variant_ref_sink(pReply);
+
+    std::lock_guard<std::mutex> lock(longReadMutex);
+
+    GVariant *&pEntry = longReadSnapshots[std::make_pair(device, pCharacteristic)];
+    if (nullptr != pEntry)
+    {
+        g_variant_unref(pEntry);
+    }
+    pEntry = pSnapshot;
+}
+
+// Returns a new reference to a peer's snapshot of a characteristic's value, or nullptr if it has none
+static GVariant *findLongReadSnapshot(const std::string &device, const GattCharacteristic *pCharacteristic)
+{
+    std::lock_guard<std::mutex> lock(longReadMutex);
+
+    auto it = longReadSnapshots.find(std::make_pair(device, pCharacteristic));
+    return it != longReadSnapshots.end() ? g_variant_ref(it->second) : nullptr;
+}
+
+// Releases a peer's snapshot of a characteristic's value
+static void releaseLongReadSnapshot(const std::string &device, const GattCharacteristic *pCharacteristic)
+{
+    std::lock_guard<std::mutex> lock(longReadMutex);
+
+    auto it = longReadSnapshots.find(std::make_pair(device, pCharacteristic));
+    if (it != longReadSnapshots.end())
+    {
+        g_variant_unref(it->second);
+        longReadSnapshots.erase(it);
+    }
+}
+
+// Reads the options of a ReadValue call
+GattCharacteristic::ReadOptions GattCharacteristic::getReadOptions(GVariant *pParameters)
+{
+    ReadOptions options;
+    options.offset = 0;
+    options.mtu = 0;
+
+    if (nullptr == pParameters || g_variant_n_children(pParameters) == 0)
+    {
+        return options;
+    }
+
+    GVariant *pOptions = g_variant_get_child_value(pParameters, 0);
+    if (g_variant_is_of_type(pOptions, G_VARIANT_TYPE_VARDICT))
+    {
+        g_variant_lookup(pOptions, "offset", "q", &options.offset);
+        g_variant_lookup(pOptions, "mtu", "q", &options.mtu);
+
+        const gchar *pDevicePath = nullptr;
+        if (g_variant_lookup(pOptions, "device", "&o", &pDevicePath))
+        {
+            const gchar *pName = strrchr(pDevicePath, '/');
+            options.device = nullptr != pName ? pName + 1 : pDevicePath;
+        }
+    }
+    g_variant_unref(pOptions);
+
+    return options;
+}
+
 //
 // Standard constructor
 //
@@ -42,10 +170,20 @@ namespace ggk {
 // Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
 // in `GattService`.
 GattCharacteristic::GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name)
-: GattInterface(owner, name), service(service), pOnUpdatedValueFunc(nullptr)
+: GattInterface(owner, name), service(service), pOnUpdatedValueFunc(nullptr), pOnReadValueAsyncFunc(nullptr),
+  pOnWriteValueAsyncFunc(nullptr), asyncConcurrencyLimit(kDefaultAsyncConcurrency), asyncCallsInProgress(0), updateQueued(false),
+  readCacheTTL(0), pReadCache(nullptr), readCacheStoredGeneration(0), readCacheCallGeneration(0), readCacheGeneration(0)
 {
 }
 
+GattCharacteristic::~GattCharacteristic()
+{
+    if (nullptr != pReadCache)
+    {
+        g_variant_unref(pReadCache);
+    }
+}
+
 // Returning the owner pops us one level up the hierarchy
 //
 // This method compliments `GattService::gattCharacteristicBegin()`
@@ -63,29 +201,61 @@ GattService &GattCharacteristic::gattCharacteristicEnd()
 // This method returns a reference to `this` in order to enable chaining inside the server description.
 GattCharacteristic &GattCharacteristic::addMethod(const std::string &name, const char *pInArgs[], const char *pOutArgs, DBusMethod::Callback callback, bool needAuth)
 {
-    methods.push_back(DBusMethod(this, name, pInArgs, pOutArgs, callback, needAuth));
+    DBusInterface::addMethod(DBusMethod(this, name, pInArgs, pOutArgs, callback, needAuth));
     return *this;
 }
 
 // Locates a D-Bus method within this D-Bus interface and invokes the method
 bool GattCharacteristic::callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-    for (const DBusMethod &method : methods)
+    const DBusMethod *pMethod = findMethod(methodName);
+    if (nullptr == pMethod)
     {
-        if (methodName == method.getName())
-        {
+        return false;
+    }
+
 #ifdef V_GATT_SERVER_AUTH_y
-            if (method.getNeedAuth() == true && !ggkGetServerAuthState()) {
-                g_dbus_method_invocation_return_error(pInvocation, G_DBUS_ERROR, G_DBUS_ERROR_AUTH_FAILED, "Auth Fail");
-                return true;
-            }
+    if (pMethod->getNeedAuth() == true && !ggkGetServerAuthState()) {
+        g_dbus_method_invocation_return_error(pInvocation, G_DBUS_ERROR, G_DBUS_ERROR_AUTH_FAILED, "Auth Fail");
+        return true;
+    }
 #endif
-            method.call<GattCharacteristic>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
+
+    DBusMethod::WellKnownId methodId = DBusMethod::getWellKnownId(methodName);
+    if (methodId == DBusMethod::EReadValue)
+    {
+        // Continue a long read from the snapshot taken when the peer started reading
+        ReadOptions options = getReadOptions(pParameters);
+        if (options.offset != 0 && continueLongRead(options, pInvocation))
+        {
             return true;
         }
+
+        if (readCacheTTL.count() != 0)
+        {
+            unsigned int generation = readCacheGeneration.load(std::memory_order_acquire);
+            if (nullptr != pReadCache && readCacheStoredGeneration == generation && std::chrono::steady_clock::now() < readCacheExpiry)
+            {
+                GGK_DEBUG("Serving cached ReadValue for interface at path '" << getPath() << "'");
+                methodReturnVariant(pInvocation, pReadCache);
+                return true;
+            }
+
+            if (nullptr != pReadCache)
+            {
+                g_variant_unref(pReadCache);
+                pReadCache = nullptr;
+            }
+            readCacheCallGeneration = generation;
+        }
+    }
+    else if (methodId == DBusMethod::EWriteValue && readCacheTTL.count() != 0)
+    {
+        invalidateReadCache();
     }
 
-    return false;
+    pMethod->call<GattCharacteristic>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
+    return true;
 }
 
 // Adds an event to the characteristic and returns a refereence to 'this` to enable method chaining in the server description
@@ -145,6 +315,311 @@ GattCharacteristic &GattCharacteristic::onWriteValue(MethodCallback callback, bo
     return *this;
 }
 
+// Asynchronous form of `onReadValue()` for handlers that may block
+//
+// The callback runs on a worker thread (see WorkerPool.cpp) rather than the main loop, so it must not touch the D-Bus
+// connection or anything else owned by the main loop. It returns the value to send (for example, from
+// `Utils::gvariantFromByteArray()`), or nullptr to fail the call. The method call is completed back on the main loop.
+//
+// needAuth: need Authentication to access callback (default: true)
+GattCharacteristic &GattCharacteristic::onReadValueAsync(AsyncReadCallback callback, bool needAuth /*=true*/)
+{
+    pOnReadValueAsyncFunc = callback;
+    return onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+    {
+        self.dispatchAsync(true, pParameters, pInvocation, pUserData);
+    }, needAuth);
+}
+
+// Asynchronous form of `onWriteValue()` for handlers that may block
+//
+// The callback runs on a worker thread, as with `onReadValueAsync()`. It returns true on success, or false to fail the call.
+//
+// needAuth: need Authentication to access callback (default: true)
+GattCharacteristic &GattCharacteristic::onWriteValueAsync(AsyncWriteCallback callback, bool needAuth /*=true*/)
+{
+    pOnWriteValueAsyncFunc = callback;
+    return onWriteValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+    {
+        self.dispatchAsync(false, pParameters, pInvocation, pUserData);
+    }, needAuth);
+}
+
+// Sets the number of async handler calls that may be in progress at once on this characteristic (reads and writes together)
+//
+// Calls beyond this limit fail immediately with org.bluez.Error.InProgress. The default is `kDefaultAsyncConcurrency`.
+GattCharacteristic &GattCharacteristic::asyncConcurrency(int maxCalls)
+{
+    asyncConcurrencyLimit = maxCalls > 0 ? maxCalls : 1;
+    return *this;
+}
+
+// Caches the reply to ReadValue for `ms` milliseconds
+//
+// While the cached reply is fresh, ReadValue is answered with it directly and the onReadValue callback isn't called. The cache
+// is dropped early when the characteristic's value is updated (`ggkNofifyUpdatedCharacteristic()`, `pushUpdateQueue()` or
+// `callOnUpdatedValue()`) and whenever the client writes to the characteristic. Use this for values that are expensive to build
+// but change rarely.
+GattCharacteristic &GattCharacteristic::cacheFor(int ms)
+{
+    readCacheTTL = std::chrono::milliseconds(ms > 0 ? ms : 0);
+    return *this;
+}
+
+// Keeps the reply to a ReadValue call (for the read cache and long reads) and trims it to the offset the peer asked for
+GVariant *GattCharacteristic::onMethodReturn(GDBusMethodInvocation *pInvocation, GVariant *pReply) const
+{
+    if (strcmp(g_dbus_method_invocation_get_method_name(pInvocation), "ReadValue") != 0 || !g_variant_is_of_type(pReply, G_VARIANT_TYPE("(ay)")))
+    {
+        return pReply;
+    }
+
+    ReadOptions options = getReadOptions(g_dbus_method_invocation_get_parameters(pInvocation));
+
+    // Only whole values are cached, and not if the value was updated while this reply was being built
+    if (readCacheTTL.count() != 0 && pReply != pReadCache && options.offset == 0
+        && readCacheGeneration.load(std::memory_order_acquire) == readCacheCallGeneration)
+    {
+        if (nullptr != pReadCache)
+        {
+            g_variant_unref(pReadCache);
+        }
+
+        pReadCache = g_variant_ref_sink(pReply);
+        readCacheStoredGeneration = readCacheCallGeneration;
+        readCacheExpiry = std::chrono::steady_clock::now() + readCacheTTL;
+    }
+
+    GVariant *pValue = g_variant_get_child_value(pReply, 0);
+    gsize valueSize = g_variant_get_size(pValue);
+
+    // An ATT read (or read blob) response carries up to MTU-1 bytes. Without the MTU, only the default MTU's payload is certain
+    // to fit, so a longer value is kept even if the peer reads it in one piece (until it starts another read or disconnects.)
+    gsize chunkSize = options.mtu > 1 ? options.mtu - 1 : kDefaultAttPayload;
+
+    if (options.offset == 0)
+    {
+        if (valueSize <= chunkSize)
+        {
+            releaseLongReadSnapshot(options.device, this);
+        }
+        else
+        {
+            storeLongReadSnapshot(options.device, this, pReply);
+        }
+
+        g_variant_unref(pValue);
+        return pReply;
+    }
+
+    // Reply with the rest of the value from the offset, sharing its bytes
+    gsize offset = std::min(static_cast<gsize>(options.offset), valueSize);
+    const guint8 *pData = static_cast<const guint8 *>(g_variant_get_data(pValue));
+    GVariant *pSlice = g_variant_new_from_data(G_VARIANT_TYPE_BYTESTRING, pData + offset, valueSize - offset, TRUE,
+        reinterpret_cast<GDestroyNotify>(g_variant_unref), g_variant_ref(pValue));
+    GVariant *pSliceReply = g_variant_new_tuple(&pSlice, 1);
+
+    if (valueSize - offset <= chunkSize)
+    {
+        releaseLongReadSnapshot(options.device, this);
+    }
+
+    g_variant_unref(pValue);
+    g_variant_unref(g_variant_ref_sink(pReply));
+    return pSliceReply;
+}
+
+// Answers a ReadValue call at a non-zero offset from the peer's snapshot of the value, if it has one
+//
+// Returns true if the call was answered, otherwise false (the value is then read as usual and trimmed to the offset)
+bool GattCharacteristic::continueLongRead(const ReadOptions &options, GDBusMethodInvocation *pInvocation) const
+{
+    GVariant *pSnapshot = findLongReadSnapshot(options.device, this);
+    if (nullptr == pSnapshot)
+    {
+        return false;
+    }
+
+    GVariant *pValue = g_variant_get_child_value(pSnapshot, 0);
+    gsize valueSize = g_variant_get_size(pValue);
+    g_variant_unref(pValue);
+
+    if (options.offset > valueSize)
+    {
+        releaseLongReadSnapshot(options.device, this);
+        g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InvalidOffset", "Invalid offset");
+    }
+    else
+    {
+        GGK_DEBUG("Continuing long read at offset " << options.offset << " for interface at path '" << getPath() << "'");
+        methodReturnVariant(pInvocation, pSnapshot);
+    }
+
+    g_variant_unref(pSnapshot);
+    return true;
+}
+
+// Releases the long read snapshots held for a peer, when it disconnects
+//
+// This is safe to call from any thread
+void GattCharacteristic::releaseLongReadSnapshots(const uint8_t address[6])
+{
+    char device[22];
+    snprintf(device, sizeof(device), "dev_%02X_%02X_%02X_%02X_%02X_%02X", address[5], address[4], address[3], address[2], address[1],
+        address[0]);
+
+    std::lock_guard<std::mutex> lock(longReadMutex);
+
+    for (auto it = longReadSnapshots.begin(); it != longReadSnapshots.end(); )
+    {
+        // Snapshots without a device name aren't released here; they're replaced by the next read at offset 0
+        if (it->first.first == device)
+        {
+            g_variant_unref(it->second);
+            it = longReadSnapshots.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+// Runs an async handler on the worker pool, or fails the method call if this characteristic or the pool is too busy
+void GattCharacteristic::dispatchAsync(bool isRead, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData) const
+{
+    if (asyncCallsInProgress.fetch_add(1, std::memory_order_acq_rel) >= asyncConcurrencyLimit)
+    {
+        asyncCallsInProgress.fetch_sub(1, std::memory_order_acq_rel);
+        GGK_DEBUG("Refusing async call at path '" << getPath() << "': " << asyncConcurrencyLimit << " call(s) already in progress");
+        g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InProgress", "Operation already in progress");
+        return;
+    }
+
+    AsyncCall *pCall = new AsyncCall;
+    pCall->pCharacteristic = this;
+    pCall->isRead = isRead;
+    pCall->pParameters = g_variant_ref(pParameters);
+    pCall->pInvocation = pInvocation;
+    pCall->pUserData = pUserData;
+    pCall->readCacheGeneration = readCacheCallGeneration;
+    pCall->pValue = nullptr;
+    pCall->succeeded = false;
+    pCall->pCompletion = nullptr;
+
+    if (!WorkerPool::getInstance().submit([pCall]() { runAsyncCall(pCall); }, [pCall]() { cancelAsyncCall(pCall); }))
+    {
+        asyncCallsInProgress.fetch_sub(1, std::memory_order_acq_rel);
+        g_variant_unref(pCall->pParameters);
+        delete pCall;
+        g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.InProgress", "Server busy");
+    }
+}
+
+// Runs an async handler (on a worker thread) and hands its result back to the main loop
+void GattCharacteristic::runAsyncCall(AsyncCall *pCall)
+{
+    const GattCharacteristic &self = *pCall->pCharacteristic;
+
+    if (pCall->isRead)
+    {
+        GVariant *pValue = self.pOnReadValueAsyncFunc(self, pCall->pParameters, pCall->pUserData);
+        pCall->pValue = pValue != nullptr ? g_variant_ref_sink(pValue) : nullptr;
+        pCall->succeeded = pValue != nullptr;
+    }
+    else
+    {
+        pCall->succeeded = self.pOnWriteValueAsyncFunc(self, pCall->pParameters, pCall->pUserData);
+    }
+
+    GSource *pSource = g_idle_source_new();
+    g_source_set_callback(pSource, completeAsyncCall, pCall, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(asyncCompletionMutex);
+        pCall->pCompletion = pSource;
+        asyncCompletions.insert(pCall);
+    }
+    g_source_attach(pSource, nullptr);
+}
+
+// Completes an async handler's method call (on the main loop)
+gboolean GattCharacteristic::completeAsyncCall(gpointer pData)
+{
+    AsyncCall *pCall = static_cast<AsyncCall *>(pData);
+    const GattCharacteristic &self = *pCall->pCharacteristic;
+
+    {
+        std::lock_guard<std::mutex> lock(asyncCompletionMutex);
+        asyncCompletions.erase(pCall);
+    }
+    g_source_unref(pCall->pCompletion);
+
+    if (!pCall->succeeded)
+    {
+        g_dbus_method_invocation_return_error(pCall->pInvocation, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+            pCall->isRead ? "Read Error" : "Write Error");
+    }
+    else if (pCall->isRead)
+    {
+        // Other calls may have started since this one did; cache this reply only if it is still current for this call
+        self.readCacheCallGeneration = pCall->readCacheGeneration;
+        self.methodReturnVariant(pCall->pInvocation, pCall->pValue, true);
+    }
+    else
+    {
+        self.methodReturnVariant(pCall->pInvocation, nullptr);
+    }
+
+    releaseAsyncCall(pCall);
+    return G_SOURCE_REMOVE;
+}
+
+// Fails an async handler's method call that will never be completed, because the server is stopping
+//
+// This is called for calls still queued when the worker pool stops, and (through `cancelAsyncCalls()`) for calls whose
+// completion was still waiting for the main loop when it stopped.
+void GattCharacteristic::cancelAsyncCall(AsyncCall *pCall)
+{
+    g_dbus_method_invocation_return_dbus_error(pCall->pInvocation, "org.bluez.Error.Failed", "Server stopping");
+    releaseAsyncCall(pCall);
+}
+
+// Releases everything an async handler call holds, once its method call has been answered
+void GattCharacteristic::releaseAsyncCall(AsyncCall *pCall)
+{
+    if (nullptr != pCall->pValue)
+    {
+        g_variant_unref(pCall->pValue);
+    }
+    g_variant_unref(pCall->pParameters);
+    pCall->pCharacteristic->asyncCallsInProgress.fetch_sub(1, std::memory_order_acq_rel);
+    delete pCall;
+}
+
+// Fails the method calls of async handlers that have returned but whose completion hasn't run, once the main loop has stopped
+//
+// The worker pool must be stopped first, so that no more completions are posted.
+void GattCharacteristic::cancelAsyncCalls()
+{
+    std::set<AsyncCall *> calls;
+    {
+        std::lock_guard<std::mutex> lock(asyncCompletionMutex);
+        calls.swap(asyncCompletions);
+    }
+
+    if (!calls.empty())
+    {
+        Logger::warn(SSTR << "Cancelling " << calls.size() << " uncompleted async call(s)");
+    }
+
+    for (AsyncCall *pCall : calls)
+    {
+        g_source_destroy(pCall->pCompletion);
+        g_source_unref(pCall->pCompletion);
+        cancelAsyncCall(pCall);
+    }
+}
+
 // Custom support for handling updates to our characteristic's value
 //
 // Defined as: (NOT defined by Bluetooth or BlueZ - this method is internal only)
@@ -180,12 +655,14 @@ GattCharacteristic &GattCharacteristic::onUpdatedValue(UpdatedValueCallback call
 //      })
 bool GattCharacteristic::callOnUpdatedValue(GDBusConnection *pConnection, void *pUserData) const
 {
+    invalidateReadCache();
+
     if (nullptr == pOnUpdatedValueFunc)
     {
         return false;
     }
 
-    Logger::debug(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
+    GGK_DEBUG("Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
     return pOnUpdatedValueFunc(*this, pConnection, pUserData);
 }
 
@@ -26,6 +26,8 @@
 #include <gio/gio.h>
 #include <string>
 #include <list>
+#include <atomic>
+#include <chrono>
 
 #include "Utils.h"
 #include "TickEvent.h"
@@ -74,6 +76,20 @@ struct DBusObject;
        void *pUserData \
 )
 
+#define CHARACTERISTIC_ASYNC_READ_CALLBACK_LAMBDA [] \
+( \
+       const GattCharacteristic &self, \
+       GVariant *pParameters, \
+       void *pUserData \
+) -> GVariant *
+
+#define CHARACTERISTIC_ASYNC_WRITE_CALLBACK_LAMBDA [] \
+( \
+       const GattCharacteristic &self, \
+       GVariant *pParameters, \
+       void *pUserData \
+) -> bool
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Representation of a Bluetooth GATT Characteristic
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -86,13 +102,18 @@ struct GattCharacteristic : GattInterface
     typedef void (*MethodCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
     typedef void (*EventCallback)(const GattCharacteristic &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
     typedef bool (*UpdatedValueCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, void *pUserData);
+    typedef GVariant *(*AsyncReadCallback)(const GattCharacteristic &self, GVariant *pParameters, void *pUserData);
+    typedef bool (*AsyncWriteCallback)(const GattCharacteristic &self, GVariant *pParameters, void *pUserData);
+
+    // The default number of async handler calls (see `onReadValueAsync()`) that may be in progress at once on a characteristic
+    static const int kDefaultAsyncConcurrency = 1;
 
     // Construct a GattCharacteristic
     //
     // Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
     // in `GattService`.
     GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name);
-    virtual ~GattCharacteristic() {}
+    virtual ~GattCharacteristic();
 
     // Returns a string identifying the type of interface
     virtual const std::string getInterfaceType() const { return GattCharacteristic::kInterfaceType; }
@@ -143,6 +164,57 @@ struct GattCharacteristic : GattInterface
     //     Output args: void
     GattCharacteristic &onWriteValue(MethodCallback callback, bool needAuth = true);
 
+    // Asynchronous form of `onReadValue()` for handlers that may block
+    //
+    // The callback runs on a worker thread (see WorkerPool.cpp) rather than the main loop, so it must not touch the D-Bus
+    // connection or anything else owned by the main loop. It returns the value to send (for example, from
+    // `Utils::gvariantFromByteArray()`), or nullptr to fail the call. The method call is completed back on the main loop.
+    //
+    // needAuth: need Authentication to access callback (default: true)
+    GattCharacteristic &onReadValueAsync(AsyncReadCallback callback, bool needAuth = true);
+
+    // Asynchronous form of `onWriteValue()` for handlers that may block
+    //
+    // The callback runs on a worker thread, as with `onReadValueAsync()`. It returns true on success, or false to fail the call.
+    //
+    // needAuth: need Authentication to access callback (default: true)
+    GattCharacteristic &onWriteValueAsync(AsyncWriteCallback callback, bool needAuth = true);
+
+    // Sets the number of async handler calls that may be in progress at once on this characteristic (reads and writes together)
+    //
+    // Calls beyond this limit fail immediately with org.bluez.Error.InProgress. The default is `kDefaultAsyncConcurrency`.
+    GattCharacteristic &asyncConcurrency(int maxCalls);
+
+    // Caches the reply to ReadValue for `ms` milliseconds
+    //
+    // While the cached reply is fresh, ReadValue is answered with it directly and the onReadValue callback isn't called. The cache
+    // is dropped early when the characteristic's value is updated (`ggkNofifyUpdatedCharacteristic()`, `pushUpdateQueue()` or
+    // `callOnUpdatedValue()`) and whenever the client writes to the characteristic. Use this for values that are expensive to build
+    // but change rarely.
+    GattCharacteristic &cacheFor(int ms);
+
+    // Releases the long read snapshots held for a peer, when it disconnects
+    //
+    // A peer reading a value longer than the ATT MTU reads it in pieces, each at a later offset. The whole value is kept when it
+    // reads at offset 0 and the later pieces are cut from it, so the value is built once and can't change part way through.
+    // Snapshots taken when BlueZ didn't name the peer are left alone; they're replaced by the next read at offset 0.
+    //
+    // This is safe to call from any thread
+    static void releaseLongReadSnapshots(const uint8_t address[6]);
+
+    // Fails the method calls of async handlers that have returned but whose completion hasn't run, once the main loop has stopped
+    //
+    // The worker pool must be stopped first, so that no more completions are posted.
+    static void cancelAsyncCalls();
+
+    // An async handler call on its way through the worker pool
+    struct AsyncCall;
+
+    // Drops the cached ReadValue reply (see `cacheFor()`)
+    //
+    // This is safe to call from any thread
+    void invalidateReadCache() const { readCacheGeneration.fetch_add(1, std::memory_order_acq_rel); }
+
     // Custom support for handling updates to our characteristic's value
     //
     // Defined as: (NOT defined by Bluetooth or BlueZ - this method is internal only)
@@ -155,6 +227,14 @@ struct GattCharacteristic : GattInterface
     // `callOnUpdatedValue` for more information.
     GattCharacteristic &onUpdatedValue(UpdatedValueCallback callback);
 
+    // Marks this characteristic as waiting in the update queue
+    //
+    // Returns false if it was already waiting, in which case the new update is coalesced with the pending one
+    bool markUpdateQueued() const { return !updateQueued.exchange(true, std::memory_order_acq_rel); }
+
+    // Clears the mark set by `markUpdateQueued()` as the characteristic is taken from the update queue
+    void clearUpdateQueued() const { updateQueued.store(false, std::memory_order_release); }
+
     // Calls the onUpdatedValue method, if one was set.
     //
     // Returns false if there was no method set, otherwise, returns the boolean result of the method call.
@@ -243,8 +323,59 @@ struct GattCharacteristic : GattInterface
 
 protected:
 
+    // Runs an async handler on the worker pool, or fails the method call if this characteristic or the pool is too busy
+    void dispatchAsync(bool isRead, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData) const;
+
+    // Runs an async handler (on a worker thread) and hands its result back to the main loop
+    static void runAsyncCall(AsyncCall *pCall);
+
+    // Completes an async handler's method call (on the main loop)
+    static gboolean completeAsyncCall(gpointer pData);
+
+    // Fails an async handler's method call that will never be completed, because the server is stopping
+    static void cancelAsyncCall(AsyncCall *pCall);
+
+    // Releases everything an async handler call holds, once its method call has been answered
+    static void releaseAsyncCall(AsyncCall *pCall);
+
+    // The options of a ReadValue call
+    struct ReadOptions
+    {
+        guint16 offset;     // Where in the value the peer is reading from
+        guint16 mtu;        // The ATT MTU of the link (0 if BlueZ didn't say)
+        std::string device; // The peer's device name, such as "dev_AA_BB_CC_DD_EE_FF" (empty if BlueZ didn't say)
+    };
+
+    // Reads the options of a ReadValue call
+    static ReadOptions getReadOptions(GVariant *pParameters);
+
+    // Keeps the reply to a ReadValue call (for the read cache and long reads) and trims it to the offset the peer asked for
+    virtual GVariant *onMethodReturn(GDBusMethodInvocation *pInvocation, GVariant *pReply) const;
+
+    // Answers a ReadValue call at a non-zero offset from the peer's snapshot of the value, if it has one
+    //
+    // Returns true if the call was answered, otherwise false (the value is then read as usual and trimmed to the offset)
+    bool continueLongRead(const ReadOptions &options, GDBusMethodInvocation *pInvocation) const;
+
     GattService &service;
     UpdatedValueCallback pOnUpdatedValueFunc;
+    AsyncReadCallback pOnReadValueAsyncFunc;
+    AsyncWriteCallback pOnWriteValueAsyncFunc;
+    int asyncConcurrencyLimit;
+    mutable std::atomic<int> asyncCallsInProgress;
+    mutable std::atomic<bool> updateQueued;
+
+    // The ReadValue cache (see `cacheFor()`). Apart from the generation, these are only touched on the main loop.
+    //
+    // `readCacheCallGeneration` is the generation of the ReadValue call being answered. It is set as each call starts and, for
+    // async handlers, again just before the reply is returned (each `AsyncCall` carries its own), so a reply is only cached if
+    // the value wasn't updated while that particular call was in progress.
+    std::chrono::milliseconds readCacheTTL;
+    mutable GVariant *pReadCache;
+    mutable std::chrono::steady_clock::time_point readCacheExpiry;
+    mutable unsigned int readCacheStoredGeneration;
+    mutable unsigned int readCacheCallGeneration;
+    mutable std::atomic<unsigned int> readCacheGeneration;
 };
 
 }; // namespace ggk
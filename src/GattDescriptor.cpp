@@ -58,16 +58,14 @@ GattCharacteristic &GattDescriptor::gattDescriptorEnd()
 // Locates a D-Bus method within this D-Bus interface
 bool GattDescriptor::callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-    for (const DBusMethod &method : methods)
+    const DBusMethod *pMethod = findMethod(methodName);
+    if (nullptr == pMethod)
     {
-        if (methodName == method.getName())
-        {
-            method.call<GattDescriptor>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
-            return true;
-        }
+        return false;
     }
 
-    return false;
+    pMethod->call<GattDescriptor>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
+    return true;
 }
 
 // Adds an event to the descriptor and returns a refereence to 'this` to enable method chaining in the server description
@@ -163,7 +161,7 @@ bool GattDescriptor::callOnUpdatedValue(GDBusConnection *pConnection, void *pUse
         return false;
     }
 
-    Logger::debug(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
+    GGK_DEBUG("Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
     return pOnUpdatedValueFunc(*this, pConnection, pUserData);
 }
 
@@ -24,6 +24,7 @@
 #include "GattInterface.h"
 #include "GattProperty.h"
 #include "DBusObject.h"
+#include "HciConnections.h"
 #include "Logger.h"
 
 namespace ggk {
@@ -61,6 +62,40 @@ void GattInterface::methodReturnVariant(GDBusMethodInvocation *pInvocation, GVar
     {
         pVariant = g_variant_new_tuple(&pVariant, 1);
     }
+
+    if (pVariant != nullptr)
+    {
+        pVariant = onMethodReturn(pInvocation, pVariant);
+    }
+
+    // Credit the bytes to the peer that asked for them (the options dictionary names the peer's device, but we only need to look
+    // it up if more than one peer is connected)
+    HciConnections &connections = HciConnections::getInstance();
+    size_t connectionCount = connections.count();
+    if (connectionCount != 0 && pVariant != nullptr)
+    {
+        const gchar *pDevicePath = nullptr;
+        GVariant *pOptions = nullptr;
+
+        GVariant *pParameters = g_dbus_method_invocation_get_parameters(pInvocation);
+        gsize parameterCount = pParameters != nullptr ? g_variant_n_children(pParameters) : 0;
+        if (connectionCount > 1 && parameterCount != 0)
+        {
+            pOptions = g_variant_get_child_value(pParameters, parameterCount - 1);
+            if (g_variant_is_of_type(pOptions, G_VARIANT_TYPE_VARDICT))
+            {
+                g_variant_lookup(pOptions, "device", "&o", &pDevicePath);
+            }
+        }
+
+        connections.addBytesServed(pDevicePath, g_variant_get_size(pVariant));
+
+        if (pOptions != nullptr)
+        {
+            g_variant_unref(pOptions);
+        }
+    }
+
     g_dbus_method_invocation_return_value(pInvocation, pVariant);
 }
 
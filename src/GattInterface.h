@@ -219,6 +219,12 @@ struct GattInterface : DBusInterface
 
 protected:
 
+    // Called by `methodReturnVariant()` with the reply (already wrapped in a tuple, if requested) just before it is sent
+    //
+    // Derived interfaces may keep a reference to the reply or replace it (see the read cache and long reads in
+    // GattCharacteristic.cpp.) Returns the reply to send; a replaced reply must be released by this method.
+    virtual GVariant *onMethodReturn(GDBusMethodInvocation *pInvocation, GVariant *pReply) const { return pReply; }
+
     std::list<GattProperty> properties;
 };
 
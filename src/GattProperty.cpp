@@ -26,6 +26,7 @@
 
 #include "Utils.h"
 #include "GattProperty.h"
+#include "ServerUtils.h"
 
 namespace ggk {
 
@@ -75,6 +76,9 @@ const GVariant *GattProperty::getValue() const
 GattProperty &GattProperty::setValue(GVariant *pValue)
 {
     this->pValue = pValue;
+
+    // Our value is part of the reply to `GetManagedObjects`
+    ServerUtils::invalidateManagedObjects();
     return *this;
 }
 
@@ -35,16 +35,23 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <string.h>
+#include <stdint.h>
 #include <string>
 #include <thread>
 #include <memory>
 #include <deque>
+#include <set>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
 
 #include "Init.h"
 #include "Logger.h"
 #include "Server.h"
 #include "HciAdapter.h"
+#include "HciTrace.h"
+#include "GattCharacteristic.h"
 
 #include "Mgmt.h"
 
@@ -67,10 +74,177 @@ namespace ggk
     static GPrintFunc printerrHandlerGLib;
     static GLogFunc logHandlerGLib;
 
+    // Default number of updates processed per pass of the main loop (see `ggkSetUpdateQueueBudget()`)
+    static const int kDefaultUpdateQueueBudget = 32;
+
+    // Number of entries the update queue holds before the overflow policy applies
+    static const size_t kUpdateQueueCapacity = 256;
+
+    // How often a producer blocked by `EUpdateQueueOverflowBlock` checks whether the server is still running
+    static const int kUpdateQueueBlockRecheckMS = 100;
+
     // Our update queue
-    typedef std::tuple<std::string, std::string> QueueEntry;
+    //
+    // The update queue is a deque of entries, newest at the front. Entries are coalesced while they wait, so an update is never
+    // queued twice:
+    //
+    //     Characteristic entries (queued through `pushUpdateQueue()`) carry a flag on the characteristic that is set while it is
+    //     waiting, so a repeated update is coalesced without taking the lock.
+    //
+    //     Path entries (queued through the C API) are also held in `updateQueuePending` while they wait.
+    //
+    // The queue keeps the order of first arrival. Once it holds `kUpdateQueueCapacity` entries, the overflow policy applies (see
+    // `ggkSetUpdateQueueOverflowPolicy()`); producers blocked by it wait on `updateQueueRoom`, which is signalled whenever entries
+    // are taken from the queue.
+    //
+    // Coalesced updates are counted in `updateQueueCoalesced`, updates dropped by the overflow policy in `updateQueueDropped`.
     std::deque<QueueEntry> updateQueue;
+    std::set<QueueEntry> updateQueuePending;
     std::mutex updateQueueMutex;
+    static std::condition_variable updateQueueRoom;
+    static std::atomic<unsigned long> updateQueueCoalesced(0);
+    static std::atomic<unsigned long> updateQueueDropped(0);
+    static std::atomic<int> updateQueueBudget(kDefaultUpdateQueueBudget);
+    static std::atomic<GGKUpdateQueueOverflowPolicy> updateQueueOverflowPolicy(EUpdateQueueOverflowSpill);
+
+    // Removes an entry from the update queue's bookkeeping as it is taken from the queue
+    //
+    // Must be called with `updateQueueMutex` held
+    static void releaseQueueEntry(const QueueEntry &entry)
+    {
+        if (nullptr != entry.pCharacteristic)
+        {
+            entry.pCharacteristic->clearUpdateQueued();
+        }
+        else
+        {
+            updateQueuePending.erase(entry);
+        }
+    }
+
+    // Takes a batch of entries from the update queue
+    //
+    // At most one pass' budget of entries is moved into `batch` under a single lock, keeping the queue's ordering (the oldest entry
+    // is at the back.) Each entry's coalescing mark is cleared before the update is processed, so a new update arriving meanwhile is
+    // queued again.
+    //
+    // Returns true if entries remain on the queue after the batch was taken
+    bool takeUpdateQueueBatch(std::deque<QueueEntry> &batch)
+    {
+        int budget = updateQueueBudget;
+        size_t remaining = budget <= 0 ? SIZE_MAX : static_cast<size_t>(budget);
+        bool moreQueued;
+
+        {
+            std::lock_guard<std::mutex> guard(updateQueueMutex);
+
+            // If everything fits, just take the whole queue
+            if (updateQueue.size() <= remaining)
+            {
+                batch.swap(updateQueue);
+                updateQueue.clear();
+                updateQueuePending.clear();
+                for (const QueueEntry &entry : batch)
+                {
+                    if (nullptr != entry.pCharacteristic) { entry.pCharacteristic->clearUpdateQueued(); }
+                }
+            }
+            else
+            {
+                // Otherwise take the oldest entries that fit in our budget
+                while (remaining > 0)
+                {
+                    releaseQueueEntry(updateQueue.back());
+                    batch.push_front(std::move(updateQueue.back()));
+                    updateQueue.pop_back();
+                    remaining -= 1;
+                }
+            }
+
+            moreQueued = !updateQueue.empty();
+        }
+
+        if (!batch.empty())
+        {
+            updateQueueRoom.notify_all();
+        }
+
+        return moreQueued;
+    }
+
+    // Adds an entry to the front of the update queue, coalescing it with an identical entry that is already waiting
+    //
+    // A characteristic entry must already carry its queued mark (see `pushUpdateQueue()`.) If the queue is full, the overflow
+    // policy applies.
+    //
+    // Returns non-zero value on success or 0 on failure.
+    static int pushUpdateQueueEntry(QueueEntry &&t)
+    {
+        {
+            std::unique_lock<std::mutex> lock(updateQueueMutex);
+            for (;;)
+            {
+                if (nullptr == t.pCharacteristic && updateQueuePending.count(t) != 0)
+                {
+                    updateQueueCoalesced += 1;
+                    return 1;
+                }
+
+                if (updateQueue.size() < kUpdateQueueCapacity)
+                {
+                    break;
+                }
+
+                GGKUpdateQueueOverflowPolicy policy = updateQueueOverflowPolicy;
+                if (policy == EUpdateQueueOverflowDrop)
+                {
+                    if (nullptr != t.pCharacteristic) { t.pCharacteristic->clearUpdateQueued(); }
+                    updateQueueDropped += 1;
+                    return 0;
+                }
+
+                // Wait for the server thread to make room, unless it has stopped processing updates. An identical entry may be
+                // queued while we wait, so check for that again once we wake.
+                if (policy != EUpdateQueueOverflowBlock || ggkGetServerRunState() != ERunning)
+                {
+                    break;
+                }
+                updateQueueRoom.wait_for(lock, std::chrono::milliseconds(kUpdateQueueBlockRecheckMS));
+            }
+
+            if (nullptr == t.pCharacteristic)
+            {
+                updateQueuePending.insert(t);
+            }
+            updateQueue.push_front(std::move(t));
+        }
+
+        // Let the server thread know there's work to do
+        wakeUpdateQueue();
+        return 1;
+    }
+
+    // Adds an update for a characteristic to the front of the queue
+    //
+    // This is the fast path equivalent of `ggkNofifyUpdatedCharacteristic()`: the characteristic itself is queued, so no strings
+    // are built here and no tree search is needed to process it, and an update for a characteristic that is already waiting is
+    // coalesced without taking the queue's lock.
+    //
+    // Returns non-zero value on success or 0 on failure.
+    int pushUpdateQueue(const GattCharacteristic &characteristic)
+    {
+        // Readers must not be served the old value from now on
+        characteristic.invalidateReadCache();
+
+        // Already waiting? Then this update is coalesced with the pending one
+        if (!characteristic.markUpdateQueued())
+        {
+            updateQueueCoalesced += 1;
+            return 1;
+        }
+
+        return pushUpdateQueueEntry(QueueEntry(characteristic));
+    }
 
     // Internal method to set the run state of the server
     void setServerRunState(GGKServerRunState newState)
@@ -114,6 +288,9 @@ void ggkLogRegisterFatal(GGKLogReceiver receiver) { Logger::registerFatalReceive
 void ggkLogRegisterTrace(GGKLogReceiver receiver) { Logger::registerTraceReceiver(receiver); }
 void ggkLogRegisterAlways(GGKLogReceiver receiver) { Logger::registerAlwaysReceiver(receiver); }
 
+int ggkHciTraceStart(const char *pFilename, unsigned long maxFileBytes) { return HciTrace::start(pFilename, maxFileBytes) ? 1 : 0; }
+void ggkHciTraceStop() { HciTrace::stop(); }
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 //  _   _           _       _                                                                                                     _
 // | | | |_ __   __| | __ _| |_ ___     __ _ _   _  ___ _   _  ___    _ __ ___   __ _ _ __   __ _  __ _  ___ _ __ ___   ___ _ __ | |_
@@ -145,20 +322,36 @@ int ggkNofifyUpdatedDescriptor(const char *pObjectPath)
 // Adds a named update to the front of the queue. Generally, this routine should not be used directly. Instead, use the
 // `ggkNofifyUpdatedCharacteristic()` instead.
 //
+// If the same object path and interface is already waiting in the queue, the update is coalesced with the pending one (which
+// keeps its place in the queue) and counted (see `ggkUpdateQueueCoalescedCount()`.)
+//
+// A characteristic is looked up here rather than when the update is processed, and queued the way `pushUpdateQueue()` queues it,
+// so its cached ReadValue reply (see `GattCharacteristic::cacheFor()`) is dropped before this returns.
+//
 // Returns non-zero value on success or 0 on failure.
 int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName)
 {
-    QueueEntry t(pObjectPath, pInterfaceName);
+    if (nullptr != TheServer)
+    {
+        std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(DBusObjectPath(pObjectPath), pInterfaceName);
+        if (nullptr != pInterface)
+        {
+            if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
+            {
+                return pushUpdateQueue(*pCharacteristic);
+            }
+        }
+    }
 
-    std::lock_guard<std::mutex> guard(updateQueueMutex);
-    updateQueue.push_front(t);
-    return 1;
+    return pushUpdateQueueEntry(QueueEntry(pObjectPath, pInterfaceName));
 }
 
 // Get the next update from the back of the queue and returns the element in `element` as a string in the format:
 //
 //     "com/object/path|com.interface.name"
 //
+// Updates queued by the server's own service code are returned like any other.
+//
 // If the queue is empty, this method returns `0` and does nothing.
 //
 // `elementLen` is the size of the `element` buffer in bytes. If the resulting string (including the null terminator) will not
@@ -179,20 +372,33 @@ int ggkPopUpdateQueue(char *pElementBuffer, int elementLen, int keep)
         if (updateQueue.empty()) { return 0; }
 
         // Get the last element
-        QueueEntry t = updateQueue.back();
+        const QueueEntry &t = updateQueue.back();
 
         // Get the result string
-        result = std::get<0>(t) + "|" + std::get<1>(t);
+        if (nullptr != t.pCharacteristic)
+        {
+            result = t.pCharacteristic->getPath().toString() + "|" + t.pCharacteristic->getName();
+        }
+        else
+        {
+            result = t.objectPath + "|" + t.interfaceName;
+        }
 
         // Ensure there's enough room for it
         if (result.length() + 1 > static_cast<size_t>(elementLen)) { return -1; }
 
         if (keep == 0)
         {
+            releaseQueueEntry(t);
             updateQueue.pop_back();
         }
     }
 
+    if (keep == 0)
+    {
+        updateQueueRoom.notify_all();
+    }
+
     // Copy the element string
     memcpy(pElementBuffer, result.c_str(), result.length() + 1);
 
@@ -216,8 +422,43 @@ int ggkUpdateQueueSize()
 // Removes all entries from the queue
 void ggkUpdateQueueClear()
 {
-    std::lock_guard<std::mutex> guard(updateQueueMutex);
-    updateQueue.clear();
+    {
+        std::lock_guard<std::mutex> guard(updateQueueMutex);
+        for (const QueueEntry &entry : updateQueue)
+        {
+            if (nullptr != entry.pCharacteristic) { entry.pCharacteristic->clearUpdateQueued(); }
+        }
+        updateQueue.clear();
+        updateQueuePending.clear();
+    }
+
+    updateQueueRoom.notify_all();
+}
+
+// Returns the total number of updates that were coalesced with an update already waiting in the queue
+unsigned long ggkUpdateQueueCoalescedCount()
+{
+    return updateQueueCoalesced;
+}
+
+// Returns the total number of updates that were dropped because the queue was full (see `ggkSetUpdateQueueOverflowPolicy()`)
+unsigned long ggkUpdateQueueDroppedCount()
+{
+    return updateQueueDropped;
+}
+
+// Sets what happens when an update is queued while the update queue is full
+void ggkSetUpdateQueueOverflowPolicy(enum GGKUpdateQueueOverflowPolicy policy)
+{
+    updateQueueOverflowPolicy = policy;
+}
+
+// Sets the maximum number of queued updates the server will process in a single pass of its main loop
+//
+// A value of 0 (or less) removes the limit.
+void ggkSetUpdateQueueBudget(int maxUpdatesPerPass)
+{
+    updateQueueBudget = maxUpdatesPerPass;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -40,13 +40,20 @@
 // However, for initialization, it seems to be generally safe to treat them as "nearly 1:1". The solution below is to consume all
 // events and look for the event that we're waiting on. This seems to work in my environment (Raspberry Pi) fairly well, but please
 // do use this with caution.
+//
+// Commands that have been sent are kept in a table of pending commands, each with a promise for its response. The event thread
+// completes the oldest pending command with a matching command code and controller index as each response arrives, handing it the
+// response's status and return parameters. No thread is needed to wait on a command, several commands may be outstanding at once
+// (see `submitCommand()` and `Mgmt::beginBatch()`) and callers on different threads can't steal each other's responses.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <string.h>
 #include <chrono>
-#include <future>
+#include <algorithm>
 
 #include "HciAdapter.h"
+#include "HciConnections.h"
+#include "GattCharacteristic.h"
 #include "HciSocket.h"
 #include "Utils.h"
 #include "Mgmt.h"
@@ -62,6 +69,9 @@ bool dasBoot = false;
 // Our event thread listens for events coming from the adapter and deals with them appropriately
 std::thread HciAdapter::eventThread;
 
+// Defined here as well, since `Mgmt::endBatch()` binds it to a reference (std::chrono's constructors take a const reference)
+const int HciAdapter::kMaxEventWaitTimeMS;
+
 const char * const HciAdapter::kCommandCodeNames[kMaxCommandCode + 1] =
 {
     "Invalid Command",                                   // 0x0000
@@ -220,187 +230,275 @@ void HciAdapter::runEventThread()
 {
     Logger::trace("Entering the HciAdapter event thread");
 
+    // Our receive buffer, allocated once and reused for every event (events are parsed in place)
+    std::vector<uint8_t> receiveBuffer(HciSocket::kResponseMaxSize);
+
     while (ggkGetServerRunState() <= ERunning && hciSocket.isConnected())
     {
         // Read the next event, waiting until one arrives
-        std::vector<uint8_t> responsePacket = std::vector<uint8_t>();
-        if (!hciSocket.read(responsePacket))
+        size_t packetSize = 0;
+        if (!hciSocket.read(receiveBuffer.data(), receiveBuffer.size(), packetSize))
         {
             break;
         }
 
-        // Do we have enough to check the event code?
-        if (responsePacket.size() < 2)
-        {
-            Logger::error(SSTR << "Invalid command response: too short");
-            continue;
-        }
+        processEvent(receiveBuffer.data(), packetSize);
+    }
 
-        // Our response, as a usable object type
-        uint16_t eventCode = Utils::endianToHost(*reinterpret_cast<uint16_t *>(responsePacket.data()));
+    // Make sure we're disconnected before we leave
+    hciSocket.disconnect();
 
-        // Ensure our event code is valid
-        if (eventCode < HciAdapter::kMinEventType || eventCode > HciAdapter::kMaxEventType)
-        {
-            Logger::error(SSTR << "Invalid command response: event code (" << eventCode << ") out of range");
-            continue;
-        }
+    // Nothing will answer any commands still waiting
+    abandonPendingCommands();
 
-        switch(eventCode)
+    // We won't hear about any more connections coming or going
+    HciConnections::getInstance().clear();
+
+    Logger::trace("Leaving the HciAdapter event thread");
+}
+
+// Validates and handles a single event packet of `packetSize` bytes, as received from the HCI socket
+//
+// The packet is parsed in place. Malformed packets (truncated, or with a header claiming more data than was received) are logged
+// and dropped; bytes past the size given in the header are ignored.
+//
+// Returns false if the packet was malformed, otherwise true
+bool HciAdapter::processEvent(const uint8_t *pPacket, size_t packetSize)
+{
+    // Do we have a complete header?
+    HciHeader header;
+    if (packetSize < sizeof(header))
+    {
+        Logger::error(SSTR << "Invalid command response: too short");
+        return false;
+    }
+
+    memcpy(&header, pPacket, sizeof(header));
+    header.toHost();
+
+    // Make sure the packet holds all of the data the header claims, and ignore anything past it
+    if (packetSize - sizeof(header) < header.dataSize)
+    {
+        Logger::error(SSTR << "Invalid command response: " << packetSize << " bytes is too short for " << header.dataSize << " bytes of data");
+        return false;
+    }
+
+    packetSize = sizeof(header) + header.dataSize;
+
+    // Our response, as a usable object type
+    uint16_t eventCode = header.code;
+
+    // Ensure our event code is valid
+    if (eventCode < HciAdapter::kMinEventType || eventCode > HciAdapter::kMaxEventType)
+    {
+        Logger::error(SSTR << "Invalid command response: event code (" << eventCode << ") out of range");
+        return false;
+    }
+
+    switch(eventCode)
+    {
+        // Command complete event
+        case Mgmt::ECommandCompleteEvent:
         {
-            // Command complete event
-            case Mgmt::ECommandCompleteEvent:
+            // Extract our event
+            CommandCompleteEvent event;
+            if (!event.parse(pPacket, packetSize))
             {
-                // Extract our event
-                CommandCompleteEvent event(responsePacket);
+                Logger::error("Invalid command complete event: too short");
+                return false;
+            }
 
-                // Point to the data following the event
-                uint8_t *data = responsePacket.data() + sizeof(CommandCompleteEvent);
-                size_t dataLen = responsePacket.size() - sizeof(CommandCompleteEvent);
+            // Point to the data following the event
+            const uint8_t *data = pPacket + sizeof(CommandCompleteEvent);
+            size_t dataLen = packetSize - sizeof(CommandCompleteEvent);
 
-                switch(event.commandCode)
+            // Only a successful response carries the data we cache (and a bad length only costs us that response)
+            switch(event.status == 0 ? event.commandCode : static_cast<uint16_t>(Mgmt::EInvalidCommand))
+            {
+                // We just log the version/revision info
+                case Mgmt::EReadVersionInformationCommand:
                 {
-                    // We just log the version/revision info
-                    case Mgmt::EReadVersionInformationCommand:
+                    // Verify the size is what we expect
+                    if (dataLen != sizeof(VersionInformation))
                     {
-                        // Verify the size is what we expect
-                        if (dataLen != sizeof(VersionInformation))
-                        {
-                            Logger::error("Invalid data length");
-                            return;
-                        }
-
-                        versionInformation = *reinterpret_cast<VersionInformation *>(data);
-                        versionInformation.toHost();
-                        Logger::debug(versionInformation.debugText());
+                        Logger::error("Invalid data length");
                         break;
                     }
-                    case Mgmt::EReadControllerInformationCommand:
+
+                    memcpy(&versionInformation, data, sizeof(versionInformation));
+                    versionInformation.toHost();
+                    GGK_DEBUG(versionInformation.debugText());
+                    break;
+                }
+                case Mgmt::EReadControllerInformationCommand:
+                {
+                    if (dataLen != sizeof(ControllerInformation))
                     {
-                        if (dataLen != sizeof(ControllerInformation))
-                        {
-                            Logger::error("Invalid data length");
-                            return;
-                        }
-
-                        controllerInformation = *reinterpret_cast<ControllerInformation *>(data);
-                        controllerInformation.toHost();
-                        Logger::debug(controllerInformation.debugText());
+                        Logger::error("Invalid data length");
                         break;
                     }
-                    case Mgmt::ESetLocalNameCommand:
+
+                    memcpy(&controllerInformation, data, sizeof(controllerInformation));
+                    controllerInformation.toHost();
+                    GGK_DEBUG(controllerInformation.debugText());
+                    break;
+                }
+                case Mgmt::ESetLocalNameCommand:
+                {
+                    if (dataLen != sizeof(LocalName))
                     {
-                        if (dataLen != sizeof(LocalName))
-                        {
-                            Logger::error("Invalid data length");
-                            return;
-                        }
-
-                        localName = *reinterpret_cast<LocalName *>(data);
-                        Logger::info(localName.debugText());
+                        Logger::error("Invalid data length");
                         break;
                     }
-                    case Mgmt::ESetPoweredCommand:
-                    case Mgmt::ESetBREDRCommand:
-                    case Mgmt::ESetSecureConnectionsCommand:
-                    case Mgmt::ESetBondableCommand:
-                    case Mgmt::ESetConnectableCommand:
-                    case Mgmt::ESetLowEnergyCommand:
-                    case Mgmt::ESetAdvertisingCommand:
-                    {
-                        if (dataLen != sizeof(AdapterSettings))
-                        {
-                            Logger::error("Invalid data length");
-                            return;
-                        }
 
-                        adapterSettings = *reinterpret_cast<AdapterSettings *>(data);
-                        adapterSettings.toHost();
-
-                        Logger::debug(adapterSettings.debugText());
+                    memcpy(&localName, data, sizeof(localName));
+                    GGK_INFO(localName.debugText());
+                    break;
+                }
+                case Mgmt::ESetPoweredCommand:
+                case Mgmt::ESetBREDRCommand:
+                case Mgmt::ESetSecureConnectionsCommand:
+                case Mgmt::ESetBondableCommand:
+                case Mgmt::ESetConnectableCommand:
+                case Mgmt::ESetLowEnergyCommand:
+                case Mgmt::ESetAdvertisingCommand:
+                {
+                    if (dataLen != sizeof(AdapterSettings))
+                    {
+                        Logger::error("Invalid data length");
                         break;
                     }
-                }
 
-                // Notify anybody waiting that we received a response to their command code
-                setCommandResponse(event.commandCode);
+                    memcpy(&adapterSettings, data, sizeof(adapterSettings));
+                    adapterSettings.toHost();
 
-                break;
+                    GGK_DEBUG(adapterSettings.debugText());
+                    break;
+                }
             }
-            // Command status event
-            case Mgmt::ECommandStatusEvent:
+
+            // Hand the status and return parameters to whoever sent this command
+            setCommandResponse(event.commandCode, event.header.controllerId, event.status, data, dataLen);
+
+            break;
+        }
+        // Command status event
+        case Mgmt::ECommandStatusEvent:
+        {
+            CommandStatusEvent event;
+            if (!event.parse(pPacket, packetSize))
             {
-                CommandStatusEvent event(responsePacket);
+                Logger::error("Invalid command status event: too short");
+                return false;
+            }
 
-                // Notify anybody waiting that we received a response to their command code
-                setCommandResponse(event.commandCode);
-                break;
+            // Hand the status to whoever sent this command (a status event has no return parameters)
+            setCommandResponse(event.commandCode, event.header.controllerId, event.status, nullptr, 0);
+            break;
+        }
+        // Command status event
+        case Mgmt::EDeviceConnectedEvent:
+        {
+            DeviceConnectedEvent event;
+            if (!event.parse(pPacket, packetSize))
+            {
+                Logger::error("Invalid device connected event: too short");
+                return false;
             }
-            // Command status event
-            case Mgmt::EDeviceConnectedEvent:
+
+            // The EIR data follows the event
+            size_t eirDataLength = std::min(static_cast<size_t>(event.eirDataLength), packetSize - sizeof(event));
+            GGK_DEBUG("  + EIR Data           : " << Utils::hex(pPacket + sizeof(event), eirDataLength));
+
+            HciConnections::getInstance().onConnected(event.address, event.addressType);
+
+            activeConnections += 1;
+            GGK_DEBUG("  > Connection count incremented to " << activeConnections);
+            log(LOG_ERR, event.simplifiedDebugText().c_str());
+            break;
+        }
+        // Command status event
+        case Mgmt::EDeviceDisconnectedEvent:
+        {
+            DeviceDisconnectedEvent event;
+            if (!event.parse(pPacket, packetSize))
             {
-                DeviceConnectedEvent event(responsePacket);
-                activeConnections += 1;
-                Logger::debug(SSTR << "  > Connection count incremented to " << activeConnections);
-                log(LOG_ERR, event.simplifiedDebugText().c_str());
-                break;
+                Logger::error("Invalid device disconnected event: too short");
+                return false;
             }
-            // Command status event
-            case Mgmt::EDeviceDisconnectedEvent:
+
+            HciConnections::getInstance().onDisconnected(event.address, event.addressType);
+            GattCharacteristic::releaseLongReadSnapshots(event.address);
+            if (activeConnections > 0)
             {
-                DeviceDisconnectedEvent event(responsePacket);
-                if (activeConnections > 0)
-                {
 #ifdef V_GATT_SERVER_AUTH_y
-                    ggkSetServerAuthState(false);
+                ggkSetServerAuthState(false);
 #endif
-                    activeConnections -= 1;
-                    Logger::debug(SSTR << "  > Connection count decremented to " << activeConnections);
-                }
-                else
-                {
-                    Logger::debug(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
-                }
-                log(LOG_ERR, event.simplifiedDebugText().c_str());
-                break;
+                activeConnections -= 1;
+                GGK_DEBUG("  > Connection count decremented to " << activeConnections);
             }
-            case Mgmt::EAuthenticationFailedEvent:
+            else
             {
-                log(LOG_ERR, "Auth failed - user not paired");
-                if (!fw::niceMode)
-                {
-                    fw::NtcDbus().checkConnectionsForPairing(true);
-                }
-                break;
+                Logger::debug(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
             }
-            case Mgmt::ENewLinkKeyEvent:
-            case Mgmt::ENewLongTermKeyEvent:
-            case Mgmt::ENewIdentityResolvingKeyEvent:
-            case Mgmt::ENewSignatureResolvingKeyEvent:
+            log(LOG_ERR, event.simplifiedDebugText().c_str());
+            break;
+        }
+        case Mgmt::EAuthenticationFailedEvent:
+        {
+            AuthenticationFailedEvent event;
+            if (!event.parse(pPacket, packetSize))
             {
-                // Pairing/Bondind related events
-                log(LOG_ERR, "Response event type: 0x%04X (%s)", eventCode, kEventTypeNames[eventCode]);
-                break;
+                Logger::error("Invalid authentication failed event: too short");
+                return false;
             }
-            // Unsupported
-            default:
+
+            HciConnections::getInstance().onAuthenticationFailed(event.address, event.addressType);
+
+            // The peer has most likely forgotten its pairing with us; forget ours with it (and only it)
+            log(LOG_ERR, "Auth failed - user not paired: Address [%s], Status [0x%02X]", Utils::bluetoothAddressString(event.address).c_str(), event.status);
+            if (!fw::niceMode)
             {
-                if (eventCode >= kMinEventType && eventCode <= kMaxEventType)
-                {
-                    Logger::error("Unsupported response event type: " + Utils::hex(eventCode) + " (" + kEventTypeNames[eventCode] + ")");
-                }
-                else
-                {
-                    Logger::error("Invalid event type response: " + Utils::hex(eventCode));
-                }
+                fw::NtcDbus().depairDevice(event.address);
             }
+            break;
         }
-    }
+        case Mgmt::ENewLinkKeyEvent:
+        case Mgmt::ENewLongTermKeyEvent:
+        {
+            // A new key means the peer has just paired. Both events start with a store hint followed by the peer's address and
+            // address type.
+            const size_t kAddressOffset = sizeof(HciHeader) + 1;
+            if (packetSize >= kAddressOffset + 7)
+            {
+                HciConnections::getInstance().onPaired(pPacket + kAddressOffset, pPacket[kAddressOffset + 6]);
+            }
 
-    // Make sure we're disconnected before we leave
-    hciSocket.disconnect();
+            log(LOG_ERR, "Response event type: 0x%04X (%s)", eventCode, kEventTypeNames[eventCode]);
+            break;
+        }
+        case Mgmt::ENewIdentityResolvingKeyEvent:
+        case Mgmt::ENewSignatureResolvingKeyEvent:
+        {
+            // Pairing/Bondind related events
+            log(LOG_ERR, "Response event type: 0x%04X (%s)", eventCode, kEventTypeNames[eventCode]);
+            break;
+        }
+        // Unsupported
+        default:
+        {
+            if (eventCode >= kMinEventType && eventCode <= kMaxEventType)
+            {
+                Logger::error("Unsupported response event type: " + Utils::hex(eventCode) + " (" + kEventTypeNames[eventCode] + ")");
+            }
+            else
+            {
+                Logger::error("Invalid event type response: " + Utils::hex(eventCode));
+            }
+        }
+    }
 
-    Logger::trace("Leaving the HciAdapter event thread");
+    return true;
 }
 
 // Reads current values from the controller
@@ -472,13 +570,20 @@ bool HciAdapter::start()
     return true;
 }
 
-// Waits for the HciAdapter run thread to join
+// Stops the HciAdapter run thread and waits for it to join
 //
 // This method will block until the thread joins
 void HciAdapter::stop()
 {
+    // Only one thread may join the event thread
+    static std::mutex stopMutex;
+    std::lock_guard<std::mutex> lock(stopMutex);
+
     Logger::trace("HciAdapter waiting for thread termination");
 
+    // Wake the event thread if it's blocked waiting for an event
+    hciSocket.interrupt();
+
     try
     {
         if (eventThread.joinable())
@@ -513,13 +618,40 @@ void HciAdapter::stop()
     }
 }
 
-// Sends a command over the HCI socket
+// Sends a command over the HCI socket and waits for its response event
 //
 // If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
 // a failure is returned.
 //
 // Returns true on success, otherwise false
 bool HciAdapter::sendCommand(HciHeader &request)
+{
+    CommandResponse response;
+    return sendCommand(request, response);
+}
+
+// Sends a command over the HCI socket and waits for its response event, which is returned in `response`
+//
+// Returns true if the adapter responded, otherwise false
+bool HciAdapter::sendCommand(HciHeader &request, CommandResponse &response)
+{
+    PendingCommand pending;
+    if (!submitCommand(request, pending))
+    {
+        return false;
+    }
+
+    return waitForCommandResponse(pending, response);
+}
+
+// Sends a command over the HCI socket without waiting for its response event
+//
+// The command is entered into our pending command table before it is written, so the event thread can never see a response for
+// a command it doesn't yet know about. Concurrent callers are serialized from sequence assignment through the write. Any number
+// of commands may be outstanding at once. Collect each response with `waitForCommandResponse()`.
+//
+// Returns true if the command was sent, otherwise false
+bool HciAdapter::submitCommand(HciHeader &request, PendingCommand &pending)
 {
     // Auto-connect
     if (!eventThread.joinable() && !start())
@@ -528,63 +660,115 @@ bool HciAdapter::sendCommand(HciHeader &request)
         return false;
     }
 
-    uint16_t code = request.code;
     uint16_t dataSize = request.dataSize;
+    pending.commandCode = request.code;
+    pending.controllerId = request.controllerId;
+
+    // Responses are matched to commands in the order they were sent, so the order of our sequence numbers must be the order in
+    // which commands reach the socket. Hold the send lock from taking a sequence number until the command has been written.
+    std::lock_guard<std::mutex> sendLock(sendMutex);
 
-    conditionalValue = -1;
-    std::future<bool> fut = std::async(std::launch::async,
-    [&]() mutable
     {
-        return waitForCommandResponse(code, kMaxEventWaitTimeMS);
-    });
+        std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+        pending.sequence = nextCommandSequence++;
+
+        CommandSlot &slot = pendingCommands[pending.sequence];
+        slot.commandCode = pending.commandCode;
+        slot.controllerId = pending.controllerId;
+        pending.response = slot.response.get_future();
+    }
 
     // Prepare the request to be sent (endianness correction)
     request.toNetwork();
-    uint8_t *pRequest = reinterpret_cast<uint8_t *>(&request);
+    const uint8_t *pRequest = reinterpret_cast<const uint8_t *>(&request);
 
-    std::vector<uint8_t> requestPacket = std::vector<uint8_t>(pRequest, pRequest + sizeof(request) + dataSize);
-    if (!hciSocket.write(requestPacket))
+    if (!hciSocket.write(pRequest, sizeof(request) + dataSize))
     {
+        std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+        pendingCommands.erase(pending.sequence);
         return false;
     }
 
-    return fut.get();
+    return true;
 }
 
-// Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
+// Waits up to `timeoutMS` milliseconds for the response to a command sent with `submitCommand()`
 //
-// Returns true if the response event was received for `commandCode` or false if the timeout expired.
-//
-// Command responses are set via `setCommandResponse()`
-bool HciAdapter::waitForCommandResponse(uint16_t commandCode, int timeoutMS)
+// Returns true if the response event was received (and stores it in `response`), or false if the timeout expired
+bool HciAdapter::waitForCommandResponse(PendingCommand &pending, CommandResponse &response, int timeoutMS)
 {
-    Logger::debug(SSTR << "  + Waiting on command code " << commandCode << " for up to " << timeoutMS << "ms");
+    if (!pending.response.valid())
+    {
+        return false;
+    }
+
+    GGK_DEBUG("  + Waiting on command code " << pending.commandCode << " for up to " << timeoutMS << "ms");
 
-    bool success = cvCommandResponse.wait_for(commandResponseLock, std::chrono::milliseconds(timeoutMS),
-        [&]
+    if (pending.response.wait_for(std::chrono::milliseconds(timeoutMS)) != std::future_status::ready)
+    {
+        // Withdraw the command so a late response can't be mistaken for a later command's
         {
-            return conditionalValue == commandCode;
+            std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+            pendingCommands.erase(pending.sequence);
         }
-    );
 
-    if (!success)
+        Logger::warn(SSTR << "  + Timed out waiting on command code " << Utils::hex(pending.commandCode) << " (" << kCommandCodeNames[pending.commandCode] << ")");
+        return false;
+    }
+
+    // The event thread abandons anything still pending when it stops
+    try
     {
-        Logger::warn(SSTR << "  + Timed out waiting on command code " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+        response = pending.response.get();
     }
-    else
+    catch(std::future_error &)
+    {
+        Logger::warn(SSTR << "  + Command code " << Utils::hex(pending.commandCode) << " (" << kCommandCodeNames[pending.commandCode] << ") was abandoned");
+        return false;
+    }
+
+    GGK_DEBUG("  + Recieved the command code we were waiting for: " << Utils::hex(pending.commandCode) << " (" << kCommandCodeNames[pending.commandCode] << "), status "
+        << Utils::hex(response.status));
+
+    return true;
+}
+
+// Completes the oldest pending command matching `commandCode` and `controllerId` (called from the event thread)
+//
+// The kernel answers the commands on our socket in the order they were sent, and each response carries the command code and
+// controller index of its command. Matching on both and taking the oldest match pairs every response with exactly the request
+// that caused it, even when the same command is outstanding from more than one thread.
+void HciAdapter::setCommandResponse(uint16_t commandCode, uint16_t controllerId, uint8_t status, const uint8_t *pData, size_t dataLen)
+{
+    std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+
+    for (auto it = pendingCommands.begin(); it != pendingCommands.end(); ++it)
     {
-        Logger::debug(SSTR << "  + Recieved the command code we were waiting for: " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+        if (it->second.commandCode == commandCode && it->second.controllerId == controllerId)
+        {
+            CommandResponse response;
+            response.status = status;
+            if (pData != nullptr && dataLen != 0)
+            {
+                response.data.assign(pData, pData + dataLen);
+            }
+
+            it->second.response.set_value(std::move(response));
+            pendingCommands.erase(it);
+            return;
+        }
     }
 
-    return success;
+    GGK_DEBUG("  + Nobody is waiting on command code " << Utils::hex(commandCode) << " for controller " << Utils::hex(controllerId));
 }
 
-// Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-void HciAdapter::setCommandResponse(uint16_t commandCode)
+// Fails every pending command (called when the event thread stops, since nobody is left to complete them)
+//
+// Destroying a promise that was never satisfied wakes its waiter with a `broken_promise` error
+void HciAdapter::abandonPendingCommands()
 {
-    std::lock_guard<std::mutex> lk(commandResponseMutex);
-    conditionalValue = commandCode;
-    cvCommandResponse.notify_one();
+    std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+    pendingCommands.clear();
 }
 
 }; // namespace ggk
@@ -25,10 +25,12 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include <vector>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
+#include <future>
+#include <map>
 
 #include "HciSocket.h"
 #include "Utils.h"
@@ -131,13 +133,24 @@ public:
         uint16_t commandCode;
         uint8_t status;
 
-        CommandCompleteEvent(const std::vector<uint8_t> &data)
+        // Parses the event from the front of `pPacket`, which is `packetSize` bytes long
+        //
+        // Only the fixed-size event is copied (onto the stack); any variable-length data stays in the packet.
+        //
+        // Returns false if the packet is too short to hold the event
+        bool parse(const uint8_t *pPacket, size_t packetSize)
         {
-            *this = *reinterpret_cast<const CommandCompleteEvent *>(data.data());
+            if (packetSize < sizeof(*this))
+            {
+                return false;
+            }
+
+            memcpy(this, pPacket, sizeof(*this));
             toHost();
 
             // Log it
-            Logger::debug(debugText());
+            GGK_DEBUG(debugText());
+            return true;
         }
 
         void toNetwork()
@@ -159,7 +172,7 @@ public:
             text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
             text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
             text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
-            text += "  + Command code       : " + Utils::hex(commandCode) + " (" + HciAdapter::kCommandCodeNames[commandCode] + ")\n";
+            text += "  + Command code       : " + Utils::hex(commandCode) + " (" + (commandCode <= HciAdapter::kMaxCommandCode ? HciAdapter::kCommandCodeNames[commandCode] : "Unknown") + ")\n";
             text += "  + Status             : " + Utils::hex(status);
             return text;
         }
@@ -171,13 +184,24 @@ public:
         uint16_t commandCode;
         uint8_t status;
 
-        CommandStatusEvent(const std::vector<uint8_t> &data)
+        // Parses the event from the front of `pPacket`, which is `packetSize` bytes long
+        //
+        // Only the fixed-size event is copied (onto the stack); any variable-length data stays in the packet.
+        //
+        // Returns false if the packet is too short to hold the event
+        bool parse(const uint8_t *pPacket, size_t packetSize)
         {
-            *this = *reinterpret_cast<const CommandStatusEvent *>(data.data());
+            if (packetSize < sizeof(*this))
+            {
+                return false;
+            }
+
+            memcpy(this, pPacket, sizeof(*this));
             toHost();
 
             // Log it
-            Logger::debug(debugText());
+            GGK_DEBUG(debugText());
+            return true;
         }
 
         void toNetwork()
@@ -199,8 +223,8 @@ public:
             text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
             text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
             text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
-            text += "  + Command code       : " + Utils::hex(commandCode) + " (" + HciAdapter::kCommandCodeNames[commandCode] + ")\n";
-            text += "  + Status             : " + Utils::hex(status) + " (" + HciAdapter::kStatusCodes[status] + ")";
+            text += "  + Command code       : " + Utils::hex(commandCode) + " (" + (commandCode <= HciAdapter::kMaxCommandCode ? HciAdapter::kCommandCodeNames[commandCode] : "Unknown") + ")\n";
+            text += "  + Status             : " + Utils::hex(status) + " (" + (status <= HciAdapter::kMaxStatusCode ? HciAdapter::kStatusCodes[status] : "Unknown") + ")";
             return text;
         }
     } __attribute__((packed));
@@ -213,13 +237,24 @@ public:
         uint32_t flags;
         uint16_t eirDataLength;
 
-        DeviceConnectedEvent(const std::vector<uint8_t> &data)
+        // Parses the event from the front of `pPacket`, which is `packetSize` bytes long
+        //
+        // Only the fixed-size event is copied (onto the stack); any variable-length data stays in the packet.
+        //
+        // Returns false if the packet is too short to hold the event
+        bool parse(const uint8_t *pPacket, size_t packetSize)
         {
-            *this = *reinterpret_cast<const DeviceConnectedEvent *>(data.data());
+            if (packetSize < sizeof(*this))
+            {
+                return false;
+            }
+
+            memcpy(this, pPacket, sizeof(*this));
             toHost();
 
             // Log it
-            Logger::debug(debugText());
+            GGK_DEBUG(debugText());
+            return true;
         }
 
         void toNetwork()
@@ -247,18 +282,13 @@ public:
             text += "  + Address type       : " + Utils::hex(addressType) + "\n";
             text += "  + Flags              : " + Utils::hex(flags) + "\n";
             text += "  + EIR Data Length    : " + Utils::hex(eirDataLength);
-            if (eirDataLength > 0)
-            {
-                text += "\n";
-                text += "  + EIR Data           : " + Utils::hex(reinterpret_cast<uint8_t *>(&eirDataLength) + 2, eirDataLength);
-            }
             return text;
         }
 
         std::string simplifiedDebugText()
         {
             std::string text = "";
-            fw::utils::DefValueMap<int, std::string> enumAddrType = {
+            static const fw::utils::DefValueMap<int, std::string> enumAddrType = {
                 {0, "BR/EDR"},
                 {1, "LE Public"},
                 {2, "LE Random"}
@@ -276,13 +306,24 @@ public:
         uint8_t addressType;
         uint8_t reason;
 
-        DeviceDisconnectedEvent(const std::vector<uint8_t> &data)
+        // Parses the event from the front of `pPacket`, which is `packetSize` bytes long
+        //
+        // Only the fixed-size event is copied (onto the stack); any variable-length data stays in the packet.
+        //
+        // Returns false if the packet is too short to hold the event
+        bool parse(const uint8_t *pPacket, size_t packetSize)
         {
-            *this = *reinterpret_cast<const DeviceDisconnectedEvent *>(data.data());
+            if (packetSize < sizeof(*this))
+            {
+                return false;
+            }
+
+            memcpy(this, pPacket, sizeof(*this));
             toHost();
 
             // Log it
-            Logger::debug(debugText());
+            GGK_DEBUG(debugText());
+            return true;
         }
 
         void toNetwork()
@@ -312,12 +353,12 @@ public:
         {
             // enumAddrType and enumReason are based on bluez.
             // mgmt_address_type_table and mgmt_device_disconnected_evt()
-            fw::utils::DefValueMap<int, std::string> enumAddrType = {
+            static const fw::utils::DefValueMap<int, std::string> enumAddrType = {
                 {0, "BR/EDR"},
                 {1, "LE Public"},
                 {2, "LE Random"}
             };
-            fw::utils::DefValueMap<int, std::string> enumReason = {
+            static const fw::utils::DefValueMap<int, std::string> enumReason = {
                 {0, "Unspecified"},
                 {1, "Connection timeout"},
                 {2, "Terminated by local host"},
@@ -332,6 +373,55 @@ public:
         }
     } __attribute__((packed));
 
+    struct AuthenticationFailedEvent
+    {
+        HciHeader header;
+        uint8_t address[6];
+        uint8_t addressType;
+        uint8_t status;
+
+        // Parses the event from the front of `pPacket`, which is `packetSize` bytes long
+        //
+        // Returns false if the packet is too short to hold the event
+        bool parse(const uint8_t *pPacket, size_t packetSize)
+        {
+            if (packetSize < sizeof(*this))
+            {
+                return false;
+            }
+
+            memcpy(this, pPacket, sizeof(*this));
+            toHost();
+
+            // Log it
+            GGK_DEBUG(debugText());
+            return true;
+        }
+
+        void toNetwork()
+        {
+            header.toNetwork();
+        }
+
+        void toHost()
+        {
+            header.toHost();
+        }
+
+        std::string debugText()
+        {
+            std::string text = "";
+            text += "> AuthenticationFailed event\n";
+            text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
+            text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
+            text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
+            text += "  + Address            : " + Utils::bluetoothAddressString(address) + "\n";
+            text += "  + Address type       : " + Utils::hex(addressType) + "\n";
+            text += "  + Status             : " + Utils::hex(status) + " (" + (status <= HciAdapter::kMaxStatusCode ? HciAdapter::kStatusCodes[status] : "Unknown") + ")";
+            return text;
+        }
+    } __attribute__((packed));
+
     struct AdapterSettings
     {
         uint32_t masks;
@@ -496,37 +586,78 @@ public:
     // Returns true if the HCI socket is connected (either via a new connection or an existing one), otherwise false
     bool start();
 
-    // Waits for the HciAdapter run thread to join
+    // Stops the HciAdapter run thread and waits for it to join
     //
     // This method will block until the thread joins
     void stop();
 
-    // Sends a command over the HCI socket
+    // The adapter's response to a command: the status code (see `kStatusCodes`) and the command's return parameters, if any
+    struct CommandResponse
+    {
+        uint8_t status = 0;
+        std::vector<uint8_t> data;
+
+        bool succeeded() const { return status == 0; }
+    };
+
+    // A command that has been sent to the adapter and is waiting for its response event (see `submitCommand()`)
+    struct PendingCommand
+    {
+        uint64_t sequence = 0;
+        uint16_t commandCode = 0;
+        uint16_t controllerId = 0;
+        std::future<CommandResponse> response;
+    };
+
+    // Sends a command over the HCI socket and waits for its response event
     //
     // If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
     // a failure is returned.
     //
-    // Returns true on success, otherwise false
+    // Note that a response carrying an error status still counts as a response; use the overload below to inspect it.
+    //
+    // Returns true if the adapter responded, otherwise false
     bool sendCommand(HciHeader &request);
 
+    // Sends a command over the HCI socket and waits for its response event, which is returned in `response`
+    //
+    // Returns true if the adapter responded, otherwise false
+    bool sendCommand(HciHeader &request, CommandResponse &response);
+
+    // Sends a command over the HCI socket without waiting for its response event
+    //
+    // Any number of commands may be outstanding at once. Collect each response with `waitForCommandResponse()`.
+    //
+    // Returns true if the command was sent, otherwise false
+    bool submitCommand(HciHeader &request, PendingCommand &pending);
+
+    // Waits up to `timeoutMS` milliseconds for the response to a command sent with `submitCommand()`
+    //
+    // Returns true if the response event was received (and stores it in `response`), or false if the timeout expired
+    bool waitForCommandResponse(PendingCommand &pending, CommandResponse &response, int timeoutMS = kMaxEventWaitTimeMS);
+
     // Event processor, responsible for receiving events from the HCI socket
     //
     // This mehtod should not be called directly. Rather, it runs continuously on a thread until the server shuts down
     void runEventThread();
 
+    // Validates and handles a single event packet of `packetSize` bytes, as received from the HCI socket
+    //
+    // Called for each packet by the event thread. Malformed packets (truncated, or with a header claiming more data than was
+    // received) are logged and dropped; bytes past the size given in the header are ignored.
+    //
+    // Returns false if the packet was malformed, otherwise true
+    bool processEvent(const uint8_t *pPacket, size_t packetSize);
+
 private:
     // Private constructor for our Singleton
-    HciAdapter() : commandResponseLock(commandResponseMutex), activeConnections(0) {}
+    HciAdapter() : nextCommandSequence(0), activeConnections(0) {}
 
-    // Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
-    //
-    // Returns true if the response event was received for `commandCode` or false if the timeout expired.
-    //
-    // Command responses are set via `setCommandResponse()`
-    bool waitForCommandResponse(uint16_t commandCode, int timeoutMS);
+    // Completes the oldest pending command matching `commandCode` and `controllerId` (called from the event thread)
+    void setCommandResponse(uint16_t commandCode, uint16_t controllerId, uint8_t status, const uint8_t *pData, size_t dataLen);
 
-    // Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-    void setCommandResponse(uint16_t commandCode);
+    // Fails every pending command (called when the event thread stops, since nobody is left to complete them)
+    void abandonPendingCommands();
 
     // Our HCI Socket, which allows us to talk directly to the kernel
     HciSocket hciSocket;
@@ -540,10 +671,21 @@ private:
     VersionInformation versionInformation;
     LocalName localName;
 
-    std::condition_variable cvCommandResponse;
-    std::mutex commandResponseMutex;
-    std::unique_lock<std::mutex> commandResponseLock;
-    int conditionalValue;
+    // A command waiting for its response event
+    struct CommandSlot
+    {
+        uint16_t commandCode;
+        uint16_t controllerId;
+        std::promise<CommandResponse> response;
+    };
+
+    // Commands waiting for a response, keyed (and therefore ordered) by the sequence in which they were sent
+    std::map<uint64_t, CommandSlot> pendingCommands;
+    std::mutex pendingCommandsMutex;
+    uint64_t nextCommandSequence;
+
+    // Held from assigning a command's sequence number until it has been written, so commands hit the socket in sequence order
+    std::mutex sendMutex;
 
     // Our active connection count
     int activeConnections;
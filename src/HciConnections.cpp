@@ -0,0 +1,328 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A table of the centrals currently connected to the adapter
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The HciAdapter event thread keeps this table up to date from the Device Connected and Device Disconnected events of the Bluetooth
+// Management API, so anybody who needs to know who is connected (plugins, the pairing checks in NtcDbus) can simply ask, rather
+// than opening their own HCI sockets and listing the connections with ioctls.
+//
+// The management events don't carry the HCI connection handle or the link's security level, so we ask the kernel for those once,
+// when the peer connects, over a single HCI socket that we keep open. After that the security level follows the events: New Link
+// Key and New Long Term Key mark the peer as paired, and Authentication Failed marks it as open again, so asking whether anyone is
+// unpaired is a table read. A link that is encrypted with an existing bond raises no event, so before dropping an unpaired peer,
+// `recheckUnpairedLowEnergy()` asks the kernel once more.
+//
+// Connections are keyed by address and address type, so any number of centrals can be connected at once.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/hci_lib.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "HciConnections.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// The HCI device we track (hci0, as elsewhere - search for kControllerIndex)
+static const int kHciDeviceId = 0;
+
+// Returns the peer's address as a string (such as "AA:BB:CC:DD:EE:FF")
+std::string HciConnection::addressString() const
+{
+    char text[18];
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", address[5], address[4], address[3], address[2], address[1], address[0]);
+    return text;
+}
+
+HciConnections::HciConnections()
+: fdDevice(-1)
+{
+}
+
+HciConnections::~HciConnections()
+{
+    if (fdDevice >= 0)
+    {
+        close(fdDevice);
+    }
+}
+
+// Returns the key for a peer in our table
+uint64_t HciConnections::makeKey(const uint8_t address[6], uint8_t addressType)
+{
+    uint64_t key = addressType;
+    for (int i = 0; i < 6; ++i)
+    {
+        key = (key << 8) | address[i];
+    }
+    return key;
+}
+
+// Looks up the handle and security level of a connection from the kernel
+//
+// Callers must own `mutex`
+void HciConnections::queryConnectionInfo(HciConnection &connection)
+{
+    if (fdDevice < 0)
+    {
+        fdDevice = hci_open_dev(kHciDeviceId);
+        if (fdDevice < 0)
+        {
+            Logger::warn(SSTR << "Unable to open HCI device " << kHciDeviceId << " for connection info: " << strerror(errno));
+            return;
+        }
+    }
+
+    struct
+    {
+        struct hci_conn_info_req request;
+        struct hci_conn_info info;
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    memcpy(&req.request.bdaddr, connection.address, sizeof(connection.address));
+    req.request.type = connection.isLowEnergy() ? 0x80 /* LE_LINK */ : ACL_LINK;
+
+    if (ioctl(fdDevice, HCIGETCONNINFO, &req) < 0)
+    {
+        GGK_DEBUG("Unable to get connection info for " << connection.addressString() << ": " << strerror(errno));
+        return;
+    }
+
+    connection.handle = req.request.conn_info->handle;
+
+    bool authenticated = (req.request.conn_info->link_mode & HCI_LM_AUTH) != 0;
+    bool encrypted = (req.request.conn_info->link_mode & HCI_LM_ENCRYPT) != 0;
+    if (authenticated && encrypted)
+    {
+        connection.securityLevel = HciConnection::ESecurityPaired;
+    }
+    else if (encrypted && connection.securityLevel < HciConnection::ESecurityEncrypted)
+    {
+        connection.securityLevel = HciConnection::ESecurityEncrypted;
+    }
+}
+
+// Adds a connection, looking up its handle and security level from the kernel
+void HciConnections::onConnected(const uint8_t address[6], uint8_t addressType)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    HciConnection connection;
+    memcpy(connection.address, address, sizeof(connection.address));
+    connection.addressType = addressType;
+    connection.handle = HciConnection::kInvalidHandle;
+    connection.connectTime = std::chrono::steady_clock::now();
+    connection.bytesServed = 0;
+    connection.securityLevel = HciConnection::ESecurityOpen;
+
+    queryConnectionInfo(connection);
+
+    connections[makeKey(address, addressType)] = connection;
+    GGK_DEBUG("  > Connection table: added " << connection.addressString() << " (handle " << connection.handle << "), "
+        << connections.size() << " connected");
+}
+
+// Removes a connection
+void HciConnections::onDisconnected(const uint8_t address[6], uint8_t addressType)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    connections.erase(makeKey(address, addressType));
+    GGK_DEBUG("  > Connection table: removed a connection, " << connections.size() << " connected");
+}
+
+// Marks a connection as paired (a new link or long term key was created for it)
+void HciConnections::onPaired(const uint8_t address[6], uint8_t addressType)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = connections.find(makeKey(address, addressType));
+    if (it != connections.end())
+    {
+        it->second.securityLevel = HciConnection::ESecurityPaired;
+    }
+}
+
+// Marks a connection as open (pairing or encryption with the peer failed)
+void HciConnections::onAuthenticationFailed(const uint8_t address[6], uint8_t addressType)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = connections.find(makeKey(address, addressType));
+    if (it != connections.end())
+    {
+        it->second.securityLevel = HciConnection::ESecurityOpen;
+    }
+}
+
+// Forgets every connection (when we lose track of the adapter's events)
+void HciConnections::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    connections.clear();
+}
+
+// Returns the number of connections
+size_t HciConnections::count() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return connections.size();
+}
+
+// Finds the connection to the given peer
+//
+// Returns true (and fills in `connection`) if found, otherwise false
+bool HciConnections::find(const uint8_t address[6], uint8_t addressType, HciConnection &connection) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = connections.find(makeKey(address, addressType));
+    if (it == connections.end())
+    {
+        return false;
+    }
+
+    connection = it->second;
+    return true;
+}
+
+// Finds the oldest LE connection, for callers that only expect a single central
+//
+// Returns true (and fills in `connection`) if there is one, otherwise false
+bool HciConnections::findFirstLowEnergy(HciConnection &connection) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bool found = false;
+    for (const auto &entry : connections)
+    {
+        if (entry.second.isLowEnergy() && (!found || entry.second.connectTime < connection.connectTime))
+        {
+            connection = entry.second;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+// Returns a copy of every connection
+std::vector<HciConnection> HciConnections::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<HciConnection> result;
+    result.reserve(connections.size());
+    for (const auto &entry : connections)
+    {
+        result.push_back(entry.second);
+    }
+
+    return result;
+}
+
+// Returns true if any LE connection isn't known to be paired
+bool HciConnections::hasUnpairedLowEnergy() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const auto &entry : connections)
+    {
+        if (entry.second.isLowEnergy() && entry.second.securityLevel != HciConnection::ESecurityPaired)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Asks the kernel for the security level of every LE connection that isn't known to be paired
+//
+// Returns true if any LE connection still isn't paired
+bool HciConnections::recheckUnpairedLowEnergy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bool unpaired = false;
+    for (auto &entry : connections)
+    {
+        if (!entry.second.isLowEnergy() || entry.second.securityLevel == HciConnection::ESecurityPaired)
+        {
+            continue;
+        }
+
+        queryConnectionInfo(entry.second);
+        unpaired = unpaired || entry.second.securityLevel != HciConnection::ESecurityPaired;
+    }
+
+    return unpaired;
+}
+
+// Adds to the byte count of the peer that made a method call
+//
+// `pDevicePath` is the BlueZ device object path from the call's options (may be nullptr). With a single connection we don't
+// need it.
+void HciConnections::addBytesServed(const char *pDevicePath, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (connections.empty())
+    {
+        return;
+    }
+
+    if (connections.size() == 1)
+    {
+        connections.begin()->second.bytesServed += bytes;
+        return;
+    }
+
+    // BlueZ device paths end in "dev_AA_BB_CC_DD_EE_FF"
+    const char *pDevice = pDevicePath != nullptr ? strstr(pDevicePath, "dev_") : nullptr;
+    unsigned int octets[6];
+    if (pDevice == nullptr || sscanf(pDevice, "dev_%2X_%2X_%2X_%2X_%2X_%2X", &octets[5], &octets[4], &octets[3], &octets[2],
+        &octets[1], &octets[0]) != 6)
+    {
+        return;
+    }
+
+    for (auto &entry : connections)
+    {
+        bool match = true;
+        for (int i = 0; i < 6 && match; ++i)
+        {
+            match = entry.second.address[i] == octets[i];
+        }
+
+        if (match)
+        {
+            entry.second.bytesServed += bytes;
+            return;
+        }
+    }
+}
+
+}; // namespace ggk
@@ -0,0 +1,152 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A table of the centrals currently connected to the adapter
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of HciConnections.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace ggk {
+
+// A single connection to a central
+struct HciConnection
+{
+    // How well the link is protected
+    enum SecurityLevel
+    {
+        ESecurityOpen,      // Neither authenticated nor encrypted
+        ESecurityEncrypted, // Encrypted, but not authenticated
+        ESecurityPaired     // Authenticated and encrypted (the peer is paired with us)
+    };
+
+    // A handle value that means "not known"
+    static const uint16_t kInvalidHandle = 0xffff;
+
+    uint8_t address[6];                                  // The peer's address (in the byte order used by mgmt events)
+    uint8_t addressType;                                 // 0 = BR/EDR, 1 = LE public, 2 = LE random
+    uint16_t handle;                                     // The HCI connection handle (or kInvalidHandle if unknown)
+    std::chrono::steady_clock::time_point connectTime;   // When the peer connected
+    uint64_t bytesServed;                                // Bytes sent to the peer in response to ReadValue calls
+    SecurityLevel securityLevel;                         // The last known security level of the link
+
+    // Returns true if this is an LE connection
+    bool isLowEnergy() const { return addressType != 0; }
+
+    // Returns the peer's address as a string (such as "AA:BB:CC:DD:EE:FF")
+    std::string addressString() const;
+};
+
+class HciConnections
+{
+public:
+
+    // Returns the instance to this singleton class
+    static HciConnections &getInstance()
+    {
+        static HciConnections instance;
+        return instance;
+    }
+
+    HciConnections(HciConnections const&) = delete;
+    void operator=(HciConnections const&) = delete;
+
+    //
+    // Event handlers (called from the HciAdapter event thread)
+    //
+
+    // Adds a connection, looking up its handle and security level from the kernel
+    void onConnected(const uint8_t address[6], uint8_t addressType);
+
+    // Removes a connection
+    void onDisconnected(const uint8_t address[6], uint8_t addressType);
+
+    // Marks a connection as paired (a new link or long term key was created for it)
+    void onPaired(const uint8_t address[6], uint8_t addressType);
+
+    // Marks a connection as open (pairing or encryption with the peer failed)
+    void onAuthenticationFailed(const uint8_t address[6], uint8_t addressType);
+
+    // Forgets every connection (when we lose track of the adapter's events)
+    void clear();
+
+    //
+    // Queries (any thread)
+    //
+
+    // Returns the number of connections
+    size_t count() const;
+
+    // Finds the connection to the given peer
+    //
+    // Returns true (and fills in `connection`) if found, otherwise false
+    bool find(const uint8_t address[6], uint8_t addressType, HciConnection &connection) const;
+
+    // Finds the oldest LE connection, for callers that only expect a single central
+    //
+    // Returns true (and fills in `connection`) if there is one, otherwise false
+    bool findFirstLowEnergy(HciConnection &connection) const;
+
+    // Returns a copy of every connection
+    std::vector<HciConnection> snapshot() const;
+
+    // Returns true if any LE connection isn't known to be paired
+    bool hasUnpairedLowEnergy() const;
+
+    // Asks the kernel for the security level of every LE connection that isn't known to be paired
+    //
+    // A bonded peer that reconnects encrypts the link with its existing keys, which raises no event we see. This costs an ioctl
+    // per connection, so only call it before acting on `hasUnpairedLowEnergy()`.
+    //
+    // Returns true if any LE connection still isn't paired
+    bool recheckUnpairedLowEnergy();
+
+    // Adds to the byte count of the peer that made a method call
+    //
+    // `pDevicePath` is the BlueZ device object path from the call's options (may be nullptr). With a single connection we don't
+    // need it.
+    void addBytesServed(const char *pDevicePath, size_t bytes);
+
+private:
+
+    HciConnections();
+    ~HciConnections();
+
+    // Returns the key for a peer in our table
+    static uint64_t makeKey(const uint8_t address[6], uint8_t addressType);
+
+    // Looks up the handle and security level of a connection from the kernel
+    //
+    // Callers must own `mutex`
+    void queryConnectionInfo(HciConnection &connection);
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, HciConnection> connections;
+
+    // A raw HCI socket bound to our device, kept open for connection info queries
+    int fdDevice;
+};
+
+}; // namespace ggk
@@ -23,6 +23,9 @@
 // (such as enabling LE, setting the device name, etc.) This class is used by HciAdapter (HciAdapter.h) to perform higher-level
 // functions.
 //
+// Reads block in epoll_wait() on a small reactor holding the socket and a shutdown eventfd (see `interrupt()`), so the event thread
+// sleeps until there is either data or a reason to stop. Other descriptors (raw HCI, L2CAP) can be added to the same epoll set.
+//
 // This code is for example purposes only. If you plan to use this in a production environment, I suggest rewriting it.
 //
 // The information for this implementation (as well as HciAdapter.h) came from:
@@ -34,17 +37,47 @@
 #include <bluetooth/hci.h>
 #include <thread>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "HciSocket.h"
+#include "HciTrace.h"
 #include "Logger.h"
 #include "Utils.h"
 
 namespace ggk {
 
 // Initializes an unconnected socket
+//
+// The epoll set and shutdown eventfd live as long as the socket object so that `interrupt()` can always reach a reader, even one
+// that is racing with `disconnect()`.
 HciSocket::HciSocket()
-: fdSocket(-1)
+: fdSocket(-1), fdEpoll(-1), fdShutdown(-1)
 {
+    fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (fdEpoll < 0)
+    {
+        logErrno("epoll_create1");
+    }
+
+    fdShutdown = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fdShutdown < 0)
+    {
+        logErrno("eventfd");
+    }
+
+    if (fdEpoll >= 0 && fdShutdown >= 0)
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fdShutdown;
+
+        if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdShutdown, &event) < 0)
+        {
+            logErrno("epoll_ctl(shutdown)");
+        }
+    }
 }
 
 // Socket destructor
@@ -53,6 +86,9 @@ HciSocket::HciSocket()
 HciSocket::~HciSocket()
 {
     disconnect();
+
+    if (fdShutdown >= 0) { close(fdShutdown); }
+    if (fdEpoll >= 0) { close(fdEpoll); }
 }
 
 // Connects to an HCI socket using the Bluetooth Management API protocol
@@ -82,6 +118,23 @@ bool HciSocket::connect()
         return false;
     }
 
+    // Clear any interruption left over from a previous connection
+    uint64_t count;
+    while (fdShutdown >= 0 && ::read(fdShutdown, &count, sizeof(count)) == sizeof(count)) {}
+
+    // Add the socket to our reactor (it is removed automatically when it is closed)
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fdSocket;
+
+    if (fdEpoll < 0 || epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdSocket, &event) < 0)
+    {
+        logErrno("Connect(epoll_ctl)");
+        disconnect();
+        return false;
+    }
+
     Logger::debug(SSTR << "Connected to HCI control socket (fd = " << fdSocket << ")");
 
     return true;
@@ -110,16 +163,32 @@ void HciSocket::disconnect()
     }
 }
 
-// Reads data from the HCI socket
+// Wakes any thread blocked in `read()` and makes it return false (and keep returning false until the next `connect()`)
 //
-// Raw data is read and returned in `response`.
+// This is safe to call from any thread
+void HciSocket::interrupt() const
+{
+    if (fdShutdown < 0)
+    {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (::write(fdShutdown, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        logErrno("write(shutdown)");
+    }
+}
+
+// Reads a packet from the HCI socket into `pBuffer` (which holds `bufferSize` bytes) and sets `bytesRead` to its length
+//
+// The caller owns the buffer, so it can be reused from one read to the next without any allocation.
 //
 // Returns true if data was read successfully, otherwise false is returned. A false return code does not necessarily depict
 // an error, as this can arise from expected conditions (such as an interrupt.)
-bool HciSocket::read(std::vector<uint8_t> &response) const
+bool HciSocket::read(uint8_t *pBuffer, size_t bufferSize, size_t &bytesRead) const
 {
-    // Fill our response with empty data
-    response.resize(kResponseMaxSize, 0);
+    bytesRead = 0;
 
     // Wait for data or a cancellation
     if (!waitForDataOrShutdown())
@@ -128,10 +197,10 @@ bool HciSocket::read(std::vector<uint8_t> &response) const
     }
 
     // Block until we receive data, a disconnect, or a signal
-    ssize_t bytesRead = ::recv(fdSocket, &response[0], kResponseMaxSize, MSG_WAITALL);
+    ssize_t result = ::recv(fdSocket, pBuffer, bufferSize, MSG_WAITALL);
 
-    // If there was an error, wipe the data and return an error condition
-    if (bytesRead < 0)
+    // If there was an error, return an error condition
+    if (result < 0)
     {
         if (errno == EINTR)
         {
@@ -141,23 +210,26 @@ bool HciSocket::read(std::vector<uint8_t> &response) const
         {
             logErrno("recv");
         }
-        response.resize(0);
         return false;
     }
-    else if (bytesRead == 0)
+    else if (result == 0)
     {
         Logger::error("Peer closed the socket");
-        response.resize(0);
         return false;
     }
 
     // We have data
-    response.resize(bytesRead);
+    bytesRead = static_cast<size_t>(result);
 
-    std::string dump = "";
-    dump += "  > Read " + std::to_string(response.size()) + " bytes\n";
-    dump += Utils::hex(response.data(), response.size());
-    Logger::debug(dump);
+    // Trace the packet in binary if we're tracing, otherwise (expensively) hex dump it to the debug log
+    if (HciTrace::isEnabled())
+    {
+        HciTrace::record(HciTrace::EEvent, pBuffer, bytesRead);
+    }
+    else
+    {
+        GGK_DEBUG("  > Read " << bytesRead << " bytes\n" << Utils::hex(pBuffer, bytesRead));
+    }
 
     return true;
 }
@@ -175,10 +247,14 @@ bool HciSocket::write(std::vector<uint8_t> buffer) const
 // This method returns true if the bytes were written successfully, otherwise false
 bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
 {
-    std::string dump = "";
-    dump += "  > Writing " + std::to_string(count) + " bytes\n";
-    dump += Utils::hex(pBuffer, count);
-    Logger::debug(dump);
+    if (HciTrace::isEnabled())
+    {
+        HciTrace::record(HciTrace::ECommand, pBuffer, count);
+    }
+    else
+    {
+        GGK_DEBUG("  > Writing " << count << " bytes\n" << Utils::hex(pBuffer, count));
+    }
 
     size_t len = ::write(fdSocket, pBuffer, count);
 
@@ -193,32 +269,48 @@ bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
 
 // Wait for data to arrive, or for a shutdown event
 //
+// We block in epoll_wait() without a timeout, so the event thread costs nothing while idle. A shutdown wakes us via `interrupt()`.
+// A shutdown takes priority over any data that arrived at the same time.
+//
 // Returns true if data is available, false if we are shutting down
 bool HciSocket::waitForDataOrShutdown() const
 {
-    while(ggkIsServerRunning())
+    if (fdEpoll < 0)
     {
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(fdSocket, &rfds);
+        return false;
+    }
 
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = kDataWaitTimeMS * 1000;
+    for (;;)
+    {
+        struct epoll_event events[2];
+        int count = epoll_wait(fdEpoll, events, 2, -1);
 
-        int retval = select(fdSocket+1, &rfds, NULL, NULL, &tv);
+        if (count < 0)
+        {
+            // Signals aren't a reason to stop waiting
+            if (errno == EINTR) { continue; }
 
-        // Do we have data?
-        if (retval > 0) { return true; }
+            logErrno("epoll_wait");
+            return false;
+        }
 
-        // We have an error
-        if (retval < 0) { return false; }
+        bool dataReady = false;
+        for (int i = 0; i < count; ++i)
+        {
+            if (events[i].data.fd == fdShutdown)
+            {
+                Logger::trace("HciSocket wait interrupted for shutdown");
+                return false;
+            }
+
+            if (events[i].data.fd == fdSocket)
+            {
+                dataReady = true;
+            }
+        }
 
-        // No data; keep waiting
-        continue;
+        if (dataReady) { return true; }
     }
-
-    return false;
 }
 
 // Utilitarian function for logging errors for the given operation
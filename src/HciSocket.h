@@ -50,13 +50,21 @@ public:
     // Disconnects from the HCI socket
     void disconnect();
 
-    // Reads data from the HCI socket
+    // Wakes any thread blocked in `read()` and makes it return false (and keep returning false until the next `connect()`)
     //
-    // Raw data is read until no more data is available. If no data is available when this method initially starts to read, it will
-    // retry for a maximum timeout defined by `kMaxRetryTimeMS`.
+    // This is safe to call from any thread
+    void interrupt() const;
+
+    // The largest packet we will read from the socket (see `read()`)
+    static const size_t kResponseMaxSize = 64 * 1024;
+
+    // Reads a packet from the HCI socket into `pBuffer` (which holds `bufferSize` bytes) and sets `bytesRead` to its length
+    //
+    // Blocks until data is available or until `interrupt()` is called. The caller owns the buffer, so it can be reused from one read
+    // to the next; a buffer of `kResponseMaxSize` bytes will hold any packet.
     //
-    // Returns true if any data was read successfully, otherwise false is returned in the case of an error or a timeout.
-    bool read(std::vector<uint8_t> &response) const;
+    // Returns true if any data was read successfully, otherwise false is returned in the case of an error or an interruption.
+    bool read(uint8_t *pBuffer, size_t bufferSize, size_t &bytesRead) const;
 
     // Writes the array of bytes of a given count
     //
@@ -80,8 +88,9 @@ private:
 
     int fdSocket;
 
-    const size_t kResponseMaxSize = 64 * 1024;
-    const int kDataWaitTimeMS = 10;
+    // Our reactor: an epoll set containing the socket and `fdShutdown`, an eventfd that `interrupt()` signals
+    int fdEpoll;
+    int fdShutdown;
 };
 
 }; // namespace ggk
@@ -0,0 +1,236 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Binary packet tracing for the Bluetooth Management API socket (see HciSocket.cpp)
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Hex dumping every management packet into the debug log is expensive and hard to read. Instead, when tracing is enabled, every
+// packet sent or received by HciSocket is written to a file in btsnoop format, which can be read with `btmon -r <file>` or
+// Wireshark.
+//
+// We use the Linux monitor datalink (the same one `btmon -w` writes.) Management commands and events are recorded as
+// "control command" and "control event" monitor packets, with the controller index carried in the record flags.
+//
+// The trace is a simple two-file ring: once the current file would grow past its size limit, it is renamed to `<filename>.1`
+// (replacing the previous one) and a fresh file is started. This bounds the disk usage to roughly twice the limit.
+//
+// While tracing is disabled, the packet path only pays for a single relaxed atomic load (see `HciTrace::isEnabled()`.)
+//
+// The file and record layouts match BlueZ's own btsnoop writer (src/shared/btsnoop.c in the BlueZ tree.)
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#include <mutex>
+
+#include "HciTrace.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// btsnoop file header: identification pattern, version and datalink type
+static const uint8_t kBtsnoopId[8] = { 'b', 't', 's', 'n', 'o', 'o', 'p', 0 };
+static const uint32_t kBtsnoopVersion = 1;
+static const uint32_t kBtsnoopDatalinkMonitor = 2001;
+
+// Monitor opcodes for management traffic
+static const uint16_t kMonitorCtrlCommand = 16;
+static const uint16_t kMonitorCtrlEvent = 17;
+
+// Microseconds between 0000-01-01 (the btsnoop epoch) and 1970-01-01
+static const uint64_t kBtsnoopEpochDelta = 0x00dcddb30f2f8000ULL;
+
+// Size of a management packet header (code, controller index, data size)
+static const size_t kMgmtHeaderSize = 6;
+
+struct BtsnoopFileHeader
+{
+    uint8_t id[8];
+    uint32_t version;
+    uint32_t datalink;
+} __attribute__((packed));
+
+struct BtsnoopRecordHeader
+{
+    uint32_t originalLength;
+    uint32_t includedLength;
+    uint32_t flags;
+    uint32_t drops;
+    uint64_t timestamp;
+} __attribute__((packed));
+
+std::atomic<bool> HciTrace::enabled(false);
+
+// Trace file state, owned by `traceMutex`
+static std::mutex traceMutex;
+static int traceFd = -1;
+static std::string traceFilename;
+static size_t traceMaxFileBytes = 0;
+static size_t traceFileBytes = 0;
+static uint32_t traceDrops = 0;
+
+// Closes the current trace file (if any)
+//
+// Callers must own `traceMutex`
+static void closeTraceFile()
+{
+    if (traceFd >= 0)
+    {
+        close(traceFd);
+        traceFd = -1;
+    }
+}
+
+// Opens (truncating) the trace file and writes the btsnoop file header
+//
+// Callers must own `traceMutex`
+static bool openTraceFile()
+{
+    traceFd = open(traceFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (traceFd < 0)
+    {
+        Logger::error(SSTR << "Unable to open HCI trace file '" << traceFilename << "': " << strerror(errno));
+        return false;
+    }
+
+    BtsnoopFileHeader header;
+    memcpy(header.id, kBtsnoopId, sizeof(header.id));
+    header.version = htobe32(kBtsnoopVersion);
+    header.datalink = htobe32(kBtsnoopDatalinkMonitor);
+
+    if (::write(traceFd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)))
+    {
+        Logger::error(SSTR << "Unable to write HCI trace file header to '" << traceFilename << "'");
+        closeTraceFile();
+        return false;
+    }
+
+    traceFileBytes = sizeof(header);
+    return true;
+}
+
+// Starts tracing to `filename`, replacing any trace already in progress
+//
+// When the file would grow past `maxFileBytes`, it is moved to `<filename>.1` and a new file is started.
+//
+// Returns true on success, otherwise false
+bool HciTrace::start(const std::string &filename, size_t maxFileBytes)
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    enabled.store(false, std::memory_order_relaxed);
+    closeTraceFile();
+
+    traceFilename = filename;
+    traceMaxFileBytes = maxFileBytes;
+    traceDrops = 0;
+
+    if (!openTraceFile())
+    {
+        return false;
+    }
+
+    Logger::status(SSTR << "Tracing HCI management packets to '" << traceFilename << "'");
+    enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// Stops tracing and closes the trace file
+void HciTrace::stop()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    enabled.store(false, std::memory_order_relaxed);
+    closeTraceFile();
+}
+
+// Writes a single management packet (header included) to the trace file
+void HciTrace::record(Direction direction, const uint8_t *pPacket, size_t count)
+{
+    if (count < kMgmtHeaderSize)
+    {
+        return;
+    }
+
+    // A monitor control packet is a cookie, the management code and its parameters (the controller index moves to the flags)
+    uint32_t cookie = 0;
+    // The packet buffer carries no alignment guarantee, so copy the field out rather than dereferencing it in place
+    uint16_t controllerIndex;
+    memcpy(&controllerIndex, pPacket + 2, sizeof(controllerIndex));
+    controllerIndex = le16toh(controllerIndex);
+    uint16_t opcode = direction == ECommand ? kMonitorCtrlCommand : kMonitorCtrlEvent;
+    uint32_t payloadLength = sizeof(cookie) + 2 + (count - kMgmtHeaderSize);
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    uint64_t timestamp = static_cast<uint64_t>(tv.tv_sec) * 1000000ULL + static_cast<uint64_t>(tv.tv_usec) + kBtsnoopEpochDelta;
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    if (traceFd < 0)
+    {
+        return;
+    }
+
+    BtsnoopRecordHeader header;
+    header.originalLength = htobe32(payloadLength);
+    header.includedLength = htobe32(payloadLength);
+    header.flags = htobe32((static_cast<uint32_t>(controllerIndex) << 16) | opcode);
+    header.drops = htobe32(traceDrops);
+    header.timestamp = htobe64(timestamp);
+
+    size_t recordSize = sizeof(header) + payloadLength;
+
+    // Rotate if this record would push us over the limit (but always allow at least one record per file)
+    if (traceMaxFileBytes != 0 && traceFileBytes > sizeof(BtsnoopFileHeader) && traceFileBytes + recordSize > traceMaxFileBytes)
+    {
+        closeTraceFile();
+        std::string previous = traceFilename + ".1";
+        rename(traceFilename.c_str(), previous.c_str());
+
+        if (!openTraceFile())
+        {
+            enabled.store(false, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    struct iovec iov[4];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = &cookie;
+    iov[1].iov_len = sizeof(cookie);
+    iov[2].iov_base = const_cast<uint8_t *>(pPacket);
+    iov[2].iov_len = 2;
+    iov[3].iov_base = const_cast<uint8_t *>(pPacket + kMgmtHeaderSize);
+    iov[3].iov_len = count - kMgmtHeaderSize;
+
+    if (writev(traceFd, iov, 4) != static_cast<ssize_t>(recordSize))
+    {
+        traceDrops += 1;
+        return;
+    }
+
+    traceFileBytes += recordSize;
+}
+
+}; // namespace ggk
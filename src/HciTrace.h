@@ -0,0 +1,64 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Binary packet tracing for the Bluetooth Management API socket (see HciSocket.cpp)
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of HciTrace.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+namespace ggk {
+
+struct HciTrace
+{
+    // Direction of a traced packet
+    enum Direction
+    {
+        ECommand, // Host -> controller
+        EEvent    // Controller -> host
+    };
+
+    // Starts tracing to `filename`, replacing any trace already in progress
+    //
+    // When the file would grow past `maxFileBytes`, it is moved to `<filename>.1` and a new file is started.
+    //
+    // Returns true on success, otherwise false
+    static bool start(const std::string &filename, size_t maxFileBytes);
+
+    // Stops tracing and closes the trace file
+    static void stop();
+
+    // Returns true if tracing is enabled
+    //
+    // This is the only cost paid on the packet path while tracing is disabled
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Writes a single management packet (header included) to the trace file
+    static void record(Direction direction, const uint8_t *pPacket, size_t count);
+
+private:
+
+    static std::atomic<bool> enabled;
+};
+
+}; // namespace ggk
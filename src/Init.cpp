@@ -33,6 +33,11 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <gio/gio.h>
+#include <glib-unix.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include <atomic>
@@ -49,6 +54,7 @@
 #include "GattProperty.h"
 #include "Logger.h"
 #include "Init.h"
+#include "WorkerPool.h"
 
 namespace ggk {
 
@@ -58,7 +64,6 @@ namespace ggk {
 
 static const int kPeriodicTimerFrequencySeconds = 1;
 static const int kRetryDelaySeconds = 2;
-static const int kIdleFrequencyMS = 10;
 
 //
 // Retries
@@ -75,6 +80,10 @@ static guint ownedNameId = 0;
 static guint periodicTimeoutId = 0;
 static std::vector<guint> registeredObjectIds;
 static std::atomic<GMainLoop *> pMainLoop(nullptr);
+static std::atomic<int> updateQueueEventFd(-1);
+static std::atomic<bool> updateQueueWakePending(false);
+static std::atomic<int> updateQueueWakers(0);
+static guint updateQueueSourceId = 0;
 static GDBusObjectManager *pBluezObjectManager = nullptr;
 static GDBusObject *pBluezAdapterObject = nullptr;
 static GDBusObject *pBluezDeviceObject = nullptr;
@@ -108,72 +117,127 @@ static void initializationStateProcessor();
 // |___\__,_|_|\___| /_/     \__,_|\__,_|\__\__,_|  | .__/|_|  \___/ \___\___||___/___/_|_| |_|\__, |
 //                                                  |_|                                        |___/
 //
-// Our idle funciton is what processes data updates. We handle this in a simple way. We update the data directly in our global
+// Our update processor is what processes data updates. We handle this in a simple way. We update the data directly in our global
 // `TheServer` object, then call `ggkPushUpdateQueue` to trigger that data to be updated (in whatever way the service responsible
 // for that data() sees fit.
 //
 // This is done using the `ggkPushUpdateQueue` / `ggkPopUpdateQueue` methods to manage the queue of pending update messages. Each
-// entry represents an interface that needs to be updated. The idleFunc calls the interface's `onUpdatedValue` method for each
-// update.
+// entry represents an interface that needs to be updated. Code that already holds a characteristic (such as a service plugin)
+// can use `pushUpdateQueue` instead, which queues the characteristic itself so no path lookup is needed to process it. The update
+// processor calls the interface's `onUpdatedValue` method for each update.
 //
-// The idle processor will perform one update per idle tick, however, it will notify that there is more data so the idle ticks
-// do not lag behind.
+// The main loop does not poll the queue. Instead, `ggkPushUpdateQueue` signals an eventfd (see `wakeUpdateQueue`) which is
+// watched by the main loop. When the eventfd becomes readable, the main loop takes a batch of updates (up to the budget set by
+// `ggkSetUpdateQueueBudget`) and processes them in a single pass, so that the loop is fully idle when there is nothing to do
+// and updates are dispatched as soon as they arrive.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Our idle function
+// Wake the main loop so that it processes the update queue
+//
+// This method is thread-safe and may be called from any thread. If the main loop is not yet running, the call is ignored; any
+// updates queued before then are processed once the server reaches the `ERunning` state.
+//
+// Only the first wake after the main loop has looked at the queue writes to the eventfd: `updateQueueWakePending` stays set until
+// `onUpdateQueueReady` clears it, and the main loop clears it before taking its batch, so an update queued after that always
+// wakes it again. A burst of updates costs a single write.
+//
+// No lock is taken. Instead, each writer is counted in `updateQueueWakers` from before it loads the eventfd until after it has
+// written to it, and `uninit` waits for that count to reach zero before it closes the eventfd, so the descriptor can't be closed
+// (and its number reused by something else) between the load and the write.
+void wakeUpdateQueue()
+{
+    if (updateQueueWakePending.exchange(true))
+    {
+        return;
+    }
+
+    updateQueueWakers += 1;
+    int fd = updateQueueEventFd;
+    if (fd < 0)
+    {
+        // Nobody will clear the flag, so don't leave it set
+        updateQueueWakePending = false;
+    }
+    else
+    {
+        uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        {
+            Logger::warn(SSTR << "Unable to wake the update queue: " << strerror(errno));
+        }
+    }
+    updateQueueWakers -= 1;
+}
+
+// Process a single update from the update queue
 //
 // This method is used to process data on the same thread as our main loop. This allows us to communicate with our service from
 // the outside.
-//
-// IMPORTANT: This method must return 'true' if any work was performed, otherwise it must return 'false'. Returning 'true' will
-// cause the idle loop to continue to call this method to process data at the maximum rate (which can peg the CPU at 100%.) By
-// returning false when there is no work to do, we are nicer to the system.
-bool idleFunc(void *pUserData)
+static void processUpdate(const QueueEntry &entry, void *pUserData)
 {
+    // Entries from the fast path already know their characteristic
+    if (nullptr != entry.pCharacteristic)
+    {
+        entry.pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
+        return;
+    }
 
-    // Don't do anything unless we're running
-    if (ggkGetServerRunState() != ERunning)
+    // We have an update - call the onUpdatedValue method on the interface
+    DBusObjectPath objectPath(entry.objectPath);
+    std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(objectPath, entry.interfaceName);
+    if (nullptr == pInterface)
     {
-        return false;
+        Logger::warn(SSTR << "Unable to find interface for update: path[" << objectPath << "], name[" << entry.interfaceName << "]");
+        return;
     }
 
-    // Try to get an update
-    const int kQueueEntryLen = 1024;
-    char queueEntry[kQueueEntryLen];
-    if (ggkPopUpdateQueue(queueEntry, kQueueEntryLen, 0) != 1)
+    // Is it a characteristic?
+    if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
     {
-        return false;
+        GGK_DEBUG("Processing updated value for interface '" << entry.interfaceName << "' at path '" << objectPath << "'");
+        pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
     }
+}
 
-    std::string entryString = queueEntry;
-    auto token = entryString.find('|');
-    if (token == std::string::npos)
+// Main loop handler for the update queue's eventfd
+//
+// Resets the eventfd counter, then takes a batch of entries from the queue under a single lock and processes them in one pass. If
+// the batch was limited by the per-pass budget, we wake ourselves again so the rest is processed on the next pass, after any other
+// pending main loop work (such as D-Bus method calls) has had its turn. The source always remains installed.
+gboolean onUpdateQueueReady(gint fd, GIOCondition condition, gpointer pUserData)
+{
+    (void) condition; // UNUSED
+
+    uint64_t counter;
+    if (read(fd, &counter, sizeof(counter)) < 0 && errno != EAGAIN)
     {
-        Logger::error("Queue entry was not formatted properly - could not find separating token");
-        return false;
+        Logger::warn(SSTR << "Unable to read the update queue eventfd: " << strerror(errno));
     }
 
-    DBusObjectPath objectPath = DBusObjectPath(entryString.substr(0, token));
-    std::string interfaceName = entryString.substr(token+1);
+    // From here on, a new update must wake us again (see `wakeUpdateQueue`)
+    updateQueueWakePending.exchange(false);
 
-    // We have an update - call the onUpdatedValue method on the interface
-    std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(objectPath, interfaceName);
-    if (nullptr == pInterface)
+    // Don't do anything unless we're running
+    if (ggkGetServerRunState() != ERunning)
     {
-        Logger::warn(SSTR << "Unable to find interface for update: path[" << objectPath << "], name[" << interfaceName << "]");
+        return TRUE;
     }
-    else
+
+    std::deque<QueueEntry> batch;
+    bool moreQueued = takeUpdateQueueBatch(batch);
+
+    // The oldest entries are at the back
+    for (auto it = batch.rbegin(); it != batch.rend(); ++it)
     {
-        // Is it a characteristic?
-        if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
-        {
-            Logger::debug(SSTR << "Processing updated value for interface '" << interfaceName << "' at path '" << objectPath << "'");
-            pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
-            return true;
-        }
+        processUpdate(*it, pUserData);
+    }
+
+    if (moreQueued)
+    {
+        wakeUpdateQueue();
     }
 
-    return false;
+    return TRUE;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -249,6 +313,25 @@ void uninit()
         periodicTimeoutId = 0;
     }
 
+    if (0 != updateQueueSourceId)
+    {
+        g_source_remove(updateQueueSourceId);
+        updateQueueSourceId = 0;
+    }
+
+    // Producers may still be calling `wakeUpdateQueue` from other threads. Once the eventfd is retired no new writer can load it,
+    // so it can be closed as soon as the writers that already have it are done.
+    int fd = updateQueueEventFd.exchange(-1);
+    if (fd >= 0)
+    {
+        while (updateQueueWakers != 0)
+        {
+            std::this_thread::yield();
+        }
+        close(fd);
+    }
+    updateQueueWakePending = false;
+
     if (ownedNameId > 0)
     {
         g_bus_unown_name(ownedNameId);
@@ -409,27 +492,32 @@ GVariant *onGetProperty
 
     const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
 
-    std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+    // Describes the property for our logs and errors (only built when needed)
+    auto propertyPath = [&]()
+    {
+        return std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+    };
+
     if (!pProperty)
     {
-        Logger::error(SSTR << "Property(get) not found: " << propertyPath);
-        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) not found: " + propertyPath).c_str(), pSender);
+        Logger::error(SSTR << "Property(get) not found: " << propertyPath());
+        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) not found: " + propertyPath()).c_str(), pSender);
         return nullptr;
     }
 
     if (!pProperty->getGetterFunc())
     {
-        Logger::error(SSTR << "Property(get) func not found: " << propertyPath);
-        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) func not found: " + propertyPath).c_str(), pSender);
+        Logger::error(SSTR << "Property(get) func not found: " << propertyPath());
+        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) func not found: " + propertyPath()).c_str(), pSender);
         return nullptr;
     }
 
-    Logger::info(SSTR << "Calling property getter: " << propertyPath);
+    GGK_INFO("Calling property getter: " << propertyPath());
     GVariant *pResult = pProperty->getGetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, ppError, pUserData);
 
     if (nullptr == pResult)
     {
-        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) failed: " + propertyPath).c_str(), pSender);
+        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) failed: " + propertyPath()).c_str(), pSender);
         return nullptr;
     }
 
@@ -454,25 +542,30 @@ gboolean onSetProperty
 
     const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
 
-    std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+    // Describes the property for our logs and errors (only built when needed)
+    auto propertyPath = [&]()
+    {
+        return std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+    };
+
     if (!pProperty)
     {
-        Logger::error(SSTR << "Property(set) not found: " << propertyPath);
-        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) not found: " + propertyPath).c_str(), pSender);
+        Logger::error(SSTR << "Property(set) not found: " << propertyPath());
+        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) not found: " + propertyPath()).c_str(), pSender);
         return false;
     }
 
     if (!pProperty->getSetterFunc())
     {
-        Logger::error(SSTR << "Property(set) func not found: " << propertyPath);
-        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) func not found: " + propertyPath).c_str(), pSender);
+        Logger::error(SSTR << "Property(set) func not found: " << propertyPath());
+        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) func not found: " + propertyPath()).c_str(), pSender);
         return false;
     }
 
-    Logger::info(SSTR << "Calling property getter: " << propertyPath);
+    GGK_INFO("Calling property setter: " << propertyPath());
     if (!pProperty->getSetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, pValue, ppError, pUserData))
     {
-        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) failed: " + propertyPath).c_str(), pSender);
+        g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) failed: " + propertyPath()).c_str(), pSender);
         return false;
     }
 
@@ -669,6 +762,7 @@ void registerObjects()
 // See also: https://git.kernel.org/pub/scm/bluetooth/bluez.git/tree/doc/mgmt-api.txt
 void configureAdapter()
 {
+    auto startTime = std::chrono::steady_clock::now();
     Mgmt mgmt;
 
     // Get our properly truncated advertising names
@@ -699,11 +793,16 @@ void configureAdapter()
             if (!mgmt.setPowered(false)) { setRetry(); return; }
         }
 
+        // Everything between powering off and back on is sent as a single pipelined batch. While the adapter is powered off, the
+        // kernel applies these settings in the order they arrive, so we don't need to wait for each response before sending the next.
+        mgmt.beginBatch();
+        bool sent = true;
+
         // Enable the LE state (we always set this state if it's not set)
         if (!leFlag)
         {
             Logger::debug("Enabling LE");
-            if (!mgmt.setLE(true)) { setRetry(); return; }
+            sent = mgmt.setLE(true) && sent;
         }
 
         // Change the Br/Edr state?
@@ -712,57 +811,61 @@ void configureAdapter()
         if (!brFlag)
         {
             Logger::debug(SSTR << (TheServer->getEnableBREDR() ? "Enabling":"Disabling") << " BR/EDR");
-            if (!mgmt.setBredr(TheServer->getEnableBREDR())) { setRetry(); return; }
+            sent = mgmt.setBredr(TheServer->getEnableBREDR()) && sent;
         }
 
         // Change the Secure Connectinos state?
         if (!scFlag)
         {
             Logger::debug(SSTR << (TheServer->getEnableSecureConnection() ? "Enabling":"Disabling") << " Secure Connections");
-            if (!mgmt.setSecureConnections(TheServer->getEnableSecureConnection() ? 1 : 0)) { setRetry(); return; }
+            sent = mgmt.setSecureConnections(TheServer->getEnableSecureConnection() ? 1 : 0) && sent;
         }
 
         // Change the Bondable state?
         if (!bnFlag)
         {
             Logger::debug(SSTR << (TheServer->getEnableBondable() ? "Enabling":"Disabling") << " Bondable");
-            if (!mgmt.setBondable(TheServer->getEnableBondable())) { setRetry(); return; }
+            sent = mgmt.setBondable(TheServer->getEnableBondable()) && sent;
         }
 
         // Change the Connectable state?
         if (!cnFlag)
         {
             Logger::debug(SSTR << (TheServer->getEnableConnectable() ? "Enabling":"Disabling") << " Connectable");
-            if (!mgmt.setConnectable(TheServer->getEnableConnectable())) { setRetry(); return; }
+            sent = mgmt.setConnectable(TheServer->getEnableConnectable()) && sent;
         }
 
         // Change the Discoverable state?
         if (!diFlag)
         {
             Logger::debug(SSTR << (TheServer->getEnableDiscoverable() ? "Enabling":"Disabling") << " Discoverable");
-            if (!mgmt.setDiscoverable(TheServer->getEnableDiscoverable() ? 1 : 0, 0)) { setRetry(); return; }
+            sent = mgmt.setDiscoverable(TheServer->getEnableDiscoverable() ? 1 : 0, 0) && sent;
         }
 
         // Change the Advertising state?
         if (!adFlag)
         {
             Logger::debug(SSTR << (TheServer->getEnableAdvertising() ? "Enabling":"Disabling") << " Advertising");
-            if (!mgmt.setAdvertising(TheServer->getEnableAdvertising() ? 1 : 0)) { setRetry(); return; }
+            sent = mgmt.setAdvertising(TheServer->getEnableAdvertising() ? 1 : 0) && sent;
         }
 
         // Set the name?
         if (!anFlag)
         {
             Logger::info(SSTR << "Setting advertising name to '" << advertisingName << "' (with short name: '" << advertisingShortName << "')");
-            if (!mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str())) { setRetry(); return; }
+            sent = mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str()) && sent;
         }
 
+        if (!mgmt.endBatch() || !sent) { setRetry(); return; }
+
         // Turn it back on
         Logger::debug("Powering on");
         if (!mgmt.setPowered(true)) { setRetry(); return; }
     }
 
     Logger::info("The Bluetooth adapter is fully configured");
+    GGK_DEBUG("  + Adapter configuration took " << std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count() << "ms");
 
     // We're all set, nothing to do!
     bAdapterConfigured = true;
@@ -1123,6 +1226,9 @@ void initializationStateProcessor()
 
     // Successful initialization - switch to running state
     setServerRunState(ERunning);
+
+    // Process anything that was queued while we were initializing
+    wakeUpdateQueue();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -1158,29 +1264,23 @@ void runServerThread()
     Logger::debug(SSTR << "Creating GLib main loop");
     pMainLoop = g_main_loop_new(NULL, FALSE);
 
-    // Add the idle function
+    // Watch the update queue
     //
-    // Note that we actually run the idle function from a lambda. This allows us to manage the inter-idle sleep so we don't
-    // soak up 100% of our CPU.
-    guint res = g_idle_add
-    (
-        [](gpointer pUserData) -> gboolean
-        {
-            // Try to process some data and if no data is processed, sleep for the requested frequency
-            if (!idleFunc(pUserData))
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(kIdleFrequencyMS));
-            }
-
-            // Always return TRUE so our idle remains in tact
-            return TRUE;
-        },
-        nullptr
-    );
-
-    if (res == 0)
+    // Producers signal an eventfd when they push onto the update queue (see `wakeUpdateQueue`.) We watch that eventfd from the
+    // main loop rather than polling from an idle function, so the loop sleeps until there is actually work to do.
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0)
     {
-        Logger::error(SSTR << "Unable to add idle to main loop");
+        Logger::error(SSTR << "Unable to create the update queue eventfd: " << strerror(errno));
+    }
+    else
+    {
+        updateQueueEventFd = fd;
+        updateQueueSourceId = g_unix_fd_add(fd, G_IO_IN, onUpdateQueueReady, nullptr);
+        if (updateQueueSourceId == 0)
+        {
+            Logger::error(SSTR << "Unable to add the update queue watch to main loop");
+        }
     }
 
     Logger::trace(SSTR << "Starting GLib main loop");
@@ -1190,6 +1290,16 @@ void runServerThread()
     setServerRunState(EStopped);
     Logger::info("GGK server stopped");
 
+    // The HciAdapter's event thread blocks until it is told to stop, so make sure it is stopped however we got here
+    HciAdapter::getInstance().stop();
+
+    // Async characteristic handlers can no longer be completed, so let those in progress finish and fail the rest
+    WorkerPool::getInstance().stop();
+    GattCharacteristic::cancelAsyncCalls();
+
+    // Join the service plugins' own threads while the server they use still exists
+    TheServer->stopServicePlugins();
+
     // Cleanup
     uninit();
 }
@@ -22,8 +22,42 @@
 
 #pragma once
 
+#include <string>
+#include <tuple>
+#include <deque>
+
 namespace ggk {
 
+struct GattCharacteristic;
+
+// An entry in the update queue
+//
+// Entries queued through the internal fast path (see `pushUpdateQueue()`) carry a pre-resolved characteristic and need no string
+// handling or tree search. Entries queued through the C API (see `ggkPushUpdateQueue()`) carry the object path and interface name,
+// which are resolved when the entry is processed.
+struct QueueEntry
+{
+    explicit QueueEntry(const GattCharacteristic &characteristic)
+    : pCharacteristic(&characteristic)
+    {
+    }
+
+    QueueEntry(const std::string &objectPath, const std::string &interfaceName)
+    : pCharacteristic(nullptr), objectPath(objectPath), interfaceName(interfaceName)
+    {
+    }
+
+    bool operator<(const QueueEntry &rhs) const
+    {
+        return std::tie(pCharacteristic, objectPath, interfaceName) < std::tie(rhs.pCharacteristic, rhs.objectPath, rhs.interfaceName);
+    }
+
+    // The pre-resolved characteristic, or nullptr if this entry must be resolved from `objectPath` and `interfaceName`
+    const GattCharacteristic *pCharacteristic;
+    std::string objectPath;
+    std::string interfaceName;
+};
+
 // Trigger a graceful, asynchronous shutdown of the server
 //
 // This method is non-blocking and as such, will only trigger the shutdown process but not wait for it
@@ -34,4 +68,25 @@ void shutdown();
 // This method should not be called directly, instead, direct your attention over to `ggkStart()`
 void runServerThread();
 
+// Wake the main loop so that it processes the update queue
+//
+// This method is thread-safe; it is called by `ggkPushUpdateQueue()` each time an update is queued
+void wakeUpdateQueue();
+
+// Takes a batch of entries from the update queue under a single lock
+//
+// At most one pass' budget of entries (see `ggkSetUpdateQueueBudget()`) is moved into `batch`, keeping the queue's ordering (the
+// oldest entry is at the back.)
+//
+// Returns true if entries remain on the queue after the batch was taken
+bool takeUpdateQueueBatch(std::deque<QueueEntry> &batch);
+
+// Adds an update for a characteristic to the front of the queue
+//
+// This is the fast path equivalent of `ggkNofifyUpdatedCharacteristic()` for code that already holds the characteristic (such as
+// a service plugin's callbacks.) It is thread-safe.
+//
+// Returns non-zero value on success or 0 on failure.
+int pushUpdateQueue(const GattCharacteristic &characteristic);
+
 }; // namespace ggk
\ No newline at end of file
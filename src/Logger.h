@@ -32,6 +32,21 @@ namespace ggk {
 // Our handy stringstream macro
 #define SSTR std::ostringstream().flush()
 
+// Level-check-first logging
+//
+// These check that a receiver is registered for the log level before the message is built. When the level is disabled, nothing
+// that is streamed into the message is evaluated, so they cost next to nothing on hot paths. Usage:
+//
+//     GGK_DEBUG("Calling method: [" << path << "]:[" << interfaceName << "]");
+#define GGK_DEBUG(message)  do { if (ggk::Logger::isDebugEnabled())  { ggk::Logger::debug(SSTR << message); } } while (0)
+#define GGK_INFO(message)   do { if (ggk::Logger::isInfoEnabled())   { ggk::Logger::info(SSTR << message); } } while (0)
+#define GGK_STATUS(message) do { if (ggk::Logger::isStatusEnabled()) { ggk::Logger::status(SSTR << message); } } while (0)
+#define GGK_WARN(message)   do { if (ggk::Logger::isWarnEnabled())   { ggk::Logger::warn(SSTR << message); } } while (0)
+#define GGK_ERROR(message)  do { if (ggk::Logger::isErrorEnabled())  { ggk::Logger::error(SSTR << message); } } while (0)
+#define GGK_FATAL(message)  do { if (ggk::Logger::isFatalEnabled())  { ggk::Logger::fatal(SSTR << message); } } while (0)
+#define GGK_ALWAYS(message) do { if (ggk::Logger::isAlwaysEnabled()) { ggk::Logger::always(SSTR << message); } } while (0)
+#define GGK_TRACE(message)  do { if (ggk::Logger::isTraceEnabled())  { ggk::Logger::trace(SSTR << message); } } while (0)
+
 class Logger
 {
 public:
@@ -73,6 +88,21 @@ public:
     static void registerTraceReceiver(GGKLogReceiver receiver);
 
 
+    //
+    // Level checks
+    //
+    // A level is enabled if a receiver is registered for it
+    //
+
+    static bool isDebugEnabled() { return nullptr != logReceiverDebug; }
+    static bool isInfoEnabled() { return nullptr != logReceiverInfo; }
+    static bool isStatusEnabled() { return nullptr != logReceiverStatus; }
+    static bool isWarnEnabled() { return nullptr != logReceiverWarn; }
+    static bool isErrorEnabled() { return nullptr != logReceiverError; }
+    static bool isFatalEnabled() { return nullptr != logReceiverFatal; }
+    static bool isAlwaysEnabled() { return nullptr != logReceiverAlways; }
+    static bool isTraceEnabled() { return nullptr != logReceiverTrace; }
+
     //
     // Logging actions
     //
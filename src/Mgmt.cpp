@@ -24,6 +24,7 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <string.h>
+#include <chrono>
 
 #include "Mgmt.h"
 #include "Logger.h"
@@ -36,11 +37,100 @@ namespace ggk {
 // Set `controllerIndex` to the zero-based index of the device as recognized by the OS. If this parameter is omitted, the index
 // of the first device (0) will be used.
 Mgmt::Mgmt(uint16_t controllerIndex)
-: controllerIndex(controllerIndex)
+: controllerIndex(controllerIndex), batching(false)
 {
     HciAdapter::getInstance().sync(controllerIndex);
 }
 
+// Starts a batch of commands
+//
+// Until `endBatch()` is called, the setters below send their commands without waiting for the responses, so the commands are
+// pipelined and the whole batch costs a single round trip. While batching, their return values only report whether the
+// command was sent.
+void Mgmt::beginBatch()
+{
+    batching = true;
+    batch.clear();
+}
+
+// Waits for the responses to every command sent since `beginBatch()` and ends the batch
+//
+// All of the commands share a single timeout, since they were all sent at (nearly) the same time.
+//
+// Returns true if every command received its response, otherwise false
+bool Mgmt::endBatch()
+{
+    batching = false;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(HciAdapter::kMaxEventWaitTimeMS);
+    bool success = true;
+
+    for (HciAdapter::PendingCommand &pending : batch)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        int timeoutMS = remaining.count() > 0 ? static_cast<int>(remaining.count()) : 0;
+
+        HciAdapter::CommandResponse response;
+        if (!HciAdapter::getInstance().waitForCommandResponse(pending, response, timeoutMS))
+        {
+            Logger::warn(SSTR << "  + No response to batched command " << HciAdapter::kCommandCodeNames[pending.commandCode]);
+            success = false;
+        }
+        else
+        {
+            checkResponse(pending.commandCode, response);
+        }
+    }
+
+    batch.clear();
+    return success;
+}
+
+// Logs the status of a response that reports a failure
+//
+// The adapter did answer, so this isn't treated as a failure to send; some settings (such as BR/EDR on an LE-only controller) are
+// expected to be rejected.
+void Mgmt::checkResponse(uint16_t commandCode, const HciAdapter::CommandResponse &response)
+{
+    if (response.succeeded())
+    {
+        return;
+    }
+
+    const char *pStatusName = response.status <= HciAdapter::kMaxStatusCode ? HciAdapter::kStatusCodes[response.status] : "Unknown";
+    Logger::warn(SSTR << "  + " << HciAdapter::kCommandCodeNames[commandCode] << " returned status " << Utils::hex(response.status)
+        << " (" << pStatusName << ")");
+}
+
+// Sends a command, waiting for its response unless we're batching
+//
+// Returns true on success, otherwise false
+bool Mgmt::sendCommand(HciAdapter::HciHeader &request)
+{
+    if (!batching)
+    {
+        uint16_t commandCode = request.code;
+
+        HciAdapter::CommandResponse response;
+        if (!HciAdapter::getInstance().sendCommand(request, response))
+        {
+            return false;
+        }
+
+        checkResponse(commandCode, response);
+        return true;
+    }
+
+    batch.emplace_back();
+    if (!HciAdapter::getInstance().submitCommand(request, batch.back()))
+    {
+        batch.pop_back();
+        return false;
+    }
+
+    return true;
+}
+
 // Set the adapter name and short name
 //
 // The inputs `name` and `shortName` may be truncated prior to setting them on the adapter. To ensure that `name` and
@@ -71,7 +161,7 @@ bool Mgmt::setName(std::string name, std::string shortName)
     memset(request.shortName, 0, sizeof(request.shortName));
     snprintf(request.shortName, sizeof(request.shortName), "%s", shortName.c_str());
 
-    if (!HciAdapter::getInstance().sendCommand(request))
+    if (!sendCommand(request))
     {
         Logger::warn(SSTR << "  + Failed to set name");
         return false;
@@ -100,7 +190,7 @@ bool Mgmt::setDiscoverable(uint8_t disc, uint16_t timeout)
     request.disc = disc;
     request.timeout = timeout;
 
-    if (!HciAdapter::getInstance().sendCommand(request))
+    if (!sendCommand(request))
     {
         Logger::warn(SSTR << "  + Failed to set discoverable");
         return false;
@@ -127,7 +217,7 @@ bool Mgmt::setState(uint16_t commandCode, uint16_t controllerId, uint8_t newStat
     request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
     request.state = newState;
 
-    if (!HciAdapter::getInstance().sendCommand(request))
+    if (!sendCommand(request))
     {
         Logger::warn(SSTR << "  + Failed to set " << HciAdapter::kCommandCodeNames[commandCode] << " state to: " << static_cast<int>(newState));
         return false;
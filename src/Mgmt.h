@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "HciAdapter.h"
 #include "Utils.h"
@@ -171,6 +172,18 @@ struct Mgmt
     // of the first device (0) will be used.
     Mgmt(uint16_t controllerIndex = kDefaultControllerIndex);
 
+    // Starts a batch of commands
+    //
+    // Until `endBatch()` is called, the setters below send their commands without waiting for the responses, so the commands are
+    // pipelined and the whole batch costs a single round trip. While batching, their return values only report whether the
+    // command was sent.
+    void beginBatch();
+
+    // Waits for the responses to every command sent since `beginBatch()` and ends the batch
+    //
+    // Returns true if every command received its response, otherwise false
+    bool endBatch();
+
     // Set the adapter name and short name
     //
     // The inputs `name` and `shortName` may be truncated prior to setting them on the adapter. To ensure that `name` and
@@ -244,6 +257,14 @@ struct Mgmt
 
 private:
 
+    // Sends a command, waiting for its response unless we're batching
+    //
+    // Returns true on success, otherwise false
+    bool sendCommand(HciAdapter::HciHeader &request);
+
+    // Logs the status of a response that reports a failure
+    static void checkResponse(uint16_t commandCode, const HciAdapter::CommandResponse &response);
+
     //
     // Data members
     //
@@ -251,6 +272,10 @@ private:
     // The default controller index (the first device)
     uint16_t controllerIndex;
 
+    // Commands sent since `beginBatch()` that are still waiting for their responses
+    bool batching;
+    std::vector<HciAdapter::PendingCommand> batch;
+
     // Default controller index
     static const uint16_t kDefaultControllerIndex = 0;
 };
@@ -5,18 +5,15 @@
 #include "NtcDbus.h"
 
 #include <dbus/dbus.h>
-#include <sys/ioctl.h>
 
 #include "NtcLogger.h"
+#include "HciConnections.h"
 
 namespace fw
 {
 // Flag for "Disabling Pairing timeout" option(-n) on commandline
 bool niceMode=false;
 
-// Initialize static member
-NtcDbus::BtSocket NtcDbus::_btSocket;
-
 // In the situation where a connected device generates Authentication Denied errors, it is likely that the user forgot the pairing
 // from the phone.  We still see it as paired but it generates EAuthenticationFailedEvent messages.  So, let's tidy up our end.
 void NtcDbus::deletePairingRecord(const std::string &device, const std::string &interface)
@@ -68,58 +65,35 @@ void NtcDbus::deletePairingRecord(const std::string &device, const std::string &
 }
 
 
+// Remove the pairing record of the given peer (from /var/lib/bluetooth/ via bluetoothd)
+//
+// address is in the byte order used by mgmt events (least significant byte first)
+void NtcDbus::depairDevice(const uint8_t address[6])
+{
+    const uint8_t *a = address;
+    std::string dev = fw::utils::format("dev_%2.2X_%2.2X_%2.2X_%2.2X_%2.2X_%2.2X", a[5], a[4], a[3], a[2], a[1], a[0]);
+    deletePairingRecord(dev, "hci0");
+}
+
 // Check there is a connection which is not paired, yet.
 //
-// depairCurrentDevice if true, remove connected device info from the action list(/var/lib/bluetooth/)
+// Reads the connection table, whose security levels follow the pairing events (see HciConnections.cpp).
 //
 // return true, if there is a connection whici is not paired, yet.
-bool NtcDbus::checkConnectionsForPairing(bool depairCurrentDevice)
+bool NtcDbus::checkConnectionsForPairing()
 {
-    struct hci_conn_list_req *cl = nullptr;
-    struct hci_conn_info *ci = nullptr;
-    int sk = _btSocket.getFd();
-
-    fw::utils::ScopeDeletor clDeletor([&cl] { ::delete cl; });
-
-    if (sk < 0)
-        return false;
-
-    if ((cl =  reinterpret_cast<hci_conn_list_req*>(::operator new(sizeof(*cl) + sizeof(*ci), std::nothrow))) == nullptr) {
-        return false;
-    }
-
-    cl->dev_id = 0; // hci0
-    cl->conn_num = 1; // single connection
-    ci = cl->conn_info;
-
-    if (ioctl(sk, HCIGETCONNLIST, (void *) cl)) {
-        return false;
-    }
-
-    if (cl->conn_num != 1) {
-        return false;
-    }
-
-    /* ci->type:  SCO_LINK(0x00), ACL_LINK(0x01), ESCO_LINK(0x02), LE_LINK(0x80) */
-    /* ci->state: BT_CONNECTED(1), BT_OPEN(2), BT_BOUND(3), BT_LISTEN(4), BT_CONNECT(5), */
-    /*            BT_CONNECT2(6), BT_CONFIG(7), BT_DISCONN(8), BT_CLOSED(9) */
-    /* ci->link_mode(mask): */
-    /*    #define HCI_LM_ACCEPT   0x8000 */
-    /*    #define HCI_LM_MASTER   0x0001 */
-    /*    #define HCI_LM_AUTH     0x0002 */
-    /*    #define HCI_LM_ENCRYPT  0x0004 */
-    /*    #define HCI_LM_TRUSTED  0x0008 */
-    /*    #define HCI_LM_RELIABLE 0x0010 */
-    /*    #define HCI_LM_SECURE   0x0020 */
-    bool connected = ci->type == 0x80 && ci->state == 1;
-    bool paired = (ci->link_mode & 0x0006) == 0x0006;
-    if (connected && depairCurrentDevice) {
-        std::string dev = fw::utils::format("dev_%2.2X_%2.2X_%2.2X_%2.2X_%2.2X_%2.2X", ci->bdaddr.b[5], ci->bdaddr.b[4], ci->bdaddr.b[3], ci->bdaddr.b[2], ci->bdaddr.b[1], ci->bdaddr.b[0]);
-        deletePairingRecord(dev, "hci0");
-        return false;
-    }
+    return ggk::HciConnections::getInstance().hasUnpairedLowEnergy();
+}
 
-    return connected && !paired;
+// Confirm with the kernel that a connection is still not paired, before dropping it.
+//
+// A bonded peer which reconnects encrypts the link with its existing keys and raises no pairing event, so the table still sees it
+// as unpaired. This costs an ioctl per unpaired connection; call it only once the grace time is up.
+//
+// return true, if there is a connection which is still not paired.
+bool NtcDbus::confirmConnectionsForPairing()
+{
+    return ggk::HciConnections::getInstance().recheckUnpairedLowEnergy();
 }
 
 }; // namespace fw
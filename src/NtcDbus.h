@@ -19,37 +19,11 @@ extern bool niceMode;
 class NtcDbus
 {
   public:
-    bool checkConnectionsForPairing(bool depairCurrentDevice);
-
-    class BtSocket
-    {
-      public:
-        BtSocket() : _btSocketFd(-1) { connect(); }
-        ~BtSocket() { disconnect(); }
-        int getFd() {
-            if (_btSocketFd < 0) {
-                connect();
-            }
-            return _btSocketFd;
-        }
-
-      private:
-        int _btSocketFd;
-
-        void connect() {
-            _btSocketFd = socket(AF_BLUETOOTH, SOCK_RAW | SOCK_CLOEXEC, BTPROTO_HCI);
-        }
-        void disconnect() {
-            if (_btSocketFd > 0) {
-                close(_btSocketFd);
-                _btSocketFd = -1;
-            }
-        }
-    };
+    bool checkConnectionsForPairing();
+    bool confirmConnectionsForPairing();
+    void depairDevice(const uint8_t address[6]);
 
   private:
-    static BtSocket _btSocket;
-
     void deletePairingRecord(const std::string &device, const std::string &interface);
 };
 }; // namespace fw
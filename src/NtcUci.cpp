@@ -4,6 +4,10 @@
 
 #include "NtcUci.h"
 
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
 #include <vector>
 #include <numeric>
 #include <stdexcept>
@@ -46,32 +50,98 @@ typedef struct
     /*     __UBUS_MSG_LAST,        // 12 */
     /* }; */
     int ubusMsgType;
-    std::string parsedStr;
+
+    /* decodes the reply in place, while it is valid (that is, inside the ubus_invoke() callback) */
+    std::function<bool(struct blob_attr *msg)> decoder;
+    bool decoded = false;
 } vendor_data_t;
 
 // Callback for ubus_invoke()
 void _ubus_invoke_cb(struct ubus_request *req, int msgType, struct blob_attr *msg)
 {
-    char *str = nullptr;
     vendor_data_t *userdata = static_cast<vendor_data_t *>(req->priv);
 
-    fw::utils::ScopeDeletor bufDeletor([&str] {
-        free(str);
-    });
+    if (!userdata) {
+        return;
+    }
+
+    userdata->reqStatusCode = req->status_code;
+    userdata->ubusMsgType = msgType;
+    userdata->decoded = msg && userdata->decoder && userdata->decoder(msg);
+}
 
-    if (userdata) {
-        userdata->reqStatusCode = req->status_code;
-        userdata->ubusMsgType = msgType;
+/*! @brief find a field of a blobmsg table
+ *
+ * @param[in] data table data (blob_data() of a reply message, or blobmsg_data() of a table field)
+ * @param[in] len table data length
+ * @param[in] name field name
+ * @param[in] type field type, or BLOBMSG_TYPE_UNSPEC for any type
+ *
+ * @return field, or nullptr if the field does not exist or has another type
+ */
+struct blob_attr *blobmsgField(void *data, unsigned int len, const char *name, enum blobmsg_type type)
+{
+    const struct blobmsg_policy policy = { name, type };
+    struct blob_attr *tb = nullptr;
+
+    if (blobmsg_parse(&policy, 1, &tb, data, len) != 0) {
+        return nullptr;
     }
+    return tb;
+}
 
-    if (!msg) {
-        return;
+// Find a field of a ubus reply message
+struct blob_attr *replyField(struct blob_attr *msg, const char *name, enum blobmsg_type type)
+{
+    return blobmsgField(blob_data(msg), blob_len(msg), name, type);
+}
+
+// Find a field of a blobmsg table field
+struct blob_attr *tableField(struct blob_attr *table, const char *name, enum blobmsg_type type)
+{
+    return table ? blobmsgField(blobmsg_data(table), blobmsg_data_len(table), name, type) : nullptr;
+}
+
+/*! @brief get the strings of a UCI option (string) or list (array of strings)
+ *
+ * @param[in] attr blobmsg field
+ * @param[out] output option value, or list values
+ *
+ * @return true, if attr is a list
+ */
+bool blobmsgStrings(struct blob_attr *attr, std::vector<std::string> &output)
+{
+    struct blob_attr *cur;
+    size_t rem;
+
+    if (blobmsg_type(attr) == BLOBMSG_TYPE_STRING) { // option type
+        output.push_back(blobmsg_get_string(attr));
+        return false;
     }
 
-    str = blobmsg_format_json(msg, true);
-    if (str && userdata) {
-        userdata->parsedStr = str;
+    if (blobmsg_type(attr) != BLOBMSG_TYPE_ARRAY) {
+        return false;
+    }
+
+    blobmsg_for_each_attr(cur, attr, rem) { // list type
+        if (blobmsg_type(cur) == BLOBMSG_TYPE_STRING)
+            output.push_back(blobmsg_get_string(cur));
     }
+    return true;
+}
+
+// Join list values with a delimiter
+std::string joinStrings(const std::vector<std::string> &values, const std::string &delim)
+{
+    std::string retVal;
+
+    for (auto s = values.begin(), e = values.end(), i = s; i != e; ++i) {
+        if (i != s) {
+            retVal.append(delim);
+        }
+        retVal.append(*i);
+    }
+    return retVal;
 }
 
 /*! @brief parse Json string to Json::Value object
@@ -94,35 +164,6 @@ bool parseJsonStr(const Json::CharReaderBuilder &builder, const std::string &jSt
     }
     return true;
 }
-
-/*
-  > return code
-UBUS_STATUS_OK,                // 0
-UBUS_STATUS_INVALID_COMMAND,   // 1
-UBUS_STATUS_INVALID_ARGUMENT,  // 2
-UBUS_STATUS_METHOD_NOT_FOUND,  // 3
-UBUS_STATUS_NOT_FOUND,         // 4
-UBUS_STATUS_NO_DATA,           // 5
-UBUS_STATUS_PERMISSION_DENIED, // 6
-UBUS_STATUS_TIMEOUT,           // 7
-UBUS_STATUS_NOT_SUPPORTED,     // 8
-UBUS_STATUS_UNKNOWN_ERROR,     // 9
-UBUS_STATUS_CONNECTION_FAILED, // 10
-__UBUS_STATUS_LAST             // 11
-*/
-int ntc_ubus_invoke(struct ubus_context* ctx, const std::string &path, const std::string &method,
-        struct blob_attr *msg, ubus_data_handler_t cb, void *priv, int timeout=3000 /*milliseconds*/)
-{
-    uint32_t id;
-    int rc = UBUS_STATUS_UNKNOWN_ERROR;
-
-    rc = ubus_lookup_id(ctx, path.c_str(), &id);
-    if (rc == UBUS_STATUS_OK) {
-        rc = ubus_invoke(ctx, id, method.c_str(), msg, cb, priv, timeout);
-    }
-
-    return rc;
-}
 }; // unnamed namespace
 
 namespace uci {
@@ -254,14 +295,146 @@ void SubscribeList::updateUciValueOnDB(const std::string &uciName, const std::st
     }
 }
 
+std::vector<std::string> SubscribeList::getSubscribedNames(const std::string &pkg)
+{
+    std::vector<std::string> names;
+    std::string prefix = pkg.empty() ? pkg : pkg + ".";
+
+    std::lock_guard<std::mutex> guard(_classMutex);
+    for (auto const &elem : _uciValueMap) {
+        if (elem.first.compare(0, prefix.size(), prefix) == 0) {
+            names.push_back(elem.first);
+        }
+    }
+    return names;
+}
+
+std::vector<subscribeCallback_t> SubscribeList::updateUciValue(const std::string &uciName, const UciValue &uciValue)
+{
+    std::vector<subscribeCallback_t> callbacks;
+
+    std::lock_guard<std::mutex> guard(_classMutex);
+
+    /* compare as strings, so that a missing option is the same as an empty one */
+    auto uciValIt = _uciValueMap.find(uciName);
+    if (uciValIt == _uciValueMap.end() || uciValIt->second.toStdString() == uciValue.toStdString()) {
+        return callbacks;
+    }
+    uciValIt->second = uciValue.toStdString();
+
+    auto [l, u] = _subListMap.equal_range(uciName);
+    for (auto it = l; it != u; ++it) {
+        callbacks.push_back(it->second.getCallback());
+    }
+    return callbacks;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+/*### Classes for UCI package cache ###*/
+///////////////////////////////////////////////////////////////////////////////////////////////
+PackageCache::LookupResult PackageCache::lookup(const std::string &pkg, const std::string &sec, const std::string &opt, Entry &entry)
+{
+    std::lock_guard<std::mutex> guard(_classMutex);
+
+    auto pkgIt = _packages.find(pkg);
+    if (pkgIt == _packages.end()) {
+        return LookupResult::NOT_CACHED;
+    }
+    if (!_isFresh(pkg, pkgIt->second)) {
+        _packages.erase(pkgIt);
+        return LookupResult::NOT_CACHED;
+    }
+    const Package &package = pkgIt->second;
+
+    std::string secName = sec;
+    if (!sec.empty() && sec[0] == '@') {
+        auto aliasIt = package.aliases.find(sec);
+        if (aliasIt == package.aliases.end()) {
+            return LookupResult::NOT_FOUND;
+        }
+        secName = aliasIt->second;
+    }
+
+    auto entryIt = package.entries.find(opt.empty() ? secName : secName + "." + opt);
+    if (entryIt == package.entries.end()) {
+        return LookupResult::NOT_FOUND;
+    }
+
+    entry = entryIt->second;
+    return LookupResult::FOUND;
+}
+
+uint64_t PackageCache::getGeneration()
+{
+    std::lock_guard<std::mutex> guard(_classMutex);
+    return _generation;
+}
+
+bool PackageCache::stamp(const std::string &pkg, Package &package)
+{
+    package.readAt = std::chrono::steady_clock::now();
+    return stat((_configDir + "/" + pkg).c_str(), &package.file) == 0;
+}
+
+// A commit replaces the package file with a renamed temporary file, so the inode changes even within one mtime tick
+bool PackageCache::_isFresh(const std::string &pkg, const Package &package)
+{
+    struct stat file;
+
+    if (std::chrono::steady_clock::now() - package.readAt >= _maxAge) {
+        return false;
+    }
+    if (stat((_configDir + "/" + pkg).c_str(), &file) != 0) {
+        return false;
+    }
+    return file.st_dev == package.file.st_dev && file.st_ino == package.file.st_ino && file.st_size == package.file.st_size &&
+           file.st_mtim.tv_sec == package.file.st_mtim.tv_sec && file.st_mtim.tv_nsec == package.file.st_mtim.tv_nsec;
+}
+
+void PackageCache::store(const std::string &pkg, Package &&package, uint64_t generation)
+{
+    std::lock_guard<std::mutex> guard(_classMutex);
+
+    /* the package may have changed while it was being read */
+    if (!_enabled || generation != _generation) {
+        return;
+    }
+    _packages[pkg] = std::move(package);
+}
+
+void PackageCache::invalidate(const std::string &pkg)
+{
+    std::lock_guard<std::mutex> guard(_classMutex);
+
+    ++_generation;
+    if (pkg.empty()) {
+        _packages.clear();
+    } else {
+        _packages.erase(pkg);
+    }
+}
+
+void PackageCache::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> guard(_classMutex);
+
+    ++_generation;
+    _packages.clear();
+    _enabled = enabled;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
 /*### Classes for UBUS context ###*/
 ///////////////////////////////////////////////////////////////////////////////////////////////
 // Initialize static member
 SubscribeList Context::_subscribeObj;
+PackageCache Context::_packageCache;
 
-Context::Context() : _ubusCtx(nullptr), _sessionId(), _sessionUser(), _sessionPass(), _sessionTimeout(0)
+Context::Context() : _ubusCtx(nullptr), _ubusMutex(), _objectIds(), _sessionId(), _sessionUser(), _sessionPass(), _sessionTimeout(0),
+    _listenerMutex(), _eventCtx(nullptr), _configChangeHandler(), _listenerThread(), _listenerStopFd(-1), _listenerStopping(false),
+    _configChangeCb()
 {
     _ubusCtx = ubus_connect(nullptr);
     if (!_ubusCtx) {
@@ -280,10 +453,249 @@ Context::Context() : _ubusCtx(nullptr), _sessionId(), _sessionUser(), _sessionPa
 
 Context::~Context()
 {
+    stopConfigListener();
     _destroySession(_sessionId);
     ubus_free(_ubusCtx);
 }
 
+/*
+  > return code
+UBUS_STATUS_OK,                // 0
+UBUS_STATUS_INVALID_COMMAND,   // 1
+UBUS_STATUS_INVALID_ARGUMENT,  // 2
+UBUS_STATUS_METHOD_NOT_FOUND,  // 3
+UBUS_STATUS_NOT_FOUND,         // 4
+UBUS_STATUS_NO_DATA,           // 5
+UBUS_STATUS_PERMISSION_DENIED, // 6
+UBUS_STATUS_TIMEOUT,           // 7
+UBUS_STATUS_NOT_SUPPORTED,     // 8
+UBUS_STATUS_UNKNOWN_ERROR,     // 9
+UBUS_STATUS_CONNECTION_FAILED, // 10
+__UBUS_STATUS_LAST             // 11
+*/
+int Context::ubusInvoke(const std::string &path, const std::string &method, struct blob_attr *msg, ubus_data_handler_t cb, void *priv,
+        int timeout)
+{
+    int rc = UBUS_STATUS_UNKNOWN_ERROR;
+
+    std::lock_guard<std::mutex> guard(_ubusMutex);
+
+    uint32_t id;
+    auto idIt = _objectIds.find(path);
+    bool cached = idIt != _objectIds.end();
+
+    if (cached) {
+        id = idIt->second;
+    } else {
+        rc = ubus_lookup_id(_ubusCtx, path.c_str(), &id);
+        if (rc == UBUS_STATUS_OK) {
+            _objectIds[path] = id;
+        }
+    }
+
+    if (rc == UBUS_STATUS_OK || cached) {
+        rc = ubus_invoke(_ubusCtx, id, method.c_str(), msg, cb, priv, timeout);
+    }
+
+    /* a cached id is stale if the object has been registered again (e.g. rpcd restarted). The method itself can return
+     * UBUS_STATUS_NOT_FOUND as well ('uci get' of a missing option), so only invoke it again if the id has changed. */
+    if (rc == UBUS_STATUS_NOT_FOUND && cached) {
+        uint32_t newId;
+        if (ubus_lookup_id(_ubusCtx, path.c_str(), &newId) != UBUS_STATUS_OK) {
+            _objectIds.erase(path);
+        } else if (newId != id) {
+            _objectIds[path] = newId;
+            rc = ubus_invoke(_ubusCtx, newId, method.c_str(), msg, cb, priv, timeout);
+        }
+    }
+
+    /* ubusd has gone away: reconnect for the next call, object ids are not kept across ubusd restarts */
+    if (rc == UBUS_STATUS_CONNECTION_FAILED || _ubusCtx->sock.eof) {
+        _objectIds.clear();
+        if (ubus_reconnect(_ubusCtx, nullptr) != UBUS_STATUS_OK) {
+            log(LOG_ERR, "Failed to reconnect to ubus");
+        }
+    }
+
+    return rc;
+}
+
+bool Context::startConfigListener(configChangeCallback_t cb)
+{
+    std::lock_guard<std::mutex> guard(_listenerMutex);
+
+    if (_listenerThread.joinable() || _listenerStopping) {
+        return !_listenerStopping;
+    }
+
+    _listenerStopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (_listenerStopFd < 0) {
+        log(LOG_ERR, "Failed to create eventfd for UCI change listener: %s", strerror(errno));
+        return false;
+    }
+
+    if (!_connectConfigListener()) {
+        close(_listenerStopFd);
+        _listenerStopFd = -1;
+        return false;
+    }
+
+    _configChangeCb = cb;
+    _listenerThread = std::thread(&Context::_runConfigListener, this);
+    return true;
+}
+
+void Context::stopConfigListener()
+{
+    std::thread listenerThread;
+
+    /* the listener thread may call startConfigListener() (through UciHandle::get()), so don't hold the lock while joining it */
+    {
+        std::lock_guard<std::mutex> guard(_listenerMutex);
+
+        if (!_listenerThread.joinable()) {
+            return;
+        }
+
+        uint64_t one = 1;
+        if (write(_listenerStopFd, &one, sizeof(one)) < 0) {
+            log(LOG_ERR, "Failed to stop UCI change listener: %s", strerror(errno));
+        }
+        listenerThread.swap(_listenerThread);
+        _listenerStopping = true;
+    }
+
+    listenerThread.join();
+
+    std::lock_guard<std::mutex> guard(_listenerMutex);
+    _disconnectConfigListener();
+    close(_listenerStopFd);
+    _listenerStopFd = -1;
+    _listenerStopping = false;
+}
+
+// Connect the listener's own UBUS context and register for 'config.change' events
+bool Context::_connectConfigListener()
+{
+    _eventCtx = ubus_connect(nullptr);
+    if (!_eventCtx) {
+        log(LOG_ERR, "Failed to connect to ubus for UCI change listener");
+        return false;
+    }
+
+    memset(&_configChangeHandler, 0, sizeof(_configChangeHandler));
+    _configChangeHandler.cb = _configChangeEventCb;
+    if (ubus_register_event_handler(_eventCtx, &_configChangeHandler, "config.change") != UBUS_STATUS_OK) {
+        log(LOG_ERR, "Failed to register ubus 'config.change' event handler");
+        _disconnectConfigListener();
+        return false;
+    }
+
+    /* packages can be cached only while we hear about their changes */
+    _packageCache.setEnabled(true);
+    return true;
+}
+
+void Context::_disconnectConfigListener()
+{
+    _packageCache.setEnabled(false);
+
+    if (_eventCtx) {
+        ubus_free(_eventCtx);
+        _eventCtx = nullptr;
+    }
+}
+
+// Listener thread: dispatch UBUS events until stopConfigListener() is called
+//
+// If ubusd goes away, reconnect once per second. Packages may have changed while we were not listening, so all subscriptions are
+// re-read after reconnecting.
+void Context::_runConfigListener()
+{
+    while (true) {
+        struct pollfd fds[2];
+        int nfds = 1;
+
+        fds[0].fd = _listenerStopFd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        if (_eventCtx) {
+            fds[1].fd = _eventCtx->sock.fd;
+            fds[1].events = POLLIN;
+            fds[1].revents = 0;
+            nfds = 2;
+        }
+
+        int rc = poll(fds, nfds, _eventCtx ? -1 : 1000);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log(LOG_ERR, "UCI change listener poll failed: %s", strerror(errno));
+            return;
+        }
+
+        if (fds[0].revents) {
+            return;
+        }
+
+        if (!_eventCtx) {
+            if (_connectConfigListener()) {
+                log(LOG_NOTICE, "UCI change listener reconnected to ubus");
+                _configChangeCb("");
+            }
+            continue;
+        }
+
+        if (fds[1].revents & (POLLERR | POLLHUP)) {
+            log(LOG_WARNING, "UCI change listener lost ubus connection");
+            _disconnectConfigListener();
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            ubus_handle_event(_eventCtx);
+        }
+    }
+}
+
+std::string Context::configChangePackage(struct blob_attr *msg)
+{
+    struct blob_attr *attr;
+
+    if (!msg) {
+        return "";
+    }
+
+    /* {"package": "<package>"} (rpcd), then {"data": {"package": "<package>"}} (a forwarded procd service event) */
+    attr = replyField(msg, "package", BLOBMSG_TYPE_STRING);
+    if (!attr) {
+        attr = tableField(replyField(msg, "data", BLOBMSG_TYPE_TABLE), "package", BLOBMSG_TYPE_STRING);
+    }
+    /* {"config": "<package>"} (older senders) */
+    if (!attr) {
+        attr = replyField(msg, "config", BLOBMSG_TYPE_STRING);
+    }
+
+    return attr ? blobmsg_get_string(attr) : "";
+}
+
+// UBUS 'config.change' event handler (see configChangePackage() for the message formats)
+void Context::_configChangeEventCb(struct ubus_context *ctx, struct ubus_event_handler *ev, const char *type, struct blob_attr *msg)
+{
+    (void) ctx; //UNUSED
+    (void) type; //UNUSED
+    (void) ev; //UNUSED, the handler belongs to our singleton
+
+    std::string pkg = configChangePackage(msg);
+
+    Context &self = getInstance();
+    self._packageCache.invalidate(pkg);
+    if (self._configChangeCb) {
+        self._configChangeCb(pkg);
+    }
+}
+
 std::string Context::_createSession(const std::string &user, const std::string &pass, int timeout, const std::string &owner)
 {
     std::string sessId;
@@ -319,18 +731,23 @@ std::string Context::_createSession(const std::string &user, const std::string &
     }
 
     /* 2. Destroy existing UBUS RPC session owned by Gatt server */
+    bool ownedSession = false;
+    userdata.decoder = [&owner, &ownedSession](struct blob_attr *msg) {
+        struct blob_attr *attr = tableField(replyField(msg, "values", BLOBMSG_TYPE_TABLE), "owner", BLOBMSG_TYPE_STRING);
+        ownedSession = attr && owner == blobmsg_get_string(attr);
+        return true;
+    };
+
     for(auto &elem : sessIdVec) {
         memset(&b, 0, sizeof(struct blob_buf));
         blob_buf_init(&b, 0);
         blobmsg_add_string(&b, "ubus_rpc_session", elem.c_str());
 
-        if (ntc_ubus_invoke(getUbusCtx(), "session", "get", b.head, _ubus_invoke_cb, &userdata, 3000) == UBUS_STATUS_OK
+        ownedSession = false;
+        if (ubusInvoke("session", "get", b.head, _ubus_invoke_cb, &userdata, 3000) == UBUS_STATUS_OK
             && userdata.reqStatusCode == UBUS_STATUS_OK && userdata.ubusMsgType == UBUS_MSG_DATA
-            && parseJsonStr(getJsonRbuilder(), userdata.parsedStr, jRoot)) {
-            if (jRoot.isMember("values") && jRoot["values"].isObject()
-                && jRoot["values"].isMember("owner") && jRoot["values"]["owner"] == owner) {
-                _destroySession(elem);
-            }
+            && userdata.decoded && ownedSession) {
+            _destroySession(elem);
         }
         blob_buf_free(&b);
     }
@@ -347,7 +764,7 @@ std::string Context::_createSession(const std::string &user, const std::string &
         blobmsg_add_string(&b, "ubus_rpc_session", sessId.c_str());
         blobmsg_add_string(&b, "scope", "uci");
 
-        ntc_ubus_invoke(getUbusCtx(), "session", "revoke", b.head, nullptr, nullptr, 3000);
+        ubusInvoke("session", "revoke", b.head, nullptr, nullptr, 3000);
         blob_buf_free(&b);
 
         /* grant all UCI read/write permission */
@@ -371,7 +788,7 @@ std::string Context::_createSession(const std::string &user, const std::string &
 
         blobmsg_close_array(&b, ptr1);
 
-        ntc_ubus_invoke(getUbusCtx(), "session", "grant", b.head, nullptr, nullptr, 3000);
+        ubusInvoke("session", "grant", b.head, nullptr, nullptr, 3000);
         blob_buf_free(&b);
 
         /* ubus call session set '{"ubus_rpc_session":"session_id","values":{"owner":"gatt_server"}}' */
@@ -382,7 +799,7 @@ std::string Context::_createSession(const std::string &user, const std::string &
         blobmsg_add_string(&b, "owner", owner.c_str());
         blobmsg_close_table(&b, ptr1);
 
-        ntc_ubus_invoke(getUbusCtx(), "session", "set", b.head, nullptr, nullptr, 3000);
+        ubusInvoke("session", "set", b.head, nullptr, nullptr, 3000);
         blob_buf_free(&b);
     }
 
@@ -393,7 +810,6 @@ std::string Context::_loginSession(const std::string &user, const std::string &p
 {
     struct blob_buf b;
     vendor_data_t userdata;
-    Json::Value jRoot;
     std::string sessId;
 
     /* "struct blob_buf b" MUST be freed, when escaping from a scope */
@@ -408,15 +824,23 @@ std::string Context::_loginSession(const std::string &user, const std::string &p
     blobmsg_add_string(&b, "password", pass.c_str());
     blobmsg_add_u32(&b, "timeout", timeout);
 
-    if (ntc_ubus_invoke(getUbusCtx(), "session", "login", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
+    userdata.decoder = [&sessId](struct blob_attr *msg) {
+        struct blob_attr *attr = replyField(msg, "ubus_rpc_session", BLOBMSG_TYPE_STRING);
+        if (!attr) {
+            return false;
+        }
+        sessId = blobmsg_get_string(attr);
+        return true;
+    };
+
+    if (ubusInvoke("session", "login", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
         || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
-        || !parseJsonStr(getJsonRbuilder(), userdata.parsedStr, jRoot)
-        || !jRoot.isMember("ubus_rpc_session") || !jRoot["ubus_rpc_session"].isString()
+        || !userdata.decoded
        ) {
-        return sessId;
+        return std::string();
     }
 
-    return jRoot["ubus_rpc_session"].asString();
+    return sessId;
 }
 
 void Context::_destroySession(const std::string &sessId)
@@ -436,34 +860,135 @@ void Context::_destroySession(const std::string &sessId)
     blob_buf_init(&b, 0);
     blobmsg_add_string(&b, "ubus_rpc_session", sessId.c_str());
 
-    ntc_ubus_invoke(getUbusCtx(), "session", "destroy", b.head, nullptr, nullptr, 3000);
+    ubusInvoke("session", "destroy", b.head, nullptr, nullptr, 3000);
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
 /*### Classes for UCI interface ###*/
 ///////////////////////////////////////////////////////////////////////////////////////////////
-void UciHandle::pollSubscription()
+void UciHandle::refreshSubscription(const std::string &pkg)
 {
-    SubscribeList::uciNameValueMap_t uciMap = _context().getSubscribeObj().getUciNameValueMap();
-    SubscribeList::subscribeListMap_t subMap = _context().getSubscribeObj().getSubscribeListMap();
+    SubscribeList &subscribeObj = _context().getSubscribeObj();
 
-    for(auto const &[name, value] : uciMap) {
+    for (auto const &name : subscribeObj.getSubscribedNames(pkg)) {
         auto names = fw::utils::split(name, '.');
+        if (names.size() != 3) {
+            continue;
+        }
+
+        /* callbacks are triggered without holding the subscription lock, so that they can (un)subscribe */
+        for (auto &cb : subscribeObj.updateUciValue(name, get(UciOptNameType{names[0], names[1], names[2]}))) {
+            if (cb) {
+                cb();
+            }
+        }
+    }
+}
 
-        UciValue curVal = get(UciOptNameType{names[0], names[1], names[2]});
-        if (curVal != value) {
-            _context().getSubscribeObj().updateUciValueOnDB(name, curVal);
+bool UciHandle::_startConfigListener()
+{
+    return _context().startConfigListener([](const std::string &pkg) { UciHandle().refreshSubscription(pkg); });
+}
+
+// Look up a section type or an option value in the package cache, reading the whole package first if it is not cached
+PackageCache::LookupResult UciHandle::_getCached(const UciNameTypeBase &uciName, PackageCache::Entry &entry)
+{
+    PackageCache &cache = _context().getPackageCache();
+    PackageCache::LookupResult rc = cache.lookup(uciName.getPackageName(), uciName.getSectionName(), uciName.getOptionName(), entry);
 
-            auto [l, u] = subMap.equal_range(name);
-            if (l == u) {
+    /* the listener must be running, or the cache is disabled */
+    if (rc != PackageCache::LookupResult::NOT_CACHED || !_startConfigListener()) {
+        return rc;
+    }
+
+    PackageCache::Package package;
+    uint64_t generation = cache.getGeneration();
+    if (!cache.stamp(uciName.getPackageName(), package) || !_getPackage(uciName.getPackageName(), package)) {
+        return rc;
+    }
+    cache.store(uciName.getPackageName(), std::move(package), generation);
+
+    return cache.lookup(uciName.getPackageName(), uciName.getSectionName(), uciName.getOptionName(), entry);
+}
+
+// Read a whole package with 'uci get config=<package>'
+bool UciHandle::_getPackage(const std::string &pkg, PackageCache::Package &package)
+{
+    struct blob_buf b;
+    vendor_data_t userdata;
+
+    /* section names of each section type, in the order of the package, for "@SectionType[#]" */
+    std::map<std::string /*SectionType*/, std::map<uint32_t /*index*/, std::string /*SectionName*/>> sectionsByType;
+
+    /* "struct blob_buf b" MUST be freed, when escaping from a scope */
+    b.buf = nullptr;
+    fw::utils::ScopeDeletor bufDeletor([&b] {
+        blob_buf_free(&b);
+    });
+
+    memset(&b, 0, sizeof(struct blob_buf));
+    blob_buf_init(&b, 0);
+    blobmsg_add_string(&b, "config", pkg.c_str());
+    if (!_context().getUbusSessId().empty())
+        blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
+
+    /* {"values": {"SectionName": {".type": "SectionType", ".index": 0, "OptionName": "OptionValue", "ListName": [...]}}} */
+    userdata.decoder = [&package, &sectionsByType](struct blob_attr *msg) {
+        struct blob_attr *values = replyField(msg, "values", BLOBMSG_TYPE_TABLE);
+        struct blob_attr *sec, *opt;
+        size_t secRem, optRem;
+
+        if (!values) {
+            return false;
+        }
+
+        blobmsg_for_each_attr(sec, values, secRem) {
+            if (blobmsg_type(sec) != BLOBMSG_TYPE_TABLE) {
                 continue;
             }
 
-            for (auto &it = l; it != u; ++it) {
-                it->second();
+            struct blob_attr *typeAttr = tableField(sec, ".type", BLOBMSG_TYPE_STRING);
+            struct blob_attr *indexAttr = tableField(sec, ".index", BLOBMSG_TYPE_INT32);
+            if (!typeAttr) {
+                continue;
             }
+
+            const std::string secName = blobmsg_name(sec);
+            const std::string secType = blobmsg_get_string(typeAttr);
+            package.entries[secName] = PackageCache::Entry{false, {secType}};
+            sectionsByType[secType][indexAttr ? blobmsg_get_u32(indexAttr) : 0] = secName;
+
+            blobmsg_for_each_attr(opt, sec, optRem) {
+                const char *optName = blobmsg_name(opt);
+                if (optName[0] == '\0' || optName[0] == '.') { // ".type", ".name", ".anonymous", ".index"
+                    continue;
+                }
+
+                PackageCache::Entry entry{false, {}};
+                entry.isList = blobmsgStrings(opt, entry.values);
+                package.entries[secName + "." + optName] = std::move(entry);
+            }
+        }
+        return true;
+    };
+
+    if (_context().ubusInvoke("uci", "get", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
+        || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
+        || !userdata.decoded
+       ) {
+        return false;
+    }
+
+    for (auto const &[secType, sections] : sectionsByType) {
+        int count = static_cast<int>(sections.size());
+        int i = 0;
+        for (auto const &section : sections) {
+            package.aliases["@" + secType + "[" + std::to_string(i) + "]"] = section.second;
+            package.aliases["@" + secType + "[" + std::to_string(i - count) + "]"] = section.second;
+            ++i;
         }
     }
+    return true;
 }
 
 UciValue UciHandle::_get(const UciNameTypeBase &uciName, const std::string &delim)
@@ -472,7 +997,17 @@ UciValue UciHandle::_get(const UciNameTypeBase &uciName, const std::string &deli
     vendor_data_t userdata;
     std::string retVal;
 
-    Json::Value jRoot;
+    PackageCache::Entry entry;
+    switch (_getCached(uciName, entry)) {
+        case PackageCache::LookupResult::FOUND:
+            return UciValue(joinStrings(entry.values, delim));
+
+        case PackageCache::LookupResult::NOT_FOUND:
+            return UciValue(); // failure
+
+        case PackageCache::LookupResult::NOT_CACHED:
+            break;
+    }
 
     /* "struct blob_buf b" MUST be freed, when escaping from a scope */
     b.buf = nullptr;
@@ -491,41 +1026,40 @@ UciValue UciHandle::_get(const UciNameTypeBase &uciName, const std::string &deli
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    if (ntc_ubus_invoke(_context().getUbusCtx(), "uci", "get", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
-        || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
-        || !parseJsonStr(_context().getJsonRbuilder(), userdata.parsedStr, jRoot)
-       ) {
-        return UciValue(); // failure
-    }
+    userdata.decoder = [&uciName, &delim, &retVal](struct blob_attr *msg) {
+        struct blob_attr *attr;
+        std::vector<std::string> values;
 
-    switch(uciName.getUciNameType()) {
-        case UciNameTypeBase::NameType::SECTION:
-            if (!jRoot.isMember("values") || !jRoot["values"].isObject() || !jRoot["values"].isMember(".type")) {
-                return UciValue(); // failure
-            }
-            retVal = jRoot["values"][".type"].asString();
-            break;
+        switch(uciName.getUciNameType()) {
+            case UciNameTypeBase::NameType::SECTION: // {"values": {".type": "SectionType", ...}}
+                attr = tableField(replyField(msg, "values", BLOBMSG_TYPE_TABLE), ".type", BLOBMSG_TYPE_STRING);
+                if (!attr) {
+                    return false;
+                }
+                retVal = blobmsg_get_string(attr);
+                break;
 
-        case UciNameTypeBase::NameType::OPTION:
-            if (!jRoot.isMember("value")) {
-                return UciValue(); // failure
-            }
-            if (jRoot["value"].isArray()) { // list type
-                retVal.clear();
-                for (auto s = jRoot["value"].begin(), e = jRoot["value"].end(), i = s; i != e; ++i) {
-                    if (i != s) {
-                        retVal.append(delim);
-                    }
-                    retVal.append(i->asString());
+            case UciNameTypeBase::NameType::OPTION: // {"value": "OptionValue"} or {"value": ["ListValue1", "ListValue2"]}
+                attr = replyField(msg, "value", BLOBMSG_TYPE_UNSPEC);
+                if (!attr) {
+                    return false;
                 }
+                blobmsgStrings(attr, values);
+                retVal = joinStrings(values, delim);
+                break;
 
-            } else if(jRoot["value"].isString()) { // option type
-                retVal = jRoot["value"].asString();
-            }
-            break;
-        case UciNameTypeBase::NameType::PACKAGE:
-        case UciNameTypeBase::NameType::UNKNOWN:
-            break;
+            case UciNameTypeBase::NameType::PACKAGE:
+            case UciNameTypeBase::NameType::UNKNOWN:
+                break;
+        }
+        return true;
+    };
+
+    if (_context().ubusInvoke("uci", "get", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
+        || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
+        || !userdata.decoded
+       ) {
+        return UciValue(); // failure
     }
 
     return UciValue(retVal);
@@ -535,8 +1069,23 @@ bool UciHandle::_getList(const UciNameTypeBase &uciName, std::vector<std::string
 {
     struct blob_buf b;
     vendor_data_t userdata;
+    bool isList = false;
 
-    Json::Value jRoot;
+    PackageCache::Entry entry;
+    switch (_getCached(uciName, entry)) {
+        case PackageCache::LookupResult::FOUND:
+            if (!entry.isList) {
+                return false;
+            }
+            output.insert(output.end(), entry.values.begin(), entry.values.end());
+            return true;
+
+        case PackageCache::LookupResult::NOT_FOUND:
+            return false;
+
+        case PackageCache::LookupResult::NOT_CACHED:
+            break;
+    }
 
     /* "struct blob_buf b" MUST be freed, when escaping from a scope */
     b.buf = nullptr;
@@ -552,22 +1101,24 @@ bool UciHandle::_getList(const UciNameTypeBase &uciName, std::vector<std::string
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    if (ntc_ubus_invoke(_context().getUbusCtx(), "uci", "get", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
+    /* {"value": ["ListValue1", "ListValue2"]} */
+    userdata.decoder = [&output, &isList](struct blob_attr *msg) {
+        struct blob_attr *attr = replyField(msg, "value", BLOBMSG_TYPE_ARRAY);
+        if (!attr) {
+            return false;
+        }
+        isList = blobmsgStrings(attr, output);
+        return true;
+    };
+
+    if (_context().ubusInvoke("uci", "get", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
         || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
-        || !parseJsonStr(_context().getJsonRbuilder(), userdata.parsedStr, jRoot)
+        || !userdata.decoded
        ) {
         return false;
     }
 
-    if (jRoot["value"].isArray()) { // list type
-        for(auto &elem : jRoot["value"]) {
-            if (elem.isString())
-                output.push_back(elem.asString());
-        }
-        return true;
-    }
-
-    return false;
+    return isList;
 }
 
 bool UciHandle::_set(const UciNameTypeBase &uciName, const std::string &setVal, bool commitFlag, bool createFlag)
@@ -595,7 +1146,9 @@ bool UciHandle::_set(const UciNameTypeBase &uciName, const std::string &setVal,
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    if(ntc_ubus_invoke(_context().getUbusCtx(), "uci", "set", b.head, nullptr, nullptr, 3000) != UBUS_STATUS_OK) {
+    int rc = _context().ubusInvoke("uci", "set", b.head, nullptr, nullptr, 3000);
+    _context().getPackageCache().invalidate(uciName.getPackageName());
+    if (rc != UBUS_STATUS_OK) {
         return false;
     }
 
@@ -634,7 +1187,9 @@ bool UciHandle::_set(const UciNameTypeBase &uciName, const std::vector<std::stri
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    if(ntc_ubus_invoke(_context().getUbusCtx(), "uci", "set", b.head, nullptr, nullptr, 3000) != UBUS_STATUS_OK) {
+    int rc = _context().ubusInvoke("uci", "set", b.head, nullptr, nullptr, 3000);
+    _context().getPackageCache().invalidate(uciName.getPackageName());
+    if (rc != UBUS_STATUS_OK) {
         return false;
     }
 
@@ -661,15 +1216,16 @@ bool UciHandle::_commit(const UciNameTypeBase &uciName)
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    return ntc_ubus_invoke(_context().getUbusCtx(), "uci", "commit", b.head, nullptr, nullptr, 3000) == UBUS_STATUS_OK;
+    int rc = _context().ubusInvoke("uci", "commit", b.head, nullptr, nullptr, 3000);
+    _context().getPackageCache().invalidate(uciName.getPackageName());
+    return rc == UBUS_STATUS_OK;
 }
 
 bool UciHandle::_isChangedButNotCommitted(const UciNameTypeBase &uciName)
 {
     struct blob_buf b;
     vendor_data_t userdata;
-
-    Json::Value jRoot;
+    bool changed = false;
 
     /* "struct blob_buf b" MUST be freed, when escaping from a scope */
     b.buf = nullptr;
@@ -684,17 +1240,21 @@ bool UciHandle::_isChangedButNotCommitted(const UciNameTypeBase &uciName)
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    if (ntc_ubus_invoke(_context().getUbusCtx(), "uci", "changes", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
+    /* {"changes": [["set", "SectionName", "OptionName", "OptionValue"], ...]} */
+    userdata.decoder = [&changed](struct blob_attr *msg) {
+        struct blob_attr *attr = replyField(msg, "changes", BLOBMSG_TYPE_ARRAY);
+        changed = attr && blobmsg_data_len(attr) > 0;
+        return true;
+    };
+
+    if (_context().ubusInvoke("uci", "changes", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
         || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
-        || !parseJsonStr(_context().getJsonRbuilder(), userdata.parsedStr, jRoot)
+        || !userdata.decoded
        ) {
         return false;
     }
 
-    if (!jRoot.isMember("changes") || !jRoot["changes"].isArray() || jRoot["changes"].size() < 1) {
-        return false;
-    }
-    return true;
+    return changed;
 }
 
 std::string UciHandle::_addSection(const std::string &config, const std::string &secType, const std::string &secName)
@@ -703,8 +1263,6 @@ std::string UciHandle::_addSection(const std::string &config, const std::string
     vendor_data_t userdata;
     std::string retVal;
 
-    Json::Value jRoot;
-
     /* "struct blob_buf b" MUST be freed, when escaping from a scope */
     b.buf = nullptr;
     fw::utils::ScopeDeletor bufDeletor([&b] {
@@ -720,15 +1278,21 @@ std::string UciHandle::_addSection(const std::string &config, const std::string
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    if (ntc_ubus_invoke(_context().getUbusCtx(), "uci", "add", b.head, _ubus_invoke_cb, &userdata, 3000) != UBUS_STATUS_OK
-        || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
-        || !parseJsonStr(_context().getJsonRbuilder(), userdata.parsedStr, jRoot)
-       ) {
-        return retVal;
-    }
+    /* {"section": "SectionName"} */
+    userdata.decoder = [&retVal](struct blob_attr *msg) {
+        struct blob_attr *attr = replyField(msg, "section", BLOBMSG_TYPE_STRING);
+        if (attr) {
+            retVal = blobmsg_get_string(attr);
+        }
+        return true;
+    };
 
-    if (jRoot.isMember("section") && jRoot["section"].isString()) {
-        retVal = jRoot["section"].asString();
+    int rc = _context().ubusInvoke("uci", "add", b.head, _ubus_invoke_cb, &userdata, 3000);
+    _context().getPackageCache().invalidate(config);
+    if (rc != UBUS_STATUS_OK || userdata.reqStatusCode != UBUS_STATUS_OK || userdata.ubusMsgType != UBUS_MSG_DATA
+        || !userdata.decoded
+       ) {
+        return std::string();
     }
     return retVal;
 }
@@ -752,7 +1316,155 @@ bool UciHandle::_deleteElem(const UciNameTypeBase &uciName)
     if (!_context().getUbusSessId().empty())
         blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
 
-    return ntc_ubus_invoke(_context().getUbusCtx(), "uci", "delete", b.head, nullptr, nullptr, 3000) == UBUS_STATUS_OK;
+    int rc = _context().ubusInvoke("uci", "delete", b.head, nullptr, nullptr, 3000);
+    _context().getPackageCache().invalidate(uciName.getPackageName());
+    return rc == UBUS_STATUS_OK;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+/*### Classes for UCI transaction ###*/
+///////////////////////////////////////////////////////////////////////////////////////////////
+UciTransaction &UciTransaction::set(const std::string &sec, const std::string &opt, const std::string &setVal)
+{
+    _addValue(sec, opt, false, std::vector<std::string>{setVal});
+    return *this;
+}
+
+UciTransaction &UciTransaction::set(const std::string &sec, const std::string &opt, const std::vector<std::string> &setList)
+{
+    _addValue(sec, opt, true, setList);
+    return *this;
+}
+
+UciTransaction &UciTransaction::addSection(const std::string &secType, const std::string &secName)
+{
+    _ops.push_back(Operation{Operation::Type::ADD, secType, secName, {}});
+    return *this;
+}
+
+UciTransaction &UciTransaction::deleteElem(const std::string &sec, const std::string &opt)
+{
+    _ops.push_back(Operation{Operation::Type::DELETE, sec, opt, {}});
+    return *this;
+}
+
+// Merge the value into a pending 'set' of the section, unless a section has been added or deleted since
+void UciTransaction::_addValue(const std::string &sec, const std::string &opt, bool isList, const std::vector<std::string> &values)
+{
+    for (auto it = _ops.rbegin(); it != _ops.rend() && it->type == Operation::Type::SET; ++it) {
+        if (it->section == sec) {
+            it->values[opt] = std::make_pair(isList, values);
+            return;
+        }
+    }
+
+    Operation op{Operation::Type::SET, sec, std::string(), {}};
+    op.values[opt] = std::make_pair(isList, values);
+    _ops.push_back(std::move(op));
+}
+
+bool UciTransaction::_invoke(const std::string &method, struct blob_buf &b)
+{
+    if (!_context().getUbusSessId().empty())
+        blobmsg_add_string(&b, "ubus_rpc_session", _context().getUbusSessId().c_str());
+
+    return _context().ubusInvoke("uci", method, b.head, nullptr, nullptr, 3000) == UBUS_STATUS_OK;
+}
+
+bool UciTransaction::_apply(const Operation &op)
+{
+    struct blob_buf b;
+    void *tbl, *arr;
+
+    /* "struct blob_buf b" MUST be freed, when escaping from a scope */
+    b.buf = nullptr;
+    fw::utils::ScopeDeletor bufDeletor([&b] {
+        blob_buf_free(&b);
+    });
+
+    memset(&b, 0, sizeof(struct blob_buf));
+    blob_buf_init(&b, 0);
+    blobmsg_add_string(&b, "config", _package.c_str());
+
+    switch (op.type) {
+        case Operation::Type::SET: /* ubus call uci set '{"config": "p", "section": "s", "values": {"o1": "v", "o2": ["v1", "v2"]}}' */
+            blobmsg_add_string(&b, "section", op.section.c_str());
+            tbl = blobmsg_open_table(&b, "values");
+            for (auto const &[opt, value] : op.values) {
+                if (!value.first) { // option type
+                    blobmsg_add_string(&b, opt.c_str(), value.second.front().c_str());
+                    continue;
+                }
+                arr = blobmsg_open_array(&b, opt.c_str()); // list type
+                for (auto &elem : value.second) {
+                    blobmsg_add_string(&b, nullptr, elem.c_str());
+                }
+                blobmsg_close_array(&b, arr);
+            }
+            blobmsg_close_table(&b, tbl);
+            return _invoke("set", b);
+
+        case Operation::Type::ADD: /* ubus call uci add '{"config": "p", "type": "t", "name": "s"}' */
+            blobmsg_add_string(&b, "type", op.section.c_str());
+            if (!op.name.empty())
+                blobmsg_add_string(&b, "name", op.name.c_str());
+            return _invoke("add", b);
+
+        case Operation::Type::DELETE: /* ubus call uci delete '{"config": "p", "section": "s", "option": "o"}' */
+            blobmsg_add_string(&b, "section", op.section.c_str());
+            if (!op.name.empty())
+                blobmsg_add_string(&b, "option", op.name.c_str());
+            return _invoke("delete", b);
+    }
+    return false;
+}
+
+bool UciTransaction::commit()
+{
+    struct blob_buf b;
+    bool success = true;
+
+    if (_ops.empty()) {
+        return true;
+    }
+
+    for (auto const &op : _ops) {
+        if (!_apply(op)) {
+            success = false;
+            break;
+        }
+    }
+
+    /* "struct blob_buf b" MUST be freed, when escaping from a scope */
+    b.buf = nullptr;
+    fw::utils::ScopeDeletor bufDeletor([&b] {
+        blob_buf_free(&b);
+    });
+
+    memset(&b, 0, sizeof(struct blob_buf));
+    blob_buf_init(&b, 0);
+    blobmsg_add_string(&b, "config", _package.c_str());
+
+    if (success) {
+        success = _invoke("commit", b);
+    }
+
+    if (!success) {
+        /* 'uci revert' drops every change staged in the package by our session, not only this transaction's */
+        log(LOG_ERR, "UCI transaction on '%s' failed, reverting all uncommitted changes of the package in this session"
+            " (including changes staged outside the transaction)", _package.c_str());
+
+        blob_buf_init(&b, 0);
+        blobmsg_add_string(&b, "config", _package.c_str());
+        _invoke("revert", b);
+    }
+
+    _context().getPackageCache().invalidate(_package);
+
+    if (success) {
+        _ops.clear();
+    }
+    return success;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -21,10 +21,17 @@ extern "C" {
 
 #include <libubus.h>
 
+#include <sys/stat.h>
+
 #include <map>
+#include <unordered_map>
 #include <set>
+#include <vector>
+#include <mutex>
+#include <thread>
 #include <functional>
 #include <bitset>
+#include <chrono>
 
 #include "json/json.h"
 
@@ -362,6 +369,8 @@ class SubscribeCallbackWrapper
 
     int getToken() { return _classToken; }
 
+    subscribeCallback_t getCallback() const { return _func; }
+
     static constexpr int _tokenPoolSize = 4096;
 
   private:
@@ -393,6 +402,12 @@ class SubscribeList
     std::string getUciValueOnDB(const std::string &uciName);
     void updateUciValueOnDB(const std::string &uciName, const std::string &uciValue);
 
+    /* names of subscribed UCI values in a package (all packages if pkg is empty) */
+    std::vector<std::string> getSubscribedNames(const std::string &pkg);
+
+    /* store a UCI value and return the callbacks to trigger, if the value has changed */
+    std::vector<subscribeCallback_t> updateUciValue(const std::string &uciName, const UciValue &uciValue);
+
     uciNameValueMap_t &getUciNameValueMap() noexcept { return _uciValueMap; }
     subscribeListMap_t &getSubscribeListMap() noexcept { return _subListMap; }
 
@@ -403,14 +418,132 @@ class SubscribeList
 };
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
+/*### Classes for UCI package cache ###*/
+///////////////////////////////////////////////////////////////////////////////////////////////
+/* Whole packages read with 'uci get config=<package>', so that reading many options costs a single ubus call.
+ *
+ * A package stays cached until it is invalidated by a 'config.change' event or by a change made through UciHandle. Caching is
+ * only enabled while the 'config.change' listener is connected, since changes could be missed otherwise.
+ *
+ * Not every commit raises an event ('uci commit' on the command line does not), so a lookup also checks that the package file
+ * in the config directory is the one that was read, and that the package is younger than the maximum age.
+ */
+class PackageCache
+{
+  public:
+    /* value of a section ("s": section type) or an option ("s.o": option value or list values) */
+    struct Entry
+    {
+        bool isList;
+        std::vector<std::string> values;
+    };
+
+    struct Package
+    {
+        /* flat map of "s" and "s.o" to values */
+        std::unordered_map<std::string /*"s" or "s.o"*/, Entry> entries;
+
+        /* map of "@SectionType[#]" to SectionName (or SectionCFGID) */
+        std::unordered_map<std::string /*"@SectionType[#]"*/, std::string /*SectionName*/> aliases;
+
+        /* the package file and the time, before the package was read (see stamp()) */
+        struct stat file;
+        std::chrono::steady_clock::time_point readAt;
+    };
+
+    enum class LookupResult : std::uint8_t
+    {
+        NOT_CACHED,
+        FOUND,
+        NOT_FOUND
+    };
+
+    /*! @brief constructor
+     *
+     * @param[in] configDir directory of the package files
+     * @param[in] maxAge time after which a cached package is read again, even if its file is unchanged
+     */
+    explicit PackageCache(const std::string &configDir = "/etc/config", std::chrono::seconds maxAge = std::chrono::seconds(60))
+        : _classMutex(), _packages(), _generation(0), _enabled(false), _configDir(configDir), _maxAge(maxAge)
+    {
+    }
+
+    /*! @brief look up a section type ("p.s") or an option value ("p.s.o") in a cached package
+     *
+     * @param[in] pkg package name
+     * @param[in] sec SectionName, SectionCFGID or "@SectionType[#]"
+     * @param[in] opt option name, or empty string for the section type
+     * @param[out] entry value, if found
+     *
+     * @return NOT_CACHED, if the package is not cached, its file has changed or it is older than the maximum age.
+     */
+    LookupResult lookup(const std::string &pkg, const std::string &sec, const std::string &opt, Entry &entry);
+
+    /*! @brief get the generation to pass to store(), before reading a package */
+    uint64_t getGeneration();
+
+    /*! @brief record the package file and the time in a package, before reading it
+     *
+     * @param[in] pkg package name
+     * @param[out] package package to be read
+     *
+     * @return false, if the package file cannot be stat'ed. The package should not be stored then.
+     */
+    bool stamp(const std::string &pkg, Package &package);
+
+    /*! @brief cache a package, unless the cache has been invalidated or disabled since the package was read
+     *
+     * @param[in] pkg package name
+     * @param[in] package package contents
+     * @param[in] generation the value of getGeneration() before the package was read
+     */
+    void store(const std::string &pkg, Package &&package, uint64_t generation);
+
+    /*! @brief drop a cached package (all packages if pkg is empty) */
+    void invalidate(const std::string &pkg);
+
+    /*! @brief enable or disable caching, dropping all cached packages */
+    void setEnabled(bool enabled);
+
+  private:
+    std::mutex _classMutex;
+    std::unordered_map<std::string /*package name*/, Package> _packages;
+    uint64_t _generation;
+    bool _enabled;
+    const std::string _configDir;
+    const std::chrono::steady_clock::duration _maxAge;
+
+    bool _isFresh(const std::string &pkg, const Package &package);
+};
+///////////////////////////////////////////////////////////////////////////////////////////////
+
 
 /*### Classes for UBUS context ###*/
 ///////////////////////////////////////////////////////////////////////////////////////////////
 class Context : public fw::utils::Singleton<Context>
 {
   public:
+    /* callback type for UCI package changes (package name, empty if unknown) */
+    typedef std::function<void(const std::string &)> configChangeCallback_t;
+
     struct ubus_context* getUbusCtx() const noexcept { return _ubusCtx; }
 
+    /*! @brief invoke a method of a ubus object
+     *
+     * @param[in] path ubus object path (Ex: "uci", "session")
+     * @param[in] method method name
+     * @param[in] msg method arguments
+     * @param[in] cb reply callback (can be nullptr)
+     * @param[in] priv user data for cb
+     * @param[in] timeout timeout in milliseconds
+     *
+     * @return UBUS_STATUS_* code
+     * @note Object ids are cached, and looked up again when ubusd reports UBUS_STATUS_NOT_FOUND or after reconnecting.
+     * @note Calls are serialized, so this can be called from any thread.
+     */
+    int ubusInvoke(const std::string &path, const std::string &method, struct blob_attr *msg, ubus_data_handler_t cb, void *priv,
+            int timeout = 3000 /*milliseconds*/);
+
     Json::StreamWriterBuilder &getJsonWbuilder() noexcept { return _jsonWriterBuilder; }
 
     Json::CharReaderBuilder &getJsonRbuilder() noexcept { return _jsonReaderBuilder; }
@@ -419,6 +552,34 @@ class Context : public fw::utils::Singleton<Context>
 
     SubscribeList &getSubscribeObj() noexcept { return _subscribeObj; }
 
+    PackageCache &getPackageCache() noexcept { return _packageCache; }
+
+    /*! @brief start listening for ubus 'config.change' events
+     *
+     * @param[in] cb callback which is called on the listener thread with the name of each changed package
+     *
+     * @return true, if listening (or it already was)
+     * @note The listener has its own ubus connection, so it never competes with ubus calls on other threads.
+     * @note Changed packages are dropped from the package cache before cb is called.
+     */
+    bool startConfigListener(configChangeCallback_t cb);
+
+    /*! @brief stop listening for ubus 'config.change' events
+     */
+    void stopConfigListener();
+
+    /*! @brief get the name of the changed package from a 'config.change' event message
+     *
+     * @param[in] msg event message
+     *
+     * @return package name, or empty string if the message names none (then every package should be treated as changed)
+     * @note On OpenWrt, rpcd reports a commit to procd with 'service event' {"type": "config.change", "data": {"package": ...}}.
+     *       procd runs its triggers on it but does not broadcast it, so it reaches ubus listeners only when forwarded (for example
+     *       by a procd trigger running 'ubus send config.change'). Both {"package": ...} and the whole service event message are
+     *       accepted, as well as {"config": ...} from older senders.
+     */
+    static std::string configChangePackage(struct blob_attr *msg);
+
     Context();
     ~Context();
 
@@ -436,6 +597,10 @@ class Context : public fw::utils::Singleton<Context>
     // UBUS context object
     struct ubus_context *_ubusCtx;
 
+    // UBUS context lock (a UBUS context is not thread-safe) and cache of UBUS object ids
+    std::mutex _ubusMutex;
+    std::unordered_map<std::string /*object path*/, uint32_t /*object id*/> _objectIds;
+
     std::string _sessionId; // UBUS rpc session id
     std::string _sessionUser; // UBUS rpc session session username
     std::string _sessionPass; // UBUS rpc session session password
@@ -445,10 +610,26 @@ class Context : public fw::utils::Singleton<Context>
     // static object on SubscribeList
     static SubscribeList _subscribeObj;
 
+    // static object on PackageCache
+    static PackageCache _packageCache;
+
+    // 'config.change' listener: own UBUS context, event handler, thread and eventfd to stop it
+    std::mutex _listenerMutex;
+    struct ubus_context *_eventCtx;
+    struct ubus_event_handler _configChangeHandler;
+    std::thread _listenerThread;
+    int _listenerStopFd;
+    bool _listenerStopping;
+    configChangeCallback_t _configChangeCb;
+
     /** function members **/
     std::string _createSession(const std::string &user, const std::string &pass, int timeout, const std::string &owner);
     void _destroySession(const std::string &sessId);
     std::string _loginSession(const std::string &user, const std::string &pass, int timeout);
+    bool _connectConfigListener();
+    void _disconnectConfigListener();
+    void _runConfigListener();
+    static void _configChangeEventCb(struct ubus_context *ctx, struct ubus_event_handler *ev, const char *type, struct blob_attr *msg);
 };
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -494,6 +675,8 @@ class UciHandle
      * @note 2. This function works for only "p.s" and "p.s.o" format.
      *      - "p.s" format returns section type
      *      - "p.s.o" format returns option/list value.
+     * @note 3. The whole package is read on the first get and served from the package cache afterwards, until it changes or
+     *          ages out (see PackageCache).
      */
     UciValue get(const UciSecNameType &uciName, const std::string &delim = std::string(" "))
     {
@@ -654,7 +837,9 @@ class UciHandle
      */
     SubscribeList::subscribeToken_t subscribe(const UciOptNameType &uciName, subscribeCallback_t cb) {
         UciValue initialVal = get(uciName);
-        return _context().getSubscribeObj().registerSubscription(uciName.getFullpath(), cb, initialVal);
+        SubscribeList::subscribeToken_t token = _context().getSubscribeObj().registerSubscription(uciName.getFullpath(), cb, initialVal);
+        _startConfigListener();
+        return token;
     }
 
     /*! @brief deregister a subscription for UCI value changes
@@ -681,13 +866,28 @@ class UciHandle
         _context().getSubscribeObj().clearSubscription();
     }
 
+    /*! @brief re-read subscribed UCI values of a package and trigger registered callbacks of changed ones.
+     *
+     * @param[in] pkg UCI package name, or empty string for all packages
+     *
+     * @note This is called on 'config.change' events (see Context::startConfigListener()). Changes committed without rpcd (such
+     *       as with the uci command line tool), or whose event is not forwarded to ubus, raise no event, so callers should still
+     *       poll now and then (see pollSubscription()).
+     */
+    void refreshSubscription(const std::string &pkg);
+
     /*! @brief trigger registered callback if there is change.
+     *
+     * @note Events make polling often unnecessary; a slow poll only catches changes that raised no event.
      */
-    void pollSubscription();
+    void pollSubscription() { refreshSubscription(""); }
 
   private:
     static constexpr auto _context = Context::getInstance;
 
+    static bool _startConfigListener();
+    PackageCache::LookupResult _getCached(const UciNameTypeBase &uciName, PackageCache::Entry &entry);
+    bool _getPackage(const std::string &pkg, PackageCache::Package &package);
     UciValue _get(const UciNameTypeBase &uciName, const std::string &delim);
     bool _getList(const UciNameTypeBase &uciName, std::vector<std::string> &output);
     bool _set(const UciNameTypeBase &uciName, const std::string &setVal, bool commitFlag, bool createFlag);
@@ -700,6 +900,94 @@ class UciHandle
 };
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
+/*### Classes for UCI transaction ###*/
+///////////////////////////////////////////////////////////////////////////////////////////////
+/* Changes to a single package which are sent together and committed once.
+ *
+ * UciHandle::set() sends a 'uci set' per option and, with commitFlag, commits per option (and each commit makes procd reload
+ * the services of the package). A transaction sends all options set in a section with a single 'uci set', and commits once.
+ * If any change or the commit fails, the uncommitted changes of the package are reverted.
+ *
+ *   UciTransaction trans("network");
+ *   trans.set("wan", "apn", "internet").set("wan", "auth", "none").deleteElem("wan", "pincode");
+ *   if (!trans.commit()) {
+ *       // nothing has been changed
+ *   }
+ */
+class UciTransaction
+{
+  public:
+    explicit UciTransaction(const std::string &pkg) : _package(pkg), _ops() {}
+
+    /*! @brief set UCI option/list value
+     *
+     * @param[in] sec SectionName, SectionCFGID or "@SectionType[#]"
+     * @param[in] opt option name
+     * @param[in] setVal string value to set("p.s.o"="value" or "p.s.o"=string_vector)
+     *
+     * @return this transaction
+     */
+    UciTransaction &set(const std::string &sec, const std::string &opt, const std::string &setVal);
+    UciTransaction &set(const std::string &sec, const std::string &opt, const std::vector<std::string> &setList);
+
+    /*! @brief add UCI section
+     *
+     * @param[in] secType UCI section type
+     * @param[in] secName UCI section name, or empty string for an unnamed section ("@SectionType[-1]" refers to it afterwards)
+     *
+     * @return this transaction
+     */
+    UciTransaction &addSection(const std::string &secType, const std::string &secName = std::string());
+
+    /*! @brief delete UCI section or option
+     *
+     * @param[in] sec SectionName, SectionCFGID or "@SectionType[#]"
+     * @param[in] opt option name, or empty string to delete the section
+     *
+     * @return this transaction
+     */
+    UciTransaction &deleteElem(const std::string &sec, const std::string &opt = std::string());
+
+    /*! @brief send the changes in order and commit the package
+     *
+     * @return true or false
+     * @note On failure, all uncommitted changes of the package are reverted, including ones which were made before the
+     *       transaction (Ex: UciHandle::set() without commitFlag). The changes are kept, so that commit() can be retried.
+     */
+    bool commit();
+
+    /*! @brief drop the changes */
+    void clear() noexcept { _ops.clear(); }
+
+    bool empty() const noexcept { return _ops.empty(); }
+
+  private:
+    struct Operation
+    {
+        enum class Type : std::uint8_t
+        {
+            SET,
+            ADD,
+            DELETE
+        };
+
+        Type type;
+        std::string section; // SectionType for ADD
+        std::string name; // SectionName for ADD, option name for DELETE
+        std::map<std::string /*option name*/, std::pair<bool /*isList*/, std::vector<std::string>>> values; // for SET
+    };
+
+    static constexpr auto _context = Context::getInstance;
+
+    std::string _package;
+    std::vector<Operation> _ops;
+
+    void _addValue(const std::string &sec, const std::string &opt, bool isList, const std::vector<std::string> &values);
+    bool _apply(const Operation &op);
+    bool _invoke(const std::string &method, struct blob_buf &b);
+};
+///////////////////////////////////////////////////////////////////////////////////////////////
+
 }; // namespace uci
 
 #endif // NTCUCI_H_10431830012024
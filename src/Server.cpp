@@ -299,6 +299,38 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
     {
         ServerUtils::getManagedObjects(pInvocation);
     });
+
+    // The description is complete - index it for our lookups and make sure we don't report a previous server's objects
+    buildInterfaceIndex();
+    ServerUtils::invalidateManagedObjects();
+}
+
+// Builds our index of interfaces from the server description
+//
+// Where more than one interface shares the same object path and name, the first one found (in the order that a search of the tree
+// would find it) is kept.
+void Server::buildInterfaceIndex()
+{
+    interfaceIndex.clear();
+    for (const DBusObject &object : objects)
+    {
+        indexObject(object);
+    }
+}
+
+// Adds an object's interfaces (and those of its children) to our index of interfaces
+void Server::indexObject(const DBusObject &object)
+{
+    InterfaceIndex &interfaces = interfaceIndex[object.getPath().toString()];
+    for (std::shared_ptr<const DBusInterface> pInterface : object.getInterfaces())
+    {
+        interfaces.emplace(pInterface->getName(), pInterface);
+    }
+
+    for (const DBusObject &child : object.getChildren())
+    {
+        indexObject(child);
+    }
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -310,16 +342,19 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 // If the interface was found, it is returned, otherwise nullptr is returned
 std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath &objectPath, const std::string &interfaceName) const
 {
-    for (const DBusObject &object : objects)
+    auto objectIt = interfaceIndex.find(objectPath.toString());
+    if (objectIt == interfaceIndex.end())
     {
-        std::shared_ptr<const DBusInterface> pInterface = object.findInterface(objectPath, interfaceName);
-        if (pInterface != nullptr)
-        {
-            return pInterface;
-        }
+        return nullptr;
     }
 
-    return nullptr;
+    auto interfaceIt = objectIt->second.find(interfaceName);
+    if (interfaceIt == objectIt->second.end())
+    {
+        return nullptr;
+    }
+
+    return interfaceIt->second;
 }
 
 // Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
@@ -327,15 +362,13 @@ std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath
 // If the method was called, this method returns true, otherwise false. There is no result from the method call itself.
 bool Server::callMethod(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-    for (const DBusObject &object : objects)
+    std::shared_ptr<const DBusInterface> pInterface = findInterface(objectPath, interfaceName);
+    if (nullptr == pInterface)
     {
-        if (object.callMethod(objectPath, interfaceName, methodName, pConnection, pParameters, pInvocation, pUserData))
-        {
-            return true;
-        }
+        return false;
     }
 
-    return false;
+    return pInterface->callMethod(methodName, pConnection, pParameters, pInvocation, pUserData);
 }
 
 // Find a GATT Property within the given D-Bus object on the given D-Bus interface
@@ -30,6 +30,7 @@
 #include <vector>
 #include <list>
 #include <memory>
+#include <unordered_map>
 
 #include "../include/Gobbledegook.h"
 #include "DBusObject.h"
@@ -180,6 +181,11 @@ struct Server
     // If the property was found, it is returned, otherwise nullptr is returned
     const GattProperty *findProperty(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &propertyName) const;
 
+    // Stops the threads of the service plugins (see `registerServicePlugins()`)
+    //
+    // Called when the server stops, so a plugin's threads are joined then rather than during static destruction
+    void stopServicePlugins();
+
 private:
 
     // Our server's objects
@@ -240,6 +246,19 @@ private:
 
     // register customised GATT services and Characteristics.
     void registerServicePlugins();
+
+    // Our index of interfaces, keyed by full object path and then by interface name
+    //
+    // The server description is immutable once constructed, so this is built once at the end of the constructor (see
+    // `buildInterfaceIndex()`) and used for every lookup from then on.
+    typedef std::unordered_map<std::string, std::shared_ptr<const DBusInterface> > InterfaceIndex;
+    std::unordered_map<std::string, InterfaceIndex> interfaceIndex;
+
+    // Builds `interfaceIndex` from the server description
+    void buildInterfaceIndex();
+
+    // Adds an object's interfaces (and those of its children) to `interfaceIndex`
+    void indexObject(const DBusObject &object);
 };
 
 // Our one and only server. It's a global.
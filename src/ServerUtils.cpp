@@ -25,6 +25,7 @@
 
 #include <glib.h>
 #include <string>
+#include <atomic>
 #include <fstream>
 #include <regex>
 
@@ -56,7 +57,7 @@ namespace ggk {
 //     the empty dict is returned.
 //
 //     (a{oa{sa{sv}}})
-static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath &basePath, GVariantBuilder *pObjectArray)
+static void addManagedObjectsNode(const DBusObject &object, GVariantBuilder *pObjectArray)
 {
     if (!object.isPublished())
     {
@@ -65,7 +66,7 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 
     if (!object.getInterfaces().empty())
     {
-        DBusObjectPath path = basePath + object.getPathNode();
+        const DBusObjectPath &path = object.getPath();
         Logger::debug(SSTR << "  Object: " << path);
 
         GVariantBuilder *pInterfaceArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
@@ -175,23 +176,54 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 
     for (const DBusObject &child : object.getChildren())
     {
-        addManagedObjectsNode(child, basePath + object.getPathNode(), pObjectArray);
+        addManagedObjectsNode(child, pObjectArray);
     }
 }
 
+// Our cached response to the method call `GetManagedObjects` (see `getManagedObjects()`)
+static GVariant *pManagedObjectsReply = nullptr;
+static std::atomic<bool> managedObjectsReplyValid(false);
+
 // Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+//
+// The response only depends on the server description and its property values, so it is built once and cached. The cached reply
+// is rebuilt on the next call after `invalidateManagedObjects()` has been called.
 void ServerUtils::getManagedObjects(GDBusMethodInvocation *pInvocation)
 {
-    Logger::debug(SSTR << "Reporting managed objects");
-
-    GVariantBuilder *pObjectArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-    for (const DBusObject &object : TheServer->getObjects())
+    if (!managedObjectsReplyValid.exchange(true) || nullptr == pManagedObjectsReply)
     {
-        addManagedObjectsNode(object, DBusObjectPath(""), pObjectArray);
+        Logger::debug(SSTR << "Building managed objects");
+
+        GVariantBuilder *pObjectArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+        for (const DBusObject &object : TheServer->getObjects())
+        {
+            addManagedObjectsNode(object, pObjectArray);
+        }
+
+        // Build the new reply before releasing the old one, as property values may be owned by the old reply
+        GVariant *pReply = g_variant_ref_sink(g_variant_new("(a{oa{sa{sv}}})", pObjectArray));
+        g_variant_builder_unref(pObjectArray);
+
+        if (nullptr != pManagedObjectsReply)
+        {
+            g_variant_unref(pManagedObjectsReply);
+        }
+
+        pManagedObjectsReply = pReply;
     }
 
-    GVariant *pParams = g_variant_new("(a{oa{sa{sv}}})", pObjectArray);
-    g_dbus_method_invocation_return_value(pInvocation, pParams);
+    Logger::debug(SSTR << "Reporting managed objects");
+
+    // Our reply is not floating, so the invocation takes its own reference and our cached copy remains intact
+    g_dbus_method_invocation_return_value(pInvocation, pManagedObjectsReply);
+}
+
+// Invalidates the cached response to the method call `GetManagedObjects`
+//
+// This must be called whenever the server description or any of its property values change.
+void ServerUtils::invalidateManagedObjects()
+{
+    managedObjectsReplyValid = false;
 }
 
 // WARNING: Hacky code - don't count on this working properly on all systems
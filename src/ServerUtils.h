@@ -32,8 +32,15 @@ namespace ggk {
 struct ServerUtils
 {
     // Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+    //
+    // The response is built once and cached until `invalidateManagedObjects()` is called.
     static void getManagedObjects(GDBusMethodInvocation *pInvocation);
 
+    // Invalidates the cached response to the method call `GetManagedObjects`
+    //
+    // This must be called whenever the server description or any of its property values change.
+    static void invalidateManagedObjects();
+
     // WARNING: Hacky code - don't count on this working properly on all systems
     //
     // This routine will attempt to parse /proc/cpuinfo to return the CPU count/model. Results are cached on the first call, with
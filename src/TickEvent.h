@@ -119,7 +119,7 @@ struct TickEvent
         {
             if (nullptr != callback)
             {
-                Logger::debug(SSTR << "Ticking at path '" << path << "'");
+                GGK_DEBUG("Ticking at path '" << path << "'");
                 callback(*static_cast<const T *>(pOwner), *this, pConnection, pUserData);
             }
 
@@ -0,0 +1,144 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A small, bounded pool of worker threads for running blocking characteristic handlers off the main loop
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Every D-Bus method call is dispatched on the GLib main loop, so a handler that blocks (waiting on ubus, a child process or the
+// network) stalls every other client and every BlueZ callback until it returns. Characteristics that register their handlers
+// with `onReadValueAsync()`/`onWriteValueAsync()` have them run here instead, and the method call is completed back on the main
+// loop once the handler returns (see GattCharacteristic.cpp.)
+//
+// The pool is deliberately small and its queue bounded: if the workers can't keep up, new jobs are refused (and the caller
+// fails the method call) rather than letting slow handlers pile up without limit. The workers are started on first use, so a
+// server that never uses an async handler never creates them.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "WorkerPool.h"
+#include "Logger.h"
+
+namespace ggk {
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+// Queues a job to be run on a worker thread, starting the workers if they aren't running
+//
+// If the pool is stopped before the job starts, `cancel` is called instead (on the thread calling `stop()`), so that whatever
+// the job owns can be released.
+//
+// Returns false if the queue is full or the pool is stopping, in which case neither the job nor `cancel` is called
+bool WorkerPool::submit(Job job, Job cancel)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (stopping)
+        {
+            return false;
+        }
+
+        if (jobs.size() >= kMaxQueuedJobs)
+        {
+            Logger::warn(SSTR << "Worker pool queue is full (" << kMaxQueuedJobs << " jobs), refusing job");
+            return false;
+        }
+
+        if (workers.empty())
+        {
+            GGK_DEBUG("Starting " << kWorkerCount << " worker threads");
+            for (int i = 0; i < kWorkerCount; ++i)
+            {
+                workers.emplace_back(&WorkerPool::runWorker, this);
+            }
+        }
+
+        jobs.push_back(QueuedJob{std::move(job), std::move(cancel)});
+    }
+
+    jobsAvailable.notify_one();
+    return true;
+}
+
+// Stops the workers, waiting for any jobs in progress to finish
+//
+// Jobs still waiting in the queue are cancelled rather than run. The workers are started again by the next `submit()`.
+void WorkerPool::stop()
+{
+    std::vector<std::thread> stoppingWorkers;
+    std::deque<QueuedJob> cancelledJobs;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (workers.empty())
+        {
+            return;
+        }
+
+        stopping = true;
+        cancelledJobs.swap(jobs);
+        stoppingWorkers.swap(workers);
+    }
+
+    jobsAvailable.notify_all();
+
+    // Cancel outside the lock, as a cancelled job may well answer a D-Bus call or log
+    if (!cancelledJobs.empty())
+    {
+        Logger::warn(SSTR << "Cancelling " << cancelledJobs.size() << " queued worker job(s)");
+        for (QueuedJob &job : cancelledJobs)
+        {
+            if (job.cancel)
+            {
+                job.cancel();
+            }
+        }
+    }
+
+    for (std::thread &worker : stoppingWorkers)
+    {
+        worker.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = false;
+}
+
+// Entry point for a worker thread
+void WorkerPool::runWorker()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        jobsAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+
+        Job job = std::move(jobs.front().run);
+        jobs.pop_front();
+
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+}; // namespace ggk
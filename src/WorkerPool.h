@@ -0,0 +1,92 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A small, bounded pool of worker threads for running blocking characteristic handlers off the main loop
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of WorkerPool.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ggk {
+
+class WorkerPool
+{
+public:
+
+    // A unit of work
+    typedef std::function<void()> Job;
+
+    // The number of worker threads
+    static const int kWorkerCount = 4;
+
+    // The most jobs that may be waiting for a worker
+    static const size_t kMaxQueuedJobs = 32;
+
+    // Returns the instance to this singleton class
+    static WorkerPool &getInstance()
+    {
+        static WorkerPool instance;
+        return instance;
+    }
+
+    WorkerPool(WorkerPool const&) = delete;
+    void operator=(WorkerPool const&) = delete;
+
+    // Queues a job to be run on a worker thread, starting the workers if they aren't running
+    //
+    // If the pool is stopped before the job starts, `cancel` is called instead (on the thread calling `stop()`), so that whatever
+    // the job owns can be released.
+    //
+    // Returns false if the queue is full or the pool is stopping, in which case neither the job nor `cancel` is called
+    bool submit(Job job, Job cancel = nullptr);
+
+    // Stops the workers, waiting for any jobs in progress to finish
+    //
+    // Jobs still waiting in the queue are cancelled rather than run. The workers are started again by the next `submit()`.
+    void stop();
+
+private:
+
+    WorkerPool() {}
+    ~WorkerPool();
+
+    // Entry point for a worker thread
+    void runWorker();
+
+    std::mutex mutex;
+    std::condition_variable jobsAvailable;
+    // A queued job and what to call if it is never run
+    struct QueuedJob
+    {
+        Job run;
+        Job cancel;
+    };
+
+    std::deque<QueuedJob> jobs;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
+
+}; // namespace ggk
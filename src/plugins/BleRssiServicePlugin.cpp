@@ -1,17 +1,33 @@
 /*
  * GATT BLE Signal Strength service plugin
+ *
+ * RSSI is sampled by a background thread which keeps the HCI device open and reads the RSSI of every LE connection once per
+ * sample interval. ReadValue is then served from memory, so the GLib main loop never waits on the controller. When a client
+ * enables notifications, a change notification is sent whenever the smoothed RSSI moves by the configured threshold.
  */
 
+// <cmath> must come before NtcLogger.h (included through our header), whose log() macro breaks it
+#include <cmath>
+
 #include "BleRssiServicePlugin.h"
 
 #include <bluetooth/hci.h>
 #include <bluetooth/hci_lib.h>
-#include <sys/ioctl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "HciConnections.h"
 
-/* Unofficial value, might still change (from: bluez-5.51/tools/hcitool.c)*/
-#define LE_LINK     (0x80)
-/* The maximum number of connected peer */
-#define NUM_CONN    (1)
+/* Default, minimum and maximum RSSI sample interval (in milliseconds) */
+#define RSSI_SAMPLE_INTERVAL_MS     (1000)
+#define MIN_RSSI_SAMPLE_INTERVAL_MS (100)
+#define MAX_RSSI_SAMPLE_INTERVAL_MS (60000)
+/* Default change (in dB) of the smoothed RSSI which triggers a notification, 0 disables notifications */
+#define RSSI_NOTIFY_THRESHOLD_DB    (5)
+/* Weight of a new sample in the smoothed RSSI */
+#define RSSI_SMOOTHING_FACTOR       (0.25)
+/* Timeout of a single HCI Read RSSI command (in milliseconds) */
+#define RSSI_READ_TIMEOUT_MS        (1000)
 
 namespace ggk {
 
@@ -19,97 +35,173 @@ DEFINE_PLUGIN(BleRssiServicePlugin)
 
 /*** Class member function definitions ***/
 
-// get Bluetooth device address which is connected to GATT server.
+// get the connection handle of the central connected to GATT server.
 //
-// conAddr: pointer to store the address.
+// The connection table is kept up to date by the HciAdapter event thread, so this doesn't touch the kernel.
 //
-// return: success 0, failure -1
-bool BleRssiServicePlugin::getConnectedBdAddr(bdaddr_t *conAddr) {
-    struct hci_conn_list_req *cl = nullptr;
-    struct hci_conn_info *ci;
-    int sk = -1;
-
-    if (hciDevId < 0) {
-        hciDevId = hci_devid("hci0");
-    }
+// return: true if an LE central is connected and its handle is known.
+bool BleRssiServicePlugin::getConnectionHandle(uint16_t &handle) {
+    HciConnection connection;
 
-    sk = socket(AF_BLUETOOTH, SOCK_RAW | SOCK_CLOEXEC, BTPROTO_HCI);
-    if (sk < 0 || hciDevId < 0) {
-        return -1;
+    if (!HciConnections::getInstance().findFirstLowEnergy(connection) || connection.handle == HciConnection::kInvalidHandle) {
+        return false;
     }
 
-    if ((cl = static_cast<hci_conn_list_req *> (::operator new(NUM_CONN * sizeof(*ci) + sizeof(*cl), std::nothrow))) == nullptr) {
-        goto error;
-    }
+    handle = connection.handle;
+    return true;
+}
 
-    cl->dev_id = hciDevId;
-    cl->conn_num = NUM_CONN;
-    ci = cl->conn_info;
+// get RSSI of connectd bluetooth device from the sampler's history.
+//
+// return: json formatted BLE peer RSSI. (Ex: {"RSSI":"-85 dBm","Min":"-90 dBm","Max":"-80 dBm"} or {"RSSI":""})
+std::string BleRssiServicePlugin::getBleRssi() {
+    uint16_t handle;
+    Json::Value jRoot;
+    jRoot["RSSI"] = "";
 
-    if (ioctl(sk, HCIGETCONNLIST, static_cast<void *> (cl))) {
-        goto error;
-    }
+    if (getConnectionHandle(handle)) {
+        std::lock_guard<std::mutex> lock(statsMutex);
 
-    if (cl->conn_num != 1 || ci->type != LE_LINK){
-        goto error;
+        auto it = stats.find(handle);
+        if (it != stats.end()) {
+            jRoot["RSSI"] = std::to_string(static_cast<int>(std::lround(it->second.smoothed))) + " dBm";
+            jRoot["Min"] = std::to_string(it->second.min) + " dBm";
+            jRoot["Max"] = std::to_string(it->second.max) + " dBm";
+        }
     }
 
-    bacpy(conAddr, &ci->bdaddr);
-    delete cl;
-    close(sk);
-    return 0;
+    return Json::writeString(jsonWriterBuilder, jRoot);
+}
+
+// read the RSSI of every LE connection and update its history.
+//
+// Histories of connections which have gone away are dropped. If notifications are enabled and the smoothed RSSI of a connection
+// has moved by the threshold since the last notification, an update is queued for the RSSI characteristic.
+void BleRssiServicePlugin::sampleConnections() {
+    std::vector<HciConnection> connections = HciConnections::getInstance().snapshot();
+    std::unordered_map<uint16_t, int8_t> samples;
+
+    for (const HciConnection &connection : connections) {
+        if (!connection.isLowEnergy() || connection.handle == HciConnection::kInvalidHandle) {
+            continue;
+        }
+
+        if (fdDevice < 0) {
+            if (hciDevId < 0) {
+                hciDevId = hci_devid("hci0");
+            }
+            if (hciDevId < 0 || (fdDevice = hci_open_dev(hciDevId)) < 0) {
+                return;
+            }
+        }
+
+        int8_t rssi;
+        if (hci_read_rssi(fdDevice, htobs(connection.handle), &rssi, RSSI_READ_TIMEOUT_MS) < 0) {
+            // the adapter went away, reopen it on the next pass
+            if (errno == ENODEV || errno == ENETDOWN || errno == EBADF) {
+                close(fdDevice);
+                fdDevice = -1;
+                hciDevId = -1;
+            }
+            continue;
+        }
 
-error:
-    delete cl;
-    if (sk >= 0) {
-        close(sk);
+        samples[connection.handle] = rssi;
     }
-    return -1;
 
-}
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
 
-// get RSSI of connectd bluetooth device.
-//
-// return: json formatted BLE peer RSSI. (Ex: {"RSSI":"-85 dBm"} or {"RSSI":""})
-std::string BleRssiServicePlugin::getBleRssi() {
-    bdaddr_t connectedAddr;
-    struct hci_conn_info_req *cr = nullptr;
-    int dd = -1;
-    int8_t rssi;
-    Json::Value jRoot;
-    jRoot["RSSI"] = "";
+        for (auto it = stats.begin(); it != stats.end(); ) {
+            bool connected = false;
+            for (const HciConnection &connection : connections) {
+                connected = connected || connection.handle == it->first;
+            }
+            it = connected ? std::next(it) : stats.erase(it);
+        }
+
+        for (const auto &sample : samples) {
+            auto it = stats.find(sample.first);
+            if (it == stats.end()) {
+                RssiStats &entry = stats[sample.first];
+                entry.smoothed = sample.second;
+                entry.latest = entry.min = entry.max = sample.second;
+                entry.samples = 1;
+                entry.lastNotified = sample.second;
+                notify = true;
+                continue;
+            }
 
-    if(getConnectedBdAddr(&connectedAddr) != 0 or hciDevId < 0) {
-        goto finish;
+            RssiStats &entry = it->second;
+            entry.smoothed += RSSI_SMOOTHING_FACTOR * (sample.second - entry.smoothed);
+            entry.latest = sample.second;
+            entry.min = std::min(entry.min, sample.second);
+            entry.max = std::max(entry.max, sample.second);
+            entry.samples += 1;
+
+            if (notifyThresholdDb != 0 && std::fabs(entry.smoothed - entry.lastNotified) >= notifyThresholdDb) {
+                entry.lastNotified = entry.smoothed;
+                notify = true;
+            }
+        }
     }
 
-    dd = hci_open_dev(hciDevId);
-    if (dd < 0) {
-        goto finish;
+    if (!notify || notifyThresholdDb == 0) {
+        return;
     }
 
-    if ((cr = static_cast<hci_conn_info_req *> (::operator new(sizeof(*cr) + sizeof(struct hci_conn_info), std::nothrow))) == nullptr) {
-        goto finish;
+    const GattCharacteristic *pCharacteristic = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(notifyMutex);
+        if (notifySubscribers != 0) {
+            pCharacteristic = notifyCharacteristic;
+        }
     }
 
-    bacpy(&cr->bdaddr, &connectedAddr);
-    cr->type = LE_LINK;
-    if (ioctl(dd, HCIGETCONNINFO, reinterpret_cast<unsigned long> (cr)) < 0) {
-        goto finish;
+    if (pCharacteristic != nullptr) {
+        pushUpdateQueue(*pCharacteristic);
     }
+}
 
-    if (hci_read_rssi(dd, htobs(cr->conn_info->handle), &rssi, 1000) < 0) {
-        goto finish;
+// count a StartNotify on the RSSI characteristic.
+void BleRssiServicePlugin::startNotify(const GattCharacteristic &characteristic) {
+    std::lock_guard<std::mutex> lock(notifyMutex);
+    notifyCharacteristic = &characteristic;
+    notifySubscribers += 1;
+}
+
+// count a StopNotify on the RSSI characteristic; notifications stop once every StartNotify has been matched.
+void BleRssiServicePlugin::stopNotify() {
+    std::lock_guard<std::mutex> lock(notifyMutex);
+    if (notifySubscribers != 0) {
+        notifySubscribers -= 1;
     }
+}
+
+// sampler thread: samples every sample interval until the plugin is stopped.
+//
+// Nothing is sampled unless the server is running (the connection table is cleared when the server stops).
+void BleRssiServicePlugin::runSampler() {
+    std::unique_lock<std::mutex> lock(samplerMutex);
 
-    jRoot["RSSI"] = std::to_string(rssi) + " dBm";
+    while (!samplerStop) {
+        lock.unlock();
+        if (ggkGetServerRunState() == ERunning && HciConnections::getInstance().count() != 0) {
+            sampleConnections();
+        } else {
+            std::lock_guard<std::mutex> statsLock(statsMutex);
+            stats.clear();
+        }
+        lock.lock();
 
-finish:
-    delete cr;
-    if ( dd >= 0) {
-        close(dd);
+        samplerCv.wait_for(lock, std::chrono::milliseconds(sampleIntervalMS), [this] { return samplerStop; });
+    }
+
+    if (fdDevice >= 0) {
+        close(fdDevice);
+        fdDevice = -1;
     }
-    return Json::writeString(jsonWriterBuilder, jRoot);
 }
 
 /*** Class constructor definition ***/
@@ -117,13 +209,36 @@ BleRssiServicePlugin::BleRssiServicePlugin(DBusObject &obj)
 {
     INIT_PLUGIN();
 
+    sampleIntervalMS = uciHdl.get({"gattserver", "config", "rssi_interval_ms"}).toInt<unsigned int>(RSSI_SAMPLE_INTERVAL_MS);
+    if (sampleIntervalMS < MIN_RSSI_SAMPLE_INTERVAL_MS)
+        sampleIntervalMS = MIN_RSSI_SAMPLE_INTERVAL_MS;
+    if (sampleIntervalMS > MAX_RSSI_SAMPLE_INTERVAL_MS)
+        sampleIntervalMS = MAX_RSSI_SAMPLE_INTERVAL_MS;
+
+    notifyThresholdDb = uciHdl.get({"gattserver", "config", "rssi_notify_threshold"}).toInt<unsigned int>(RSSI_NOTIFY_THRESHOLD_DB);
+
     /* Register GATT Service/Characteristic handlers */
     obj.gattServiceBegin("rssiService", RSSI_UUID)
-        .gattCharacteristicBegin("rssiCharacteristic", BLE_RSSI_UUID, {"encrypt-read"})
+        .gattCharacteristicBegin("rssiCharacteristic", BLE_RSSI_UUID, {"encrypt-read", "notify"})
             .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
             {
                 self.methodReturnValue(pInvocation, PLUGIN->getBleRssi(), true);
             })
+            .onUpdatedValue(CHARACTERISTIC_UPDATED_VALUE_CALLBACK_LAMBDA
+            {
+                self.sendChangeNotificationValue(pConnection, PLUGIN->getBleRssi());
+                return true;
+            })
+            .onStartNotify(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+            {
+                PLUGIN->startNotify(self);
+                self.methodReturnVariant(pInvocation, NULL); // should free pInvocation
+            })
+            .onStopNotify(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+            {
+                PLUGIN->stopNotify();
+                self.methodReturnVariant(pInvocation, NULL); // should free pInvocation
+            })
             .gattDescriptorBegin("description", "2901", {"encrypt-read"})
                 .onReadValue(DESCRIPTOR_METHOD_CALLBACK_LAMBDA
                 {
@@ -133,6 +248,28 @@ BleRssiServicePlugin::BleRssiServicePlugin(DBusObject &obj)
             .gattDescriptorEnd()
         .gattCharacteristicEnd()
     .gattServiceEnd();
+
+    samplerThread = std::thread(&BleRssiServicePlugin::runSampler, this);
+}
+
+/*** Class destructor definition ***/
+BleRssiServicePlugin::~BleRssiServicePlugin()
+{
+    stop();
+}
+
+// stop the sampler thread and wait for it to finish.
+void BleRssiServicePlugin::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(samplerMutex);
+        samplerStop = true;
+    }
+    samplerCv.notify_all();
+
+    if (samplerThread.joinable()) {
+        samplerThread.join();
+    }
 }
 
 }; // namespace ggk
@@ -9,22 +9,63 @@
 
 #include <bluetooth/bluetooth.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 namespace ggk {
 
 class BleRssiServicePlugin : public NtcServicePluginBase
 {
   public:
     BleRssiServicePlugin(DBusObject &obj);
+    virtual ~BleRssiServicePlugin();
+
+    void stop() override;
 
   private:
     /** type members **/
+    // RSSI history of a single connection, in dBm
+    struct RssiStats {
+        double smoothed;        // exponentially weighted moving average of the samples
+        int8_t latest;
+        int8_t min;
+        int8_t max;
+        uint32_t samples;
+        double lastNotified;    // smoothed value at the last change notification
+    };
 
     /** data members **/
     int hciDevId = -1;
+    int fdDevice = -1;
+
+    // sampler configuration (gattserver.config.rssi_interval_ms, gattserver.config.rssi_notify_threshold)
+    unsigned int sampleIntervalMS;
+    unsigned int notifyThresholdDb;
+
+    // RSSI history per connection handle, written by the sampler thread
+    std::mutex statsMutex;
+    std::unordered_map<uint16_t, RssiStats> stats;
+
+    std::thread samplerThread;
+    std::mutex samplerMutex;
+    std::condition_variable samplerCv;
+    bool samplerStop = false;
+
+    // StartNotify calls not yet matched by a StopNotify on the RSSI characteristic, so one client's StopNotify doesn't silence
+    // the others
+    std::mutex notifyMutex;
+    const GattCharacteristic *notifyCharacteristic = nullptr;
+    unsigned int notifySubscribers = 0;
 
     /** function members **/
-    bool getConnectedBdAddr(bdaddr_t *conAddr);
+    bool getConnectionHandle(uint16_t &handle);
     std::string getBleRssi();
+    void runSampler();
+    void sampleConnections();
+    void startNotify(const GattCharacteristic &characteristic);
+    void stopNotify();
 };
 
 }; // namespace ggk
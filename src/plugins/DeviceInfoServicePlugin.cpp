@@ -3,6 +3,9 @@
  */
 #include "DeviceInfoServicePlugin.h"
 
+/* How long the replies of rarely changing characteristics are served from the read cache (in milliseconds) */
+#define READ_CACHE_TTL_MS   (30000)
+
 namespace ggk {
 
 DEFINE_PLUGIN(DeviceInfoServicePlugin)
@@ -330,6 +333,7 @@ DeviceInfoServicePlugin::DeviceInfoServicePlugin(DBusObject &obj)
         .gattCharacteristicEnd()
 
         .gattCharacteristicBegin("simApnCharacteristic", SIM_APN_UUID, {"encrypt-read", "notify"})
+            .cacheFor(READ_CACHE_TTL_MS)
             .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
             {
                 self.methodReturnValue(pInvocation, PLUGIN->getSimApn(), true);
@@ -357,6 +361,7 @@ DeviceInfoServicePlugin::DeviceInfoServicePlugin(DBusObject &obj)
         .gattCharacteristicEnd()
 
         .gattCharacteristicBegin("connectivityCharacteristic", CONNECTIVITY_UUID, {"encrypt-read"})
+            .cacheFor(READ_CACHE_TTL_MS)
             .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
             {
                 self.methodReturnValue(pInvocation, PLUGIN->getConnectivity(), true);
@@ -425,6 +430,7 @@ DeviceInfoServicePlugin::DeviceInfoServicePlugin(DBusObject &obj)
         .gattCharacteristicEnd()
 
         .gattCharacteristicBegin("supportedBandsCharacteristic", SUPPORTED_BANDS_UUID, {"encrypt-read", "notify"})
+            .cacheFor(READ_CACHE_TTL_MS)
             .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
             {
                 self.methodReturnValue(pInvocation, PLUGIN->getSupportedBands(), true);
@@ -17,6 +17,7 @@
 #include "GattCharacteristic.h"
 #include "GattDescriptor.h"
 #include "Logger.h"
+#include "Init.h"
 
 #include "NtcLogger.h"
 #include "NtcUci.h"
@@ -36,6 +37,9 @@ class NtcServicePluginBase
 
     virtual ~NtcServicePluginBase() {};
 
+    // stop any threads of the plugin. Called when the server stops (see Server::stopServicePlugins()), and safe to call again.
+    virtual void stop() {};
+
   protected:
     /** type members **/
     using jsonReaderPtr = std::unique_ptr<Json::CharReader>;
@@ -67,7 +71,7 @@ class NtcServicePluginBase
 #define UCI_SUBSCRIBE_FOR_CHANGE(token, pkg, sec, opt)         \
   if(!uciHdl.isSubscribed(PLUGIN->token)) {                            \
     PLUGIN->token = uciHdl.subscribe({pkg, sec, opt}, [&self]() {      \
-      ggkNofifyUpdatedCharacteristic(self.getPath().c_str());  \
+      pushUpdateQueue(self);                                   \
       });                                                      \
   }
 
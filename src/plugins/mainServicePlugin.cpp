@@ -19,4 +19,11 @@ void Server::registerServicePlugins()
 
 }
 
+void Server::stopServicePlugins()
+{
+    for (const std::shared_ptr<NtcServicePluginBase> &plugin : plugins) {
+        plugin->stop();
+    }
+}
+
 }; // namespace ggk
@@ -111,6 +111,8 @@
 #define PAIRING_GRACE_TIME  600  // When bonding window is open, how many seconds to allow unpaired connections (waiting for user to click "Paired")
 #define BONDING_WINDOW_TIME 600 // How long after startup to keep bonding window open - production value should be 600 seconds
 
+#define UCI_POLL_INTERVAL 30 // How often (seconds) to re-read UCI subscriptions, for changes which raised no 'config.change' event
+
 #define MIN_BONDING_WINDOW_TIME 100
 #define MAX_BONDING_WINDOW_TIME 86400
 
@@ -203,13 +205,15 @@ int main(int argc, char **ppArgv)
     int syslogLevel = LOG_ERR;
     bool isBondable = true;
 
-    std::chrono::steady_clock::time_point now, timeoutBondingWindow, timeoutGraceTime;
+    std::chrono::steady_clock::time_point now, timeoutBondingWindow, timeoutGraceTime, timeoutUciPoll;
     unsigned int bondingWindowDur;
 
     uci::UciHandle uciHdl;
     fw::NtcDbus dbusHdl;
 
-    while (((optc = getopt(argc, ppArgv, "gvdng:l:"))) != -1) {
+    const char *hciTraceFile = nullptr;
+
+    while (((optc = getopt(argc, ppArgv, "gvdng:l:t:"))) != -1) {
         switch(optc) {
             case 'q':
                 logLevel = ErrorsOnly;
@@ -242,14 +246,19 @@ int main(int argc, char **ppArgv)
                 syslogLevel += LOG_ERR;
                 break;
 
+            case 't': // HCI packet trace file
+                hciTraceFile = optarg;
+                break;
+
             default:
                 LogFatal("");
-                LogFatal("Usage: ggk-standalone [-q | -v | -d | -n | -l level]");
+                LogFatal("Usage: ggk-standalone [-q | -v | -d | -n | -l level | -t file]");
                 LogFatal("\t-q: Error only log level");
                 LogFatal("\t-v: Verbose log level");
                 LogFatal("\t-d: Debug log level");
                 LogFatal("\t-n: Disable Pairing timeout");
                 LogFatal("\t-l level: Set syslog verbosity[0-4]");
+                LogFatal("\t-t file: Trace HCI management packets to a btsnoop file");
                 return -1;
         }
     }
@@ -259,15 +268,23 @@ int main(int argc, char **ppArgv)
     signal(SIGTERM, signalHandler);
 
     // Register our loggers
-    ggkLogRegisterDebug(LogDebug);
-    ggkLogRegisterInfo(LogInfo);
-    ggkLogRegisterStatus(LogStatus);
+    //
+    // Levels filtered out by `logLevel` are left unregistered so the server can skip building their messages entirely
+    ggkLogRegisterDebug(logLevel <= Debug ? LogDebug : nullptr);
+    ggkLogRegisterInfo(logLevel <= Verbose ? LogInfo : nullptr);
+    ggkLogRegisterStatus(logLevel <= Normal ? LogStatus : nullptr);
     ggkLogRegisterWarn(LogWarn);
     ggkLogRegisterError(LogError);
     ggkLogRegisterFatal(LogFatal);
     ggkLogRegisterAlways(LogAlways);
     ggkLogRegisterTrace(LogTrace);
 
+    // Trace HCI packets in binary (1MB per file, two files) rather than hex dumping them into the debug log
+    if (hciTraceFile != nullptr && !ggkHciTraceStart(hciTraceFile, 1024 * 1024))
+    {
+        LogWarn("Unable to start HCI packet tracing");
+    }
+
     fw::Logger::getInstance().setup(LOG_INFO);
 
     const char *advName;
@@ -303,6 +320,7 @@ int main(int argc, char **ppArgv)
     now = std::chrono::steady_clock::now();
     timeoutBondingWindow = now + std::chrono::seconds(bondingWindowDur);
     timeoutGraceTime = now + std::chrono::seconds(PAIRING_GRACE_TIME);
+    timeoutUciPoll = now + std::chrono::seconds(UCI_POLL_INTERVAL);
 
 #ifdef V_GATT_SERVER_AUTH_y
     log(LOG_ERR, "BLE Authentication is enabled");
@@ -352,14 +370,15 @@ int main(int argc, char **ppArgv)
         }
 
         // A case that a peer is connected but not paired, yet.
-        if (!fw::niceMode && dbusHdl.checkConnectionsForPairing(false))
+        if (!fw::niceMode && dbusHdl.checkConnectionsForPairing())
         {
             if (!ggkGetActiveConnections())
             {
                 LogWarn("unpaired connection detected but no connections..  this is weird, power cycle time!");
                 ggkSetDasBootFlag();
             }
-            if (now >= timeoutGraceTime)
+            // Only the kernel knows about a bonded peer that reconnected without pairing again, so ask it before dropping anyone
+            if (now >= timeoutGraceTime && dbusHdl.confirmConnectionsForPairing())
             {
                 if (now < timeoutBondingWindow) {
                     log(LOG_ERR, "PAIRING_GRACE_TIMER(%d seconds) expired, terminated a session.", PAIRING_GRACE_TIME);
@@ -374,7 +393,12 @@ int main(int argc, char **ppArgv)
             timeoutGraceTime = now + std::chrono::seconds(PAIRING_GRACE_TIME);
         }
 
-        uciHdl.pollSubscription();
+        // Subscriptions follow 'config.change' events; this slow poll catches changes made without one (e.g. 'uci commit')
+        if (now >= timeoutUciPoll)
+        {
+            uciHdl.pollSubscription();
+            timeoutUciPoll = now + std::chrono::seconds(UCI_POLL_INTERVAL);
+        }
     }
 
     // Wait for the server to come to a complete stop (CTRL-C from the command line)
@@ -0,0 +1,171 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Replays connection and pairing events through `HciAdapter::processEvent()` and checks the pairing state of the connection table
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The pairing supervisor in standalone.cpp asks `NtcDbus::checkConnectionsForPairing()` on every iteration whether a central is
+// connected but not paired. That is a read of the connection table (see HciConnections.cpp), whose security levels follow the
+// management events: New Link Key and New Long Term Key mark the peer as paired, and Authentication Failed marks it as open.
+//
+// The adapter is never started; events are only parsed and dispatched. No HCI device is needed either: the kernel query made
+// when a peer connects finds no such connection, so each peer starts out open.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../HciAdapter.h"
+#include "../HciConnections.h"
+#include "../Logger.h"
+#include "../Mgmt.h"
+#include "../NtcDbus.h"
+
+using namespace ggk;
+
+// Peers, in the byte order used by mgmt events (least significant byte first)
+static const uint8_t kPhone[6] = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x11 };
+static const uint8_t kLaptop[6] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+static const uint8_t kStranger[6] = { 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6 };
+
+// Address types
+static const uint8_t kBrEdr = 0;
+static const uint8_t kLePublic = 1;
+
+static int failures = 0;
+
+// Swallow everything that gets logged
+static void logSink(const char *) {}
+
+static void check(bool condition, const char *pDescription)
+{
+    if (!condition)
+    {
+        failures += 1;
+        fprintf(stderr, "FAIL: %s\n", pDescription);
+    }
+}
+
+// Sends an event made of the peer's address and type, with `before` bytes ahead of them and `after` bytes (zeros) behind them
+static bool sendEvent(uint16_t eventCode, const uint8_t address[6], uint8_t addressType, size_t before, size_t after)
+{
+    std::vector<uint8_t> packet(sizeof(HciAdapter::HciHeader) + before + 7 + after, 0);
+
+    HciAdapter::HciHeader header;
+    header.code = eventCode;
+    header.controllerId = 0;
+    header.dataSize = static_cast<uint16_t>(packet.size() - sizeof(header));
+    header.toNetwork();
+    memcpy(packet.data(), &header, sizeof(header));
+
+    memcpy(packet.data() + sizeof(header) + before, address, 6);
+    packet[sizeof(header) + before + 6] = addressType;
+
+    return HciAdapter::getInstance().processEvent(packet.data(), packet.size());
+}
+
+// Device Connected: address, type, flags (4), EIR data length (2)
+static void connect(const uint8_t address[6], uint8_t addressType)
+{
+    check(sendEvent(Mgmt::EDeviceConnectedEvent, address, addressType, 0, 6), "connected event accepted");
+}
+
+// Device Disconnected: address, type, reason (1)
+static void disconnect(const uint8_t address[6], uint8_t addressType)
+{
+    check(sendEvent(Mgmt::EDeviceDisconnectedEvent, address, addressType, 0, 1), "disconnected event accepted");
+}
+
+// New Long Term Key: store hint (1), address, type, key type, master, encryption size, EDIV, Rand, key (1 + 1 + 1 + 2 + 8 + 16)
+static void newLongTermKey(const uint8_t address[6], uint8_t addressType)
+{
+    check(sendEvent(Mgmt::ENewLongTermKeyEvent, address, addressType, 1, 29), "new long term key event accepted");
+}
+
+// New Link Key: store hint (1), address, type, key type (1), key (16), PIN length (1)
+static void newLinkKey(const uint8_t address[6], uint8_t addressType)
+{
+    check(sendEvent(Mgmt::ENewLinkKeyEvent, address, addressType, 1, 18), "new link key event accepted");
+}
+
+// Authentication Failed: address, type, status (1)
+static void authenticationFailed(const uint8_t address[6], uint8_t addressType)
+{
+    check(sendEvent(Mgmt::EAuthenticationFailedEvent, address, addressType, 0, 1), "authentication failed event accepted");
+}
+
+// Returns the security level of a peer's connection (or ESecurityOpen if it isn't connected)
+static HciConnection::SecurityLevel securityOf(const uint8_t address[6], uint8_t addressType)
+{
+    HciConnection connection;
+    if (!HciConnections::getInstance().find(address, addressType, connection))
+    {
+        return HciConnection::ESecurityOpen;
+    }
+    return connection.securityLevel;
+}
+
+int main()
+{
+    // Never reach out to D-Bus to depair anyone
+    fw::niceMode = true;
+
+    Logger::registerDebugReceiver(logSink);
+    Logger::registerWarnReceiver(logSink);
+    Logger::registerErrorReceiver(logSink);
+
+    fw::NtcDbus dbus;
+    check(!dbus.checkConnectionsForPairing(), "nobody unpaired before anyone connects");
+
+    // A phone connects and pairs
+    connect(kPhone, kLePublic);
+    check(dbus.checkConnectionsForPairing(), "new LE connection is unpaired");
+    newLongTermKey(kPhone, kLePublic);
+    check(securityOf(kPhone, kLePublic) == HciConnection::ESecurityPaired, "new long term key marks the peer paired");
+    check(!dbus.checkConnectionsForPairing(), "nobody unpaired once the phone has paired");
+
+    // BR/EDR connections aren't the supervisor's business
+    connect(kLaptop, kBrEdr);
+    check(!dbus.checkConnectionsForPairing(), "BR/EDR connection not counted");
+
+    // The phone forgets its pairing; its next attempt fails
+    authenticationFailed(kPhone, kLePublic);
+    check(securityOf(kPhone, kLePublic) == HciConnection::ESecurityOpen, "authentication failure marks the peer open");
+    check(dbus.checkConnectionsForPairing(), "phone unpaired after its authentication failure");
+    check(dbus.confirmConnectionsForPairing(), "kernel doesn't see the phone paired either");
+    newLinkKey(kPhone, kLePublic);
+    check(securityOf(kPhone, kLePublic) == HciConnection::ESecurityPaired, "new link key marks the peer paired");
+
+    // Events for peers that aren't connected change nothing
+    HciConnection connection;
+    newLongTermKey(kStranger, kLePublic);
+    check(!HciConnections::getInstance().find(kStranger, kLePublic, connection), "key event doesn't add a connection");
+
+    // A stranger connects, never pairs and leaves
+    connect(kStranger, kLePublic);
+    check(dbus.checkConnectionsForPairing(), "stranger unpaired");
+    disconnect(kStranger, kLePublic);
+    check(!dbus.checkConnectionsForPairing(), "nobody unpaired once the stranger has left");
+
+    disconnect(kPhone, kLePublic);
+    disconnect(kLaptop, kBrEdr);
+    check(HciConnections::getInstance().count() == 0, "every connection removed");
+
+    printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
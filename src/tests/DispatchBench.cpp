@@ -0,0 +1,163 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Times interface lookups and method dispatch on a large server description, through the tree and through the server's index
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Every D-Bus method call, property access and queued update finds its interface by object path. `Server::findInterface()` and
+// `Server::callMethod()` look it up in the index built when the server is constructed (see `Server::buildInterfaceIndex()`);
+// before the index they searched each object tree with `DBusObject::findInterface()` and `DBusObject::callMethod()`, building
+// the path of every object they passed. Those searches are still there, so this benchmark times both on the same tree (see
+// SyntheticTree.h): a lookup of every characteristic's interface, and a call of every characteristic's `Ping` method.
+//
+// Nothing is logged (no receivers are registered), so the times are those of the lookups themselves.
+//
+// Usage: DispatchBench [services] [characteristics per service] [rounds]
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "../DBusInterface.h"
+#include "../DBusObject.h"
+#include "../DBusObjectPath.h"
+#include "../Server.h"
+#include "SyntheticTree.h"
+
+using namespace ggk;
+
+static const int kDefaultRounds = 200;
+
+static const char *kInterfaceName = "org.bluez.GattCharacteristic1";
+
+static int services = kSyntheticServices;
+static int characteristicsPerService = kSyntheticCharacteristicsPerService;
+
+// The services of this benchmark's server, in place of plugins/mainServicePlugin.cpp
+void Server::registerServicePlugins()
+{
+    describeSyntheticTree(objects.back(), services, characteristicsPerService);
+}
+
+// The search `Server::findInterface()` made before the index
+static std::shared_ptr<const DBusInterface> searchInterface(const DBusObjectPath &path)
+{
+    for (const DBusObject &object : TheServer->getObjects())
+    {
+        std::shared_ptr<const DBusInterface> pInterface = object.findInterface(path, kInterfaceName);
+        if (nullptr != pInterface)
+        {
+            return pInterface;
+        }
+    }
+
+    return nullptr;
+}
+
+// The search `Server::callMethod()` made before the index
+static bool searchAndCall(const DBusObjectPath &path)
+{
+    for (const DBusObject &object : TheServer->getObjects())
+    {
+        if (object.callMethod(path, kInterfaceName, "Ping", nullptr, nullptr, nullptr, nullptr))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Runs `operation` on every path, `rounds` times, and returns the average time of each, in nanoseconds (or -1 if any failed)
+static double timeOperation(const std::vector<DBusObjectPath> &paths, int rounds, std::function<bool(const DBusObjectPath &)> operation)
+{
+    bool success = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (const DBusObjectPath &path : paths)
+        {
+            success = operation(path) && success;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return success ? elapsed.count() / (static_cast<double>(rounds) * paths.size()) : -1;
+}
+
+int main(int argc, char **argv)
+{
+    services = argc > 1 ? atoi(argv[1]) : kSyntheticServices;
+    characteristicsPerService = argc > 2 ? atoi(argv[2]) : kSyntheticCharacteristicsPerService;
+    int rounds = argc > 3 ? atoi(argv[3]) : kDefaultRounds;
+
+    if (services < 1 || characteristicsPerService < 1 || rounds < 1)
+    {
+        printf("Usage: %s [services] [characteristics per service] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    TheServer = std::make_shared<Server>("test", "Test", "Test", nullptr, nullptr);
+
+    std::vector<DBusObjectPath> paths;
+    for (int s = 0; s < services; ++s)
+    {
+        for (int c = 0; c < characteristicsPerService; ++c)
+        {
+            paths.push_back(DBusObjectPath(syntheticCharacteristicPath(s, c)));
+        }
+    }
+
+    // Both must find the same interface for every path
+    for (const DBusObjectPath &path : paths)
+    {
+        std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(path, kInterfaceName);
+        if (nullptr == pInterface || pInterface != searchInterface(path))
+        {
+            printf("Lookups disagree on %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    double searchNS = timeOperation(paths, rounds, [](const DBusObjectPath &path)
+    {
+        return nullptr != searchInterface(path);
+    });
+    double indexNS = timeOperation(paths, rounds, [](const DBusObjectPath &path)
+    {
+        return nullptr != TheServer->findInterface(path, kInterfaceName);
+    });
+    double searchCallNS = timeOperation(paths, rounds, searchAndCall);
+    double indexCallNS = timeOperation(paths, rounds, [](const DBusObjectPath &path)
+    {
+        return TheServer->callMethod(path, kInterfaceName, "Ping", nullptr, nullptr, nullptr, nullptr);
+    });
+
+    TheServer = nullptr;
+
+    if (searchNS < 0 || indexNS < 0 || searchCallNS < 0 || indexCallNS < 0 || syntheticPings != 2UL * rounds * paths.size())
+    {
+        printf("A lookup or call failed\n");
+        return 1;
+    }
+
+    printf("%zu characteristics (%d services of %d), %d rounds\n", paths.size(), services, characteristicsPerService, rounds);
+    printf("  findInterface: %10.1f ns searched, %10.1f ns indexed\n", searchNS, indexNS);
+    printf("  callMethod:    %10.1f ns searched, %10.1f ns indexed\n", searchCallNS, indexCallNS);
+    return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * A stand-in for ubusd, for tests of NtcUci
+ *
+ * Defines the libubus functions NtcUci.cpp calls, in place of the ones in libubus (a program's own definitions are found before
+ * those of a shared library), so uci::Context connects and calls methods without a ubusd:
+ *
+ *   - every method call is recorded, with a copy of its message, and answered by the test's handler (set with
+ *     fakeubus::setHandler()); the session methods uci::Context calls while it is being created are answered here
+ *   - every context gets a socketpair as its socket, so a thread can poll it like a ubusd connection; fakeubus::sendEvent()
+ *     queues an event for the context the 'config.change' handler is registered on and makes its socket readable, and
+ *     fakeubus::dropEventConnection() hangs up on it, as when ubusd goes away
+ *
+ * ubus_invoke() and ubus_handle_event() are inline in libubus.h: the first wraps ubus_invoke_fd(), which is defined here, and
+ * the second calls the context's socket handler, which is set here.
+ *
+ * Include this in exactly one file of a test program.
+ */
+
+#ifndef FAKEUBUS_H_10431830012024
+#define FAKEUBUS_H_10431830012024
+
+#include <sys/socket.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../NtcUci.h"
+
+namespace fakeubus {
+
+/* a method call, as the fake ubusd received it */
+struct Call {
+    std::string object;
+    std::string method;
+    std::vector<char> msg;
+
+    struct blob_attr *attr() const { return reinterpret_cast<struct blob_attr *>(const_cast<char *>(msg.data())); }
+
+    /* a string field of the message, or "" if there is none */
+    std::string field(const char *name) const
+    {
+        struct blob_attr *tb = nullptr;
+        const struct blobmsg_policy policy = { name, BLOBMSG_TYPE_STRING };
+
+        blobmsg_parse(&policy, 1, &tb, blob_data(attr()), blob_len(attr()));
+        return tb ? blobmsg_get_string(tb) : "";
+    }
+};
+
+/* answers a call: returns a UBUS_STATUS_* code, and may add a reply message to 'reply' */
+typedef std::function<int(const Call &call, struct blob_buf *reply)> handler_t;
+
+#define FAKEUBUS_SESSION_ID "fa4eba5e0000000000000000000000c0"
+
+namespace detail {
+inline std::mutex mutex;
+inline std::vector<Call> calls;
+inline handler_t handler;
+inline std::vector<std::string> objects;
+inline std::map<struct ubus_context *, int /*peer socket*/> peers;
+inline struct ubus_context *eventCtx = nullptr;
+inline struct ubus_event_handler *eventHandler = nullptr;
+inline std::deque<std::vector<char>> events;
+inline int connects = 0;
+
+inline int answerSession(const Call &call, struct blob_buf *reply)
+{
+    if (call.method == "login") {
+        blobmsg_add_string(reply, "ubus_rpc_session", FAKEUBUS_SESSION_ID);
+    }
+    return UBUS_STATUS_OK;
+}
+
+/* the context's socket is readable: deliver the queued events */
+inline void onReadable(struct uloop_fd *sock, unsigned int)
+{
+    char buf[64];
+    if (read(sock->fd, buf, sizeof(buf)) <= 0) {
+        sock->eof = true;
+        return;
+    }
+
+    while (true) {
+        std::vector<char> event;
+        struct ubus_event_handler *handler;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (events.empty() || !eventHandler) {
+                return;
+            }
+            event.swap(events.front());
+            events.pop_front();
+            handler = eventHandler;
+        }
+        handler->cb(eventCtx, handler, "config.change", reinterpret_cast<struct blob_attr *>(event.data()));
+    }
+}
+} // namespace detail
+
+inline void setHandler(handler_t handler)
+{
+    std::lock_guard<std::mutex> guard(detail::mutex);
+    detail::handler = handler;
+}
+
+/* the calls made so far to an object ("" for all), oldest first */
+inline std::vector<Call> calls(const std::string &object = "")
+{
+    std::lock_guard<std::mutex> guard(detail::mutex);
+    std::vector<Call> result;
+
+    for (auto &call : detail::calls) {
+        if (object.empty() || call.object == object)
+            result.push_back(call);
+    }
+    return result;
+}
+
+inline void clearCalls()
+{
+    std::lock_guard<std::mutex> guard(detail::mutex);
+    detail::calls.clear();
+}
+
+/* the number of contexts connected so far */
+inline int connects()
+{
+    std::lock_guard<std::mutex> guard(detail::mutex);
+    return detail::connects;
+}
+
+/* true, if a 'config.change' handler is registered on a connected context */
+inline bool eventHandlerRegistered()
+{
+    std::lock_guard<std::mutex> guard(detail::mutex);
+    return detail::eventHandler != nullptr;
+}
+
+/* queue an event built with fill() for the 'config.change' handler, and make its context readable */
+inline bool sendEvent(const std::function<void(struct blob_buf *b)> &fill)
+{
+    struct blob_buf b = {};
+    int peer;
+
+    blob_buf_init(&b, 0);
+    fill(&b);
+    {
+        std::lock_guard<std::mutex> guard(detail::mutex);
+        if (!detail::eventHandler) {
+            blob_buf_free(&b);
+            return false;
+        }
+        detail::events.emplace_back(reinterpret_cast<char *>(b.head), reinterpret_cast<char *>(b.head) + blob_pad_len(b.head));
+        peer = detail::peers[detail::eventCtx];
+    }
+    blob_buf_free(&b);
+
+    char c = 0;
+    return write(peer, &c, 1) == 1;
+}
+
+/* hang up on the context the 'config.change' handler is registered on */
+inline void dropEventConnection()
+{
+    std::lock_guard<std::mutex> guard(detail::mutex);
+    if (detail::eventCtx) {
+        shutdown(detail::peers[detail::eventCtx], SHUT_RDWR);
+    }
+}
+} // namespace fakeubus
+
+/* ---- libubus ---- */
+
+struct ubus_context *ubus_connect(const char *path)
+{
+    (void) path;
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return nullptr;
+    }
+
+    struct ubus_context *ctx = new ubus_context();
+    ctx->sock.fd = fds[0];
+    ctx->sock.cb = fakeubus::detail::onReadable;
+
+    std::lock_guard<std::mutex> guard(fakeubus::detail::mutex);
+    fakeubus::detail::peers[ctx] = fds[1];
+    fakeubus::detail::connects++;
+    return ctx;
+}
+
+void ubus_free(struct ubus_context *ctx)
+{
+    if (!ctx) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(fakeubus::detail::mutex);
+        if (fakeubus::detail::eventCtx == ctx) {
+            fakeubus::detail::eventCtx = nullptr;
+            fakeubus::detail::eventHandler = nullptr;
+            fakeubus::detail::events.clear();
+        }
+        close(fakeubus::detail::peers[ctx]);
+        fakeubus::detail::peers.erase(ctx);
+    }
+    close(ctx->sock.fd);
+    delete ctx;
+}
+
+int ubus_reconnect(struct ubus_context *ctx, const char *path)
+{
+    (void) ctx;
+    (void) path;
+    return UBUS_STATUS_OK;
+}
+
+int ubus_lookup_id(struct ubus_context *ctx, const char *path, uint32_t *id)
+{
+    (void) ctx;
+    std::lock_guard<std::mutex> guard(fakeubus::detail::mutex);
+    auto &objects = fakeubus::detail::objects;
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (objects[i] == path) {
+            *id = i + 1;
+            return UBUS_STATUS_OK;
+        }
+    }
+    objects.push_back(path);
+    *id = objects.size();
+    return UBUS_STATUS_OK;
+}
+
+int ubus_invoke_fd(struct ubus_context *ctx, uint32_t obj, const char *method, struct blob_attr *msg, ubus_data_handler_t cb,
+        void *priv, int timeout, int fd)
+{
+    (void) ctx;
+    (void) timeout;
+    (void) fd;
+
+    fakeubus::Call call;
+    fakeubus::handler_t handler;
+    {
+        std::lock_guard<std::mutex> guard(fakeubus::detail::mutex);
+        if (obj == 0 || obj > fakeubus::detail::objects.size()) {
+            return UBUS_STATUS_NOT_FOUND;
+        }
+        call.object = fakeubus::detail::objects[obj - 1];
+        call.method = method;
+        if (msg) {
+            call.msg.assign(reinterpret_cast<char *>(msg), reinterpret_cast<char *>(msg) + blob_pad_len(msg));
+        }
+        fakeubus::detail::calls.push_back(call);
+        handler = fakeubus::detail::handler;
+    }
+
+    struct blob_buf reply = {};
+    blob_buf_init(&reply, 0);
+
+    int rc = UBUS_STATUS_OK;
+    if (call.object == "session") {
+        rc = fakeubus::detail::answerSession(call, &reply);
+    } else if (handler) {
+        rc = handler(call, &reply);
+    }
+
+    if (rc == UBUS_STATUS_OK && cb && blob_len(reply.head) > 0) {
+        struct ubus_request req = {};
+        req.priv = priv;
+        cb(&req, UBUS_MSG_DATA, reply.head);
+    }
+    blob_buf_free(&reply);
+    return rc;
+}
+
+int ubus_register_event_handler(struct ubus_context *ctx, struct ubus_event_handler *ev, const char *pattern)
+{
+    (void) pattern;
+    std::lock_guard<std::mutex> guard(fakeubus::detail::mutex);
+    fakeubus::detail::eventCtx = ctx;
+    fakeubus::detail::eventHandler = ev;
+    return UBUS_STATUS_OK;
+}
+
+#endif // FAKEUBUS_H_10431830012024
@@ -0,0 +1,189 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Replays truncated, oversized and random management API events through `HciAdapter::processEvent()`
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Every packet is built in a buffer of exactly its own size, so any read past the end of a packet is caught when this test is
+// built with `-fsanitize=address`. Debug logging is enabled (into a sink) so each event's `debugText()` is exercised as well.
+//
+// Three sets of packets are replayed:
+//
+//     Truncated headers  - Every length shorter than a management header
+//     Every event code   - Each event code (and a few out of range) with every data size up to kMaxData, sent well formed, with a
+//                          header claiming more data than was received, and with trailing bytes past the size in the header
+//     Random packets     - Random bytes from a fixed seed, half of them given a plausible header
+//
+// For each packet, the result of `processEvent()` is checked against what the packet's layout says it should be. The adapter is
+// never started; events are only parsed and dispatched.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdint.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../HciAdapter.h"
+#include "../Logger.h"
+#include "../Mgmt.h"
+#include "../NtcDbus.h"
+
+using namespace ggk;
+
+static const size_t kMaxData = 64;
+static const int kRandomPackets = 100000;
+static const size_t kMaxRandomPacket = 300;
+
+static int failures = 0;
+static int replayed = 0;
+
+// Swallow everything that gets logged
+static void logSink(const char *) {}
+
+// Returns the number of data bytes (past the header) an event needs to be accepted
+static size_t minimumDataSize(uint16_t eventCode)
+{
+    switch(eventCode)
+    {
+        case Mgmt::ECommandCompleteEvent: return sizeof(HciAdapter::CommandCompleteEvent) - sizeof(HciAdapter::HciHeader);
+        case Mgmt::ECommandStatusEvent: return sizeof(HciAdapter::CommandStatusEvent) - sizeof(HciAdapter::HciHeader);
+        case Mgmt::EDeviceConnectedEvent: return sizeof(HciAdapter::DeviceConnectedEvent) - sizeof(HciAdapter::HciHeader);
+        case Mgmt::EDeviceDisconnectedEvent: return sizeof(HciAdapter::DeviceDisconnectedEvent) - sizeof(HciAdapter::HciHeader);
+        case Mgmt::EAuthenticationFailedEvent: return sizeof(HciAdapter::AuthenticationFailedEvent) - sizeof(HciAdapter::HciHeader);
+        default: return 0;
+    }
+}
+
+// Returns true if `processEvent()` should accept a packet of `packetSize` bytes whose header says `eventCode` and `dataSize`
+static bool expectAccepted(size_t packetSize, uint16_t eventCode, uint16_t dataSize)
+{
+    if (packetSize < sizeof(HciAdapter::HciHeader)) { return false; }
+    if (packetSize - sizeof(HciAdapter::HciHeader) < dataSize) { return false; }
+    if (eventCode < HciAdapter::kMinEventType || eventCode > HciAdapter::kMaxEventType) { return false; }
+    return dataSize >= minimumDataSize(eventCode);
+}
+
+// Builds a packet with the given header, followed by `payloadSize` bytes of `fill`
+static std::vector<uint8_t> buildPacket(uint16_t eventCode, uint16_t dataSize, size_t payloadSize, uint8_t fill)
+{
+    std::vector<uint8_t> packet(sizeof(HciAdapter::HciHeader) + payloadSize, fill);
+    HciAdapter::HciHeader header;
+    header.code = eventCode;
+    header.controllerId = 0;
+    header.dataSize = dataSize;
+    header.toNetwork();
+    memcpy(packet.data(), &header, sizeof(header));
+    return packet;
+}
+
+// Replays a packet and checks the result against the expected result
+static void replay(const std::vector<uint8_t> &packet, bool expected, const char *pDescription)
+{
+    // Copy into an exactly-sized allocation, so reading past the end of the packet is a heap overflow rather than a silent read
+    std::unique_ptr<uint8_t[]> pPacket(new uint8_t[packet.size() ? packet.size() : 1]);
+    if (!packet.empty()) { memcpy(pPacket.get(), packet.data(), packet.size()); }
+
+    bool accepted = HciAdapter::getInstance().processEvent(pPacket.get(), packet.size());
+    replayed += 1;
+
+    if (accepted != expected)
+    {
+        failures += 1;
+        fprintf(stderr, "FAIL: %s (%zu bytes): expected %s, got %s\n", pDescription, packet.size(),
+            expected ? "accepted" : "rejected", accepted ? "accepted" : "rejected");
+    }
+}
+
+int main()
+{
+    // Never reach out to D-Bus to depair anyone
+    fw::niceMode = true;
+
+    Logger::registerDebugReceiver(logSink);
+    Logger::registerInfoReceiver(logSink);
+    Logger::registerStatusReceiver(logSink);
+    Logger::registerWarnReceiver(logSink);
+    Logger::registerErrorReceiver(logSink);
+    Logger::registerFatalReceiver(logSink);
+    Logger::registerAlwaysReceiver(logSink);
+    Logger::registerTraceReceiver(logSink);
+
+    // Truncated headers
+    for (size_t size = 0; size < sizeof(HciAdapter::HciHeader); ++size)
+    {
+        replay(std::vector<uint8_t>(size, 0x01), false, "truncated header");
+    }
+
+    // Every event code, plus a few out of range
+    std::vector<uint16_t> eventCodes = { 0x0000, HciAdapter::kMaxEventType + 1, 0x7fff, 0xffff };
+    for (uint16_t code = HciAdapter::kMinEventType; code <= HciAdapter::kMaxEventType; ++code)
+    {
+        eventCodes.push_back(code);
+    }
+
+    for (uint16_t code : eventCodes)
+    {
+        for (size_t dataSize = 0; dataSize <= kMaxData; ++dataSize)
+        {
+            // Use both all-zero and all-ones payloads: the latter gives out-of-range command/status codes and maximal lengths
+            for (uint8_t fill : { 0x00, 0xff })
+            {
+                uint16_t size16 = static_cast<uint16_t>(dataSize);
+                replay(buildPacket(code, size16, dataSize, fill), expectAccepted(sizeof(HciAdapter::HciHeader) + dataSize, code, size16),
+                    "well formed");
+                replay(buildPacket(code, size16 + 1, dataSize, fill), false, "header claims more data than received");
+                replay(buildPacket(code, 0xffff, dataSize, fill), false, "header claims maximum data");
+                replay(buildPacket(code, size16, dataSize + 7, fill), expectAccepted(sizeof(HciAdapter::HciHeader) + dataSize, code, size16),
+                    "trailing bytes past data size");
+            }
+        }
+    }
+
+    // Random packets
+    std::mt19937 random(0x6767);
+    std::uniform_int_distribution<size_t> randomSize(0, kMaxRandomPacket);
+    std::uniform_int_distribution<int> randomByte(0, 255);
+    std::uniform_int_distribution<int> randomEvent(HciAdapter::kMinEventType, HciAdapter::kMaxEventType);
+
+    for (int i = 0; i < kRandomPackets; ++i)
+    {
+        std::vector<uint8_t> packet(randomSize(random));
+        for (uint8_t &byte : packet) { byte = static_cast<uint8_t>(randomByte(random)); }
+
+        // Give half of them a plausible header, so they get past the framing checks and into the event parsers
+        if ((i & 1) && packet.size() >= sizeof(HciAdapter::HciHeader))
+        {
+            size_t dataSize = packet.size() - sizeof(HciAdapter::HciHeader);
+            packet = buildPacket(static_cast<uint16_t>(randomEvent(random)), static_cast<uint16_t>(dataSize), dataSize, 0);
+            for (size_t b = sizeof(HciAdapter::HciHeader); b < packet.size(); ++b) { packet[b] = static_cast<uint8_t>(randomByte(random)); }
+        }
+
+        bool expected = false;
+        if (packet.size() >= sizeof(HciAdapter::HciHeader))
+        {
+            HciAdapter::HciHeader header;
+            memcpy(&header, packet.data(), sizeof(header));
+            header.toHost();
+            expected = expectAccepted(packet.size(), header.code, header.dataSize);
+        }
+
+        replay(packet, expected, "random");
+    }
+
+    printf("%d packets replayed, %d failures\n", replayed, failures);
+    return failures == 0 ? 0 : 1;
+}
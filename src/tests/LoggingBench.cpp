@@ -0,0 +1,136 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Times method dispatch with logging disabled and enabled, and a log statement built before and after the level check
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Every method call logs "Calling method: [path]:[interface]:[method]" (see `DBusMethod::call()`.) Messages used to be built with
+// `SSTR` before the logger found that no receiver was registered for their level, so a server with logging turned off still paid
+// for building them. The GGK_* macros (see Logger.h) check the level first.
+//
+// This benchmark times:
+//
+//     Dispatch      - `Server::callMethod()` of every characteristic's `Ping` method (see SyntheticTree.h), with no receiver
+//                     registered and then with one registered for the info level (which swallows the message)
+//     Log statement - That same message logged with no receiver registered, built first (`Logger::info(SSTR << ...)`, as it
+//                     used to be) and with `GGK_INFO()`
+//
+// Usage: LoggingBench [rounds]
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "../DBusObjectPath.h"
+#include "../Logger.h"
+#include "../Server.h"
+#include "SyntheticTree.h"
+
+using namespace ggk;
+
+static const int kDefaultRounds = 200;
+
+static const std::string kInterfaceName = "org.bluez.GattCharacteristic1";
+static const std::string kMethodName = "Ping";
+
+// Swallow everything that gets logged, counting the messages
+static unsigned long messagesLogged = 0;
+static void logSink(const char *) { messagesLogged += 1; }
+
+// The services of this benchmark's server, in place of plugins/mainServicePlugin.cpp
+void Server::registerServicePlugins()
+{
+    describeSyntheticTree(objects.back(), kSyntheticServices, kSyntheticCharacteristicsPerService);
+}
+
+// Runs `operation` on every path, `rounds` times, and returns the average time of each, in nanoseconds
+static double timeOperation(const std::vector<DBusObjectPath> &paths, int rounds, std::function<void(const DBusObjectPath &)> operation)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (const DBusObjectPath &path : paths)
+        {
+            operation(path);
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(rounds) * paths.size());
+}
+
+static void dispatch(const DBusObjectPath &path)
+{
+    TheServer->callMethod(path, kInterfaceName, kMethodName, nullptr, nullptr, nullptr, nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : kDefaultRounds;
+    if (rounds < 1)
+    {
+        printf("Usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    TheServer = std::make_shared<Server>("test", "Test", "Test", nullptr, nullptr);
+
+    std::vector<DBusObjectPath> paths;
+    for (int s = 0; s < kSyntheticServices; ++s)
+    {
+        for (int c = 0; c < kSyntheticCharacteristicsPerService; ++c)
+        {
+            paths.push_back(DBusObjectPath(syntheticCharacteristicPath(s, c)));
+        }
+    }
+
+    // Dispatch, with logging off and then on
+    double dispatchOffNS = timeOperation(paths, rounds, dispatch);
+    unsigned long loggedOff = messagesLogged;
+
+    Logger::registerInfoReceiver(logSink);
+    double dispatchOnNS = timeOperation(paths, rounds, dispatch);
+    unsigned long loggedOn = messagesLogged - loggedOff;
+    Logger::registerInfoReceiver(nullptr);
+
+    // The log statement alone, with logging off
+    double eagerNS = timeOperation(paths, rounds, [](const DBusObjectPath &path)
+    {
+        Logger::info(SSTR << "Calling method: [" << path << "]:[" << kInterfaceName << "]:[" << kMethodName << "]");
+    });
+    double checkedNS = timeOperation(paths, rounds, [](const DBusObjectPath &path)
+    {
+        GGK_INFO("Calling method: [" << path << "]:[" << kInterfaceName << "]:[" << kMethodName << "]");
+    });
+
+    TheServer = nullptr;
+
+    unsigned long expectedCalls = static_cast<unsigned long>(rounds) * paths.size();
+    if (syntheticPings != 2 * expectedCalls || loggedOff != 0 || loggedOn != expectedCalls || messagesLogged != expectedCalls)
+    {
+        printf("A call failed, or a message was logged at the wrong time\n");
+        return 1;
+    }
+
+    printf("%zu characteristics, %d rounds\n", paths.size(), rounds);
+    printf("  dispatch, logging off:          %8.1f ns per call\n", dispatchOffNS);
+    printf("  dispatch, info logged:          %8.1f ns per call\n", dispatchOnNS);
+    printf("  log statement off, SSTR first:  %8.1f ns\n", eagerNS);
+    printf("  log statement off, GGK_INFO:    %8.1f ns\n", checkedNS);
+    return 0;
+}
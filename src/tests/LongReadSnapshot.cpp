@@ -0,0 +1,172 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Reads a characteristic's value in pieces and checks when the framework keeps and releases its snapshot of the value
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// A read at offset 0 of a value too long for one ATT response keeps the whole reply as a snapshot, and later offsets are cut
+// from it (see `GattCharacteristic::onMethodReturn()`). The test changes the value between reads, so a read served from a
+// snapshot still sees the old value, and counts the calls of the onReadValue callback.
+//
+// The characteristic is read over a private D-Bus connection (see TestBus.h), with the ReadValue options BlueZ would send. It
+// checks that without the MTU:
+//
+//     Short values     - A value that fits the default ATT MTU's payload (22 bytes) isn't kept
+//     Long values      - A longer value is kept, and released once a read reaches its last piece
+//
+// and that a peer's disconnect releases its own snapshots, but not those taken when BlueZ didn't name the peer; those are
+// replaced by the next read at offset 0.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <string>
+
+#include "../GattCharacteristic.h"
+#include "../GattService.h"
+#include "../Logger.h"
+#include "../Server.h"
+#include "TestBus.h"
+
+using namespace ggk;
+
+static const char *kLongPath = "/com/test/service/long";
+
+// The peer that reads with its device name, and its address as the HCI events carry it (least significant byte first)
+static const char *kDevicePath = "/org/bluez/hci0/dev_11_22_33_44_55_66";
+static const uint8_t kDeviceAddress[6] = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x11 };
+static const uint8_t kOtherAddress[6] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+
+// Values of 40 bytes (longer than the default ATT payload) and 12 bytes (shorter)
+static const std::string kLongFirst = "first value, forty bytes long, in total.";
+static const std::string kLongSecond = "other value, forty bytes long, in total.";
+static const std::string kShortFirst = "first short.";
+static const std::string kShortSecond = "other short.";
+
+static int failures = 0;
+
+// The characteristic's current value, and the number of times its onReadValue callback ran
+static std::string currentValue;
+static int readsServed = 0;
+
+// Swallow everything that gets logged
+static void logSink(const char *) {}
+
+static void check(bool condition, const char *pDescription)
+{
+    if (!condition)
+    {
+        failures += 1;
+        fprintf(stderr, "FAIL: %s\n", pDescription);
+    }
+}
+
+// The services of this test's server, in place of plugins/mainServicePlugin.cpp
+void Server::registerServicePlugins()
+{
+    objects.back().gattServiceBegin("service", "00000001-1E3C-FAD4-74E2-97A033F1BFAA")
+        .gattCharacteristicBegin("long", "00000002-1E3C-FAD4-74E2-97A033F1BFAA", {"read"})
+            .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+            {
+                readsServed += 1;
+                self.methodReturnValue(pInvocation, currentValue, true);
+            }, false)
+        .gattCharacteristicEnd()
+    .gattServiceEnd();
+}
+
+// Reads the characteristic at `offset`, naming the peer if `pDevicePath` is given, and returns the value read
+static std::string readAt(TestBus &bus, guint16 offset, const char *pDevicePath)
+{
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
+    g_variant_builder_add(&builder, "{sv}", "offset", g_variant_new_uint16(offset));
+    if (nullptr != pDevicePath)
+    {
+        g_variant_builder_add(&builder, "{sv}", "device", g_variant_new_object_path(pDevicePath));
+    }
+
+    return bus.call(kLongPath, "org.bluez.GattCharacteristic1", "ReadValue", g_variant_new("(a{sv})", &builder))->valueString();
+}
+
+static void testWithoutMtu(TestBus &bus)
+{
+    // A value that fits one response isn't kept, so a read at a later offset builds the value again
+    currentValue = kShortFirst;
+    readsServed = 0;
+    check(readAt(bus, 0, kDevicePath) == kShortFirst, "short value read whole");
+    currentValue = kShortSecond;
+    check(readAt(bus, 6, kDevicePath) == kShortSecond.substr(6) && readsServed == 2, "short value not kept");
+
+    // A longer value is kept until a read reaches its last piece
+    currentValue = kLongFirst;
+    readsServed = 0;
+    check(readAt(bus, 0, kDevicePath) == kLongFirst, "long value read whole");
+    currentValue = kLongSecond;
+    check(readAt(bus, 10, kDevicePath) == kLongFirst.substr(10) && readsServed == 1, "long value continued from the snapshot");
+    check(readAt(bus, 22, kDevicePath) == kLongFirst.substr(22) && readsServed == 1, "last piece read from the snapshot");
+    check(readAt(bus, 30, kDevicePath) == kLongSecond.substr(30) && readsServed == 2, "snapshot released after the last piece");
+}
+
+static void testDisconnect(TestBus &bus)
+{
+    // A peer's disconnect releases its own snapshots only
+    currentValue = kLongFirst;
+    readsServed = 0;
+    readAt(bus, 0, kDevicePath);
+    currentValue = kLongSecond;
+    GattCharacteristic::releaseLongReadSnapshots(kOtherAddress);
+    check(readAt(bus, 10, kDevicePath) == kLongFirst.substr(10) && readsServed == 1, "snapshot kept when another peer disconnects");
+    GattCharacteristic::releaseLongReadSnapshots(kDeviceAddress);
+    check(readAt(bus, 10, kDevicePath) == kLongSecond.substr(10) && readsServed == 2, "snapshot released when its peer disconnects");
+
+    // A snapshot taken without the peer's name outlives any disconnect, until the next read at offset 0 replaces it
+    currentValue = kLongFirst;
+    readsServed = 0;
+    readAt(bus, 0, nullptr);
+    currentValue = kLongSecond;
+    GattCharacteristic::releaseLongReadSnapshots(kDeviceAddress);
+    check(readAt(bus, 10, nullptr) == kLongFirst.substr(10) && readsServed == 1, "unnamed snapshot kept when a peer disconnects");
+    check(readAt(bus, 0, nullptr) == kLongSecond && readsServed == 2, "read at offset 0 builds the value again");
+    currentValue = kLongFirst;
+    check(readAt(bus, 10, nullptr) == kLongSecond.substr(10) && readsServed == 2, "unnamed snapshot replaced by the new read");
+
+    // A short value read at offset 0 releases it
+    currentValue = kShortFirst;
+    readAt(bus, 0, nullptr);
+    currentValue = kLongSecond;
+    check(readAt(bus, 10, nullptr) == kLongSecond.substr(10) && readsServed == 4, "unnamed snapshot released by a short read");
+}
+
+int main()
+{
+    Logger::registerDebugReceiver(logSink);
+    Logger::registerWarnReceiver(logSink);
+
+    TheServer = std::make_shared<Server>("test", "Test", "Test", nullptr, nullptr);
+    {
+        TestBus bus;
+        check(bus.isConnected(), "test bus connected");
+        if (bus.isConnected())
+        {
+            testWithoutMtu(bus);
+            testDisconnect(bus);
+        }
+    }
+    TheServer = nullptr;
+
+    printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
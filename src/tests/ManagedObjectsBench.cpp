@@ -0,0 +1,129 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Times GetManagedObjects calls on a large server description, with the reply rebuilt for every call and with the cached reply
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// BlueZ calls GetManagedObjects whenever it registers our application. `ServerUtils::getManagedObjects()` builds its reply once
+// and answers later calls with the same GVariant, until `ServerUtils::invalidateManagedObjects()` is called (when a property value
+// changes). Invalidating the reply before every call therefore times the reply being rebuilt every time, as it used to be.
+//
+// The calls are real method calls over a private D-Bus connection (see TestBus.h), so each time includes sending the reply and
+// the client receiving it, as BlueZ would. The tree is that of SyntheticTree.h.
+//
+// Usage: ManagedObjectsBench [services] [characteristics per service] [calls]
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "../Server.h"
+#include "../ServerUtils.h"
+#include "SyntheticTree.h"
+#include "TestBus.h"
+
+using namespace ggk;
+
+static const int kDefaultCalls = 50;
+
+static int services = kSyntheticServices;
+static int characteristicsPerService = kSyntheticCharacteristicsPerService;
+
+// The services of this benchmark's server, in place of plugins/mainServicePlugin.cpp
+void Server::registerServicePlugins()
+{
+    describeSyntheticTree(objects.back(), services, characteristicsPerService);
+}
+
+// Calls GetManagedObjects `calls` times and returns the average time of each, in microseconds (or -1 if any call failed)
+//
+// The number of objects in the last reply is returned in `objectCount`
+static double timeCalls(TestBus &bus, int calls, bool rebuild, gsize &objectCount)
+{
+    objectCount = 0;
+    std::chrono::steady_clock::duration elapsed(0);
+    for (int i = 0; i < calls; ++i)
+    {
+        // Don't time the invalidation itself, only the call that rebuilds the reply
+        if (rebuild)
+        {
+            ServerUtils::invalidateManagedObjects();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<TestBus::Reply> reply = bus.call("/", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects", nullptr);
+        elapsed += std::chrono::steady_clock::now() - start;
+
+        if (nullptr == reply->pValue)
+        {
+            return -1;
+        }
+
+        GVariant *pObjects = g_variant_get_child_value(reply->pValue, 0);
+        objectCount = g_variant_n_children(pObjects);
+        g_variant_unref(pObjects);
+    }
+
+    return std::chrono::duration<double, std::micro>(elapsed).count() / calls;
+}
+
+int main(int argc, char **argv)
+{
+    services = argc > 1 ? atoi(argv[1]) : kSyntheticServices;
+    characteristicsPerService = argc > 2 ? atoi(argv[2]) : kSyntheticCharacteristicsPerService;
+    int calls = argc > 3 ? atoi(argv[3]) : kDefaultCalls;
+
+    if (services < 1 || characteristicsPerService < 1 || calls < 1)
+    {
+        printf("Usage: %s [services] [characteristics per service] [calls]\n", argv[0]);
+        return 1;
+    }
+
+    TheServer = std::make_shared<Server>("test", "Test", "Test", nullptr, nullptr);
+
+    double rebuiltUS = -1;
+    double cachedUS = -1;
+    gsize rebuiltObjects = 0;
+    gsize cachedObjects = 0;
+    {
+        TestBus bus;
+        if (bus.isConnected())
+        {
+            // Warm up (this also builds the reply the cached calls use)
+            timeCalls(bus, 1, true, cachedObjects);
+
+            rebuiltUS = timeCalls(bus, calls, true, rebuiltObjects);
+            cachedUS = timeCalls(bus, calls, false, cachedObjects);
+        }
+    }
+
+    TheServer = nullptr;
+
+    // Each service, characteristic and descriptor is an object
+    gsize expectedObjects = static_cast<gsize>(services) * (1 + 2 * characteristicsPerService);
+    if (rebuiltUS < 0 || cachedUS < 0 || rebuiltObjects != expectedObjects || cachedObjects != expectedObjects)
+    {
+        printf("A GetManagedObjects call failed or returned the wrong objects\n");
+        return 1;
+    }
+
+    printf("%zu objects (%d services of %d characteristics, each with a descriptor), %d calls\n", static_cast<size_t>(expectedObjects),
+        services, characteristicsPerService, calls);
+    printf("  rebuilt: %10.1f us per call\n", rebuiltUS);
+    printf("  cached:  %10.1f us per call\n", cachedUS);
+    return 0;
+}
@@ -0,0 +1,264 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Times the management commands of a full adapter configuration, sent one at a time and as a batch, against a simulated adapter
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// `configureAdapter()` (see Init.cpp) powers the adapter off, sends up to eight settings and powers it back on. The settings may be
+// sent one at a time (waiting for each response) or as one batch (see `Mgmt::beginBatch()`.) This benchmark sends the same
+// commands both ways through the real `Mgmt` and `HciAdapter` code and reports the time each takes.
+//
+// There is no adapter here, so this file defines its own `HciSocket` in place of HciSocket.cpp: every command written is answered
+// with a successful Command Complete event, which becomes readable `latency` microseconds after the command was written. The
+// responses to pipelined commands are in flight at the same time, as they are when the kernel answers settings changes for a
+// powered-off adapter. With a latency of zero, what remains is our own cost per command: the write, the event thread's wakeup and
+// the hand-off of the response to the waiting thread.
+//
+// Usage: MgmtBatchBench [latency in microseconds] [configurations]
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "../HciAdapter.h"
+#include "../HciSocket.h"
+#include "../Logger.h"
+#include "../Mgmt.h"
+
+using namespace ggk;
+
+static const int kDefaultLatencyUS = 0;
+static const int kDefaultConfigurations = 200;
+
+// The simulated adapter: responses waiting to be read, each with the time it becomes readable
+struct SimulatedResponse
+{
+    std::chrono::steady_clock::time_point due;
+    std::vector<uint8_t> packet;
+};
+
+static std::mutex adapterMutex;
+static std::condition_variable adapterChanged;
+static std::deque<SimulatedResponse> responses;
+static bool connected = false;
+static bool interrupted = false;
+static std::chrono::microseconds latency(kDefaultLatencyUS);
+
+// Swallow everything that gets logged
+static void logSink(const char *) {}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// A simulated HciSocket, replacing HciSocket.cpp
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+namespace ggk {
+
+HciSocket::HciSocket() : fdSocket(-1), fdEpoll(-1), fdShutdown(-1) {}
+HciSocket::~HciSocket() {}
+
+bool HciSocket::connect()
+{
+    std::lock_guard<std::mutex> lock(adapterMutex);
+    connected = true;
+    interrupted = false;
+    return true;
+}
+
+bool HciSocket::isConnected() const
+{
+    std::lock_guard<std::mutex> lock(adapterMutex);
+    return connected;
+}
+
+void HciSocket::disconnect()
+{
+    std::lock_guard<std::mutex> lock(adapterMutex);
+    connected = false;
+    responses.clear();
+}
+
+void HciSocket::interrupt() const
+{
+    {
+        std::lock_guard<std::mutex> lock(adapterMutex);
+        interrupted = true;
+    }
+    adapterChanged.notify_all();
+}
+
+bool HciSocket::read(uint8_t *pBuffer, size_t bufferSize, size_t &bytesRead) const
+{
+    std::unique_lock<std::mutex> lock(adapterMutex);
+    for (;;)
+    {
+        if (interrupted || !connected)
+        {
+            return false;
+        }
+
+        if (responses.empty())
+        {
+            adapterChanged.wait(lock);
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() < responses.front().due)
+        {
+            adapterChanged.wait_until(lock, responses.front().due);
+            continue;
+        }
+
+        const std::vector<uint8_t> &packet = responses.front().packet;
+        bytesRead = packet.size() < bufferSize ? packet.size() : bufferSize;
+        memcpy(pBuffer, packet.data(), bytesRead);
+        responses.pop_front();
+        return true;
+    }
+}
+
+// Answers a command with a successful Command Complete event, carrying zeroed return parameters of the size the command expects
+bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
+{
+    HciAdapter::HciHeader request;
+    if (count < sizeof(request))
+    {
+        return false;
+    }
+    memcpy(&request, pBuffer, sizeof(request));
+    request.toHost();
+
+    size_t dataSize = 0;
+    switch(request.code)
+    {
+        case Mgmt::EReadVersionInformationCommand: dataSize = sizeof(HciAdapter::VersionInformation); break;
+        case Mgmt::EReadControllerInformationCommand: dataSize = sizeof(HciAdapter::ControllerInformation); break;
+        case Mgmt::ESetLocalNameCommand: dataSize = sizeof(HciAdapter::LocalName); break;
+        default: dataSize = sizeof(HciAdapter::AdapterSettings); break;
+    }
+
+    HciAdapter::CommandCompleteEvent event;
+    event.header.code = Mgmt::ECommandCompleteEvent;
+    event.header.controllerId = request.controllerId;
+    event.header.dataSize = static_cast<uint16_t>(sizeof(event) - sizeof(event.header) + dataSize);
+    event.commandCode = request.code;
+    event.status = 0;
+    event.toNetwork();
+
+    SimulatedResponse response;
+    response.due = std::chrono::steady_clock::now() + latency;
+    response.packet.assign(reinterpret_cast<const uint8_t *>(&event), reinterpret_cast<const uint8_t *>(&event) + sizeof(event));
+    response.packet.resize(response.packet.size() + dataSize, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(adapterMutex);
+        responses.push_back(std::move(response));
+    }
+    adapterChanged.notify_all();
+    return true;
+}
+
+bool HciSocket::write(std::vector<uint8_t> buffer) const
+{
+    return write(buffer.data(), buffer.size());
+}
+
+}; // namespace ggk
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Sends every setting `configureAdapter()` may change, between powering off and powering on
+//
+// Returns true if every command was answered
+static bool configure(bool batched)
+{
+    Mgmt mgmt;
+    bool success = mgmt.setPowered(false);
+
+    if (batched)
+    {
+        mgmt.beginBatch();
+    }
+
+    success = mgmt.setLE(true) && success;
+    success = mgmt.setBredr(false) && success;
+    success = mgmt.setSecureConnections(1) && success;
+    success = mgmt.setBondable(true) && success;
+    success = mgmt.setConnectable(true) && success;
+    success = mgmt.setDiscoverable(1, 0) && success;
+    success = mgmt.setAdvertising(1) && success;
+    success = mgmt.setName("Benchmark", "Bench") && success;
+
+    if (batched)
+    {
+        success = mgmt.endBatch() && success;
+    }
+
+    return mgmt.setPowered(true) && success;
+}
+
+// Runs `configurations` configurations and returns the average time of each, in microseconds (or -1 if any command failed)
+static double timeConfigurations(bool batched, int configurations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < configurations; ++i)
+    {
+        if (!configure(batched))
+        {
+            return -1;
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / configurations;
+}
+
+int main(int argc, char **argv)
+{
+    int latencyUS = argc > 1 ? atoi(argv[1]) : kDefaultLatencyUS;
+    int configurations = argc > 2 ? atoi(argv[2]) : kDefaultConfigurations;
+    latency = std::chrono::microseconds(latencyUS);
+
+    Logger::registerDebugReceiver(logSink);
+    Logger::registerInfoReceiver(logSink);
+    Logger::registerWarnReceiver(logSink);
+    Logger::registerErrorReceiver(logSink);
+
+    // Warm up (this also starts the event thread)
+    timeConfigurations(true, 1);
+
+    double sequentialUS = timeConfigurations(false, configurations);
+    double batchedUS = timeConfigurations(true, configurations);
+
+    HciAdapter::getInstance().stop();
+
+    if (sequentialUS < 0 || batchedUS < 0)
+    {
+        printf("A command went unanswered\n");
+        return 1;
+    }
+
+    printf("%d configurations of 12 commands each, response latency %d us\n", configurations, latencyUS);
+    printf("  sequential: %10.1f us per configuration\n", sequentialUS);
+    printf("  batched:    %10.1f us per configuration\n", batchedUS);
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Pushes updates for a characteristic that caches its ReadValue reply, then reads it before the update is processed
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// A characteristic set up with `cacheFor()` answers ReadValue from its cached reply until the cache expires or the value is
+// updated. An update must drop the cache as soon as it is pushed, not when the server gets round to processing it, or a read
+// in between is answered with the old value.
+//
+// The characteristic is read over a private D-Bus connection (see TestBus.h). No main loop processes the update queue here, so
+// every read after a push happens while the update is still waiting in the queue. Updates are pushed both ways:
+//
+//     C API      - `ggkNofifyUpdatedCharacteristic()` with the characteristic's object path
+//     Fast path  - `pushUpdateQueue()` with the characteristic itself
+//
+// The test also checks that both kinds of push wait in the queue as one entry, and that an update for a path that isn't a
+// characteristic is still queued.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "../../include/Gobbledegook.h"
+#include "../DBusObject.h"
+#include "../GattCharacteristic.h"
+#include "../GattService.h"
+#include "../Init.h"
+#include "../Logger.h"
+#include "../Server.h"
+#include "TestBus.h"
+
+using namespace ggk;
+
+static const char *kCachedPath = "/com/test/service/cached";
+
+static int failures = 0;
+
+// The characteristic's current value, and the number of times its onReadValue callback ran
+static std::string currentValue = "first";
+static int readsServed = 0;
+
+// Swallow everything that gets logged
+static void logSink(const char *) {}
+
+static void check(bool condition, const char *pDescription)
+{
+    if (!condition)
+    {
+        failures += 1;
+        fprintf(stderr, "FAIL: %s\n", pDescription);
+    }
+}
+
+// The services of this test's server, in place of plugins/mainServicePlugin.cpp
+void Server::registerServicePlugins()
+{
+    objects.back().gattServiceBegin("service", "00000001-1E3C-FAD4-74E2-97A033F1BFAA")
+        .gattCharacteristicBegin("cached", "00000002-1E3C-FAD4-74E2-97A033F1BFAA", {"read"})
+            .cacheFor(60 * 60 * 1000)
+            .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+            {
+                readsServed += 1;
+                self.methodReturnValue(pInvocation, currentValue, true);
+            }, false)
+        .gattCharacteristicEnd()
+    .gattServiceEnd();
+}
+
+void Server::stopServicePlugins()
+{
+}
+
+// Returns the characteristic under test
+static const GattCharacteristic &cachedCharacteristic()
+{
+    std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(DBusObjectPath(kCachedPath),
+        "org.bluez.GattCharacteristic1");
+    return *TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+}
+
+static void testPushThenRead(TestBus &bus)
+{
+    check(bus.readValue(kCachedPath)->valueString() == "first", "first read served");
+    check(bus.readValue(kCachedPath)->valueString() == "first" && readsServed == 1, "second read served from the cache");
+
+    // C API
+    currentValue = "second";
+    check(ggkNofifyUpdatedCharacteristic(kCachedPath) != 0, "update pushed by path");
+    check(bus.readValue(kCachedPath)->valueString() == "second" && readsServed == 2, "read after a push by path sees the update");
+    check(bus.readValue(kCachedPath)->valueString() == "second" && readsServed == 2, "the new value is cached again");
+
+    // The update is still waiting, as the characteristic itself, so a push through the fast path is coalesced with it
+    unsigned long coalesced = ggkUpdateQueueCoalescedCount();
+    currentValue = "third";
+    check(pushUpdateQueue(cachedCharacteristic()) != 0, "update pushed by characteristic");
+    check(ggkUpdateQueueCoalescedCount() == coalesced + 1 && ggkUpdateQueueSize() == 1, "pushes coalesced into one entry");
+    check(bus.readValue(kCachedPath)->valueString() == "third" && readsServed == 3, "read after a fast path push sees the update");
+
+    char element[256];
+    check(ggkPopUpdateQueue(element, sizeof(element), 0) == 1, "update popped");
+    check(strcmp(element, "/com/test/service/cached|org.bluez.GattCharacteristic1") == 0, "popped update names the characteristic");
+
+    // Anything else is queued by path, to be resolved when it is processed
+    check(ggkPushUpdateQueue("/com/test/service/missing", "org.bluez.GattCharacteristic1") != 0, "unknown path pushed");
+    check(ggkPopUpdateQueue(element, sizeof(element), 0) == 1, "unknown path popped");
+    check(strcmp(element, "/com/test/service/missing|org.bluez.GattCharacteristic1") == 0, "popped update names the path");
+    check(ggkUpdateQueueIsEmpty() == 1, "queue empty");
+}
+
+int main()
+{
+    Logger::registerDebugReceiver(logSink);
+    Logger::registerWarnReceiver(logSink);
+
+    TheServer = std::make_shared<Server>("test", "Test", "Test", nullptr, nullptr);
+    {
+        TestBus bus;
+        check(bus.isConnected(), "test bus connected");
+        if (bus.isConnected())
+        {
+            testPushThenRead(bus);
+        }
+    }
+    TheServer = nullptr;
+
+    printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
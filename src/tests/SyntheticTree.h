@@ -0,0 +1,93 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A large server description for benchmarks: many services, each with many characteristics
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// A benchmark describes its server by calling `describeSyntheticTree()` from its own `Server::registerServicePlugins()` (see
+// TestBus.h), then creates `TheServer`. Every characteristic looks like those of our plugins: readable and notifying, with a user
+// description descriptor. Each also has a `Ping` method that takes no arguments and does nothing but count its calls, so
+// benchmarks can time method dispatch without answering a method call.
+//
+// Objects are laid out as `/com/test/service<S>/characteristic<C>` (see `syntheticCharacteristicPath()`), so with the default
+// size there are 500 characteristics and 500 descriptors under 50 services.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdio.h>
+#include <string>
+
+#include "../DBusObject.h"
+#include "../GattCharacteristic.h"
+#include "../GattDescriptor.h"
+#include "../GattService.h"
+
+namespace ggk {
+
+static const int kSyntheticServices = 50;
+static const int kSyntheticCharacteristicsPerService = 10;
+
+// The number of times any characteristic's `Ping` method has been called
+static unsigned long syntheticPings = 0;
+
+// Returns the object path of a characteristic of the synthetic tree
+static inline std::string syntheticCharacteristicPath(int service, int characteristic)
+{
+    return "/com/test/service" + std::to_string(service) + "/characteristic" + std::to_string(characteristic);
+}
+
+// Returns a 128-bit UUID that is unique to a service and characteristic
+static inline std::string syntheticUuid(int service, int characteristic)
+{
+    char uuid[37];
+    snprintf(uuid, sizeof(uuid), "%08X-1E3C-FAD4-74E2-97A033F1BFAA", (service << 16) | characteristic);
+    return uuid;
+}
+
+// Describes `services` services of `characteristicsPerService` characteristics each within `root`
+static inline void describeSyntheticTree(DBusObject &root, int services, int characteristicsPerService)
+{
+    static const char *pNoArgs[] = { nullptr };
+
+    for (int s = 0; s < services; ++s)
+    {
+        GattService &service = root.gattServiceBegin("service" + std::to_string(s), syntheticUuid(s, 0xffff));
+        for (int c = 0; c < characteristicsPerService; ++c)
+        {
+            service.gattCharacteristicBegin("characteristic" + std::to_string(c), syntheticUuid(s, c), {"read", "notify"})
+                .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+                {
+                    self.methodReturnValue(pInvocation, "value", true);
+                }, false)
+                .addMethod("Ping", pNoArgs, "", [](const DBusInterface &, GDBusConnection *, const std::string &, GVariant *,
+                    GDBusMethodInvocation *, void *)
+                {
+                    syntheticPings += 1;
+                }, false)
+                .gattDescriptorBegin("description", "2901", {"read"})
+                    .onReadValue(DESCRIPTOR_METHOD_CALLBACK_LAMBDA
+                    {
+                        self.methodReturnValue(pInvocation, "Synthetic characteristic", true);
+                    })
+                .gattDescriptorEnd()
+            .gattCharacteristicEnd();
+        }
+        service.gattServiceEnd();
+    }
+}
+
+}; // namespace ggk
@@ -0,0 +1,287 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A private D-Bus connection for tests, with a server description on one end and a client on the other
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Tests that need real method calls (with real `GDBusMethodInvocation`s that must be answered) can't use the system bus, so
+// this connects two `GDBusConnection`s back to back over a socketpair, the same way a D-Bus peer-to-peer connection is made.
+// The objects of `TheServer` are registered on the server end the way `registerObjects()` does in Init.cpp, with method calls
+// routed through `Server::callMethod()`. The client end then calls those methods by object path; no bus name is needed on a
+// peer-to-peer connection.
+//
+// A test describes its own services by defining `Server::registerServicePlugins()` (normally in plugins/mainServicePlugin.cpp),
+// and creates `TheServer` before connecting a TestBus. A test that links the server's run loop (Init.cpp) defines
+// `Server::stopServicePlugins()` as well.
+//
+// Everything runs on the default main context, which the test iterates (through `waitFor()`) while it waits for replies.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <gio/gio.h>
+
+#include "../DBusObject.h"
+#include "../DBusObjectPath.h"
+#include "../Server.h"
+#include "../Utils.h"
+
+namespace ggk {
+
+class TestBus
+{
+public:
+
+    // The reply to a method call started with `callAsync()`
+    struct Reply
+    {
+        bool done = false;
+        GVariant *pValue = nullptr;     // The reply, if the call succeeded
+        std::string error;              // The D-Bus error name, if it failed
+
+        ~Reply() { if (nullptr != pValue) { g_variant_unref(pValue); } }
+
+        // Returns a ReadValue reply's "(ay)" value as a string, or an empty string if the call failed
+        std::string valueString() const
+        {
+            if (nullptr == pValue)
+            {
+                return "";
+            }
+
+            GVariant *pArray = g_variant_get_child_value(pValue, 0);
+            std::string value = Utils::stringFromGVariantByteArray(pArray);
+            g_variant_unref(pArray);
+            return value;
+        }
+    };
+
+    // Connects the two ends and registers the objects of `TheServer` on the server end
+    TestBus()
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        {
+            return;
+        }
+
+        // Both ends authenticate with each other, so both must be started before waiting for either
+        gchar *pGuid = g_dbus_generate_guid();
+        GIOStream *pServerStream = newStream(fds[0]);
+        GIOStream *pClientStream = newStream(fds[1]);
+        g_dbus_connection_new(pServerStream, pGuid, static_cast<GDBusConnectionFlags>(
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER | G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_ALLOW_ANONYMOUS), nullptr, nullptr,
+            onConnected, &pServer);
+        g_dbus_connection_new(pClientStream, nullptr, G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, nullptr, nullptr,
+            onConnected, &pClient);
+        g_object_unref(pServerStream);
+        g_object_unref(pClientStream);
+        g_free(pGuid);
+
+        waitFor([this] { return nullptr != pServer && nullptr != pClient; });
+        if (isConnected())
+        {
+            registerObjects();
+        }
+    }
+
+    ~TestBus()
+    {
+        for (guint id : registeredObjectIds)
+        {
+            g_dbus_connection_unregister_object(pServer, id);
+        }
+
+        for (GDBusConnection *pConnection : { pClient, pServer })
+        {
+            if (nullptr != pConnection)
+            {
+                g_dbus_connection_close_sync(pConnection, nullptr, nullptr);
+                g_object_unref(pConnection);
+            }
+        }
+    }
+
+    TestBus(TestBus const&) = delete;
+    void operator=(TestBus const&) = delete;
+
+    // Returns true if both ends connected and the hierarchy was registered
+    bool isConnected() const { return nullptr != pServer && nullptr != pClient && !registrationFailed; }
+
+    // The server end, as handed to method handlers
+    GDBusConnection *getServerConnection() const { return pServer; }
+
+    // Starts a method call from the client end; the reply is filled in while the main context is iterated
+    std::shared_ptr<Reply> callAsync(const std::string &path, const std::string &interfaceName, const std::string &methodName,
+        GVariant *pParameters)
+    {
+        std::shared_ptr<Reply> *pReply = new std::shared_ptr<Reply>(std::make_shared<Reply>());
+        std::shared_ptr<Reply> reply = *pReply;
+
+        g_dbus_connection_call(pClient, nullptr, path.c_str(), interfaceName.c_str(), methodName.c_str(), pParameters, nullptr,
+            G_DBUS_CALL_FLAGS_NONE, -1, nullptr, onReply, pReply);
+
+        return reply;
+    }
+
+    // Calls a method from the client end and waits for the reply
+    std::shared_ptr<Reply> call(const std::string &path, const std::string &interfaceName, const std::string &methodName,
+        GVariant *pParameters)
+    {
+        std::shared_ptr<Reply> reply = callAsync(path, interfaceName, methodName, pParameters);
+        waitFor([&reply] { return reply->done; });
+        return reply;
+    }
+
+    // Calls ReadValue on a characteristic with an empty options dictionary and waits for the reply
+    std::shared_ptr<Reply> readValue(const std::string &path)
+    {
+        return call(path, "org.bluez.GattCharacteristic1", "ReadValue", emptyOptions());
+    }
+
+    // Returns the "(a{sv})" parameters of a ReadValue call with no options
+    static GVariant *emptyOptions()
+    {
+        GVariantBuilder builder;
+        g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
+        return g_variant_new("(a{sv})", &builder);
+    }
+
+    // Iterates the default main context until `done()` returns true or the timeout expires
+    //
+    // Returns the final result of `done()`
+    static bool waitFor(std::function<bool()> done, std::chrono::milliseconds timeout = std::chrono::milliseconds(10000))
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                return false;
+            }
+
+            // Don't block, so the deadline is still checked when another thread is the one that will make `done()` true
+            if (!g_main_context_iteration(nullptr, FALSE))
+            {
+                usleep(100);
+            }
+        }
+
+        return true;
+    }
+
+private:
+
+    static GIOStream *newStream(int fd)
+    {
+        GSocket *pSocket = g_socket_new_from_fd(fd, nullptr);
+        GIOStream *pStream = G_IO_STREAM(g_socket_connection_factory_create_connection(pSocket));
+        g_object_unref(pSocket);
+        return pStream;
+    }
+
+    static void onConnected(GObject * /*pSource*/, GAsyncResult *pResult, gpointer pUserData)
+    {
+        GError *pError = nullptr;
+        *static_cast<GDBusConnection **>(pUserData) = g_dbus_connection_new_finish(pResult, &pError);
+        if (nullptr != pError)
+        {
+            g_error_free(pError);
+        }
+    }
+
+    static void onReply(GObject *pSource, GAsyncResult *pResult, gpointer pUserData)
+    {
+        std::shared_ptr<Reply> *pReply = static_cast<std::shared_ptr<Reply> *>(pUserData);
+        GError *pError = nullptr;
+
+        (*pReply)->pValue = g_dbus_connection_call_finish(reinterpret_cast<GDBusConnection *>(pSource), pResult, &pError);
+        if (nullptr != pError)
+        {
+            gchar *pName = g_dbus_error_get_remote_error(pError);
+            (*pReply)->error = nullptr != pName ? pName : pError->message;
+            g_free(pName);
+            g_error_free(pError);
+        }
+        (*pReply)->done = true;
+
+        delete pReply;
+    }
+
+    static void onMethodCall(GDBusConnection *pConnection, const gchar * /*pSender*/, const gchar *pObjectPath,
+        const gchar *pInterfaceName, const gchar *pMethodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation,
+        gpointer pUserData)
+    {
+        if (!TheServer->callMethod(DBusObjectPath(pObjectPath), pInterfaceName, pMethodName, pConnection, pParameters, pInvocation,
+            pUserData))
+        {
+            g_dbus_method_invocation_return_dbus_error(pInvocation, "org.freedesktop.DBus.Error.UnknownMethod", pMethodName);
+        }
+    }
+
+    // Registers the server's objects the way `registerObjects()` does in Init.cpp
+    void registerObjects()
+    {
+        for (const DBusObject &object : TheServer->getObjects())
+        {
+            std::string xml = object.generateIntrospectionXML();
+            GDBusNodeInfo *pNode = g_dbus_node_info_new_for_xml(xml.c_str(), nullptr);
+            if (nullptr == pNode)
+            {
+                registrationFailed = true;
+                return;
+            }
+
+            registerNode(pNode, DBusObjectPath(pNode->path));
+            g_dbus_node_info_unref(pNode);
+        }
+    }
+
+    void registerNode(GDBusNodeInfo *pNode, const DBusObjectPath &path)
+    {
+        static GDBusInterfaceVTable vtable = { onMethodCall, nullptr, nullptr, { nullptr } };
+
+        for (GDBusInterfaceInfo **ppInterface = pNode->interfaces; nullptr != *ppInterface; ++ppInterface)
+        {
+            guint id = g_dbus_connection_register_object(pServer, path.c_str(), *ppInterface, &vtable, nullptr, nullptr, nullptr);
+            if (0 == id)
+            {
+                registrationFailed = true;
+                continue;
+            }
+            registeredObjectIds.push_back(id);
+        }
+
+        for (GDBusNodeInfo **ppChild = pNode->nodes; nullptr != *ppChild; ++ppChild)
+        {
+            registerNode(*ppChild, path + (*ppChild)->path);
+        }
+    }
+
+    GDBusConnection *pServer = nullptr;
+    GDBusConnection *pClient = nullptr;
+    std::vector<guint> registeredObjectIds;
+    bool registrationFailed = false;
+};
+
+}; // namespace ggk
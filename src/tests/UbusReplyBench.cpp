@@ -0,0 +1,344 @@
+/*
+ * ubus reply decoding benchmark
+ *
+ * Builds replies with libubox the way rpcd sends them for 'uci get' (an option, a list, a section and a whole package) and
+ * times the two ways NtcUci.cpp has decoded them:
+ *
+ *     json    - the reply is formatted with blobmsg_format_json(), parsed into a Json::Value with a new CharReader (as
+ *               parseJsonStr() does) and the fields are read from the Json::Value. This is what _ubus_invoke_cb and its
+ *               callers did before the replies were decoded in place.
+ *     blobmsg - the fields are found in the reply with single-entry blobmsg_policy lookups and read directly, as the
+ *               decoders of _get() and _getPackage() do with replyField(), tableField() and blobmsgStrings().
+ *
+ * Those helpers are local to NtcUci.cpp, so both paths are written out here, step for step. Both must decode every reply to
+ * the same strings (in any order), or the benchmark fails.
+ *
+ * Usage: UbusReplyBench [replies] [sections per package]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libubox/blobmsg_json.h>
+#include <libubox/blob.h>
+#include <libubox/blobmsg.h>
+}
+
+#include "json/json.h"
+
+#define DEFAULT_REPLIES 10000
+#define DEFAULT_SECTIONS 8
+
+namespace {
+
+/* what a reply is decoded to: _get() joins values, _getPackage() keeps "section" and "section.option" entries */
+typedef std::vector<std::string> decoded_t;
+
+typedef std::function<void(struct blob_attr *msg, decoded_t &out)> decoder_t;
+
+struct reply_kind_t {
+    const char *name;
+    std::function<void(struct blob_buf *b, int i)> fill;
+    decoder_t json;
+    decoder_t blobmsg;
+};
+
+/* the json path: format, parse, then read the Json::Value */
+bool formatAndParse(const Json::CharReaderBuilder &builder, struct blob_attr *msg, Json::Value &jRoot)
+{
+    char *str = blobmsg_format_json(msg, true);
+    if (!str) {
+        return false;
+    }
+    std::string parsedStr = str;
+    free(str);
+
+    JSONCPP_STRING err;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    jRoot.clear();
+    return reader->parse(parsedStr.data(), parsedStr.data() + parsedStr.size(), &jRoot, &err);
+}
+
+/* the blobmsg path: replyField() / tableField() */
+struct blob_attr *blobmsgField(void *data, unsigned int len, const char *name, enum blobmsg_type type)
+{
+    const struct blobmsg_policy policy = { name, type };
+    struct blob_attr *tb = nullptr;
+
+    if (blobmsg_parse(&policy, 1, &tb, data, len) != 0) {
+        return nullptr;
+    }
+    return tb;
+}
+
+struct blob_attr *replyField(struct blob_attr *msg, const char *name, enum blobmsg_type type)
+{
+    return blobmsgField(blob_data(msg), blob_len(msg), name, type);
+}
+
+struct blob_attr *tableField(struct blob_attr *table, const char *name, enum blobmsg_type type)
+{
+    return table ? blobmsgField(blobmsg_data(table), blobmsg_data_len(table), name, type) : nullptr;
+}
+
+/* blobmsgStrings() */
+void blobmsgStrings(struct blob_attr *attr, decoded_t &output)
+{
+    struct blob_attr *cur;
+    size_t rem;
+
+    if (blobmsg_type(attr) == BLOBMSG_TYPE_STRING) {
+        output.push_back(blobmsg_get_string(attr));
+        return;
+    }
+    if (blobmsg_type(attr) != BLOBMSG_TYPE_ARRAY) {
+        return;
+    }
+    blobmsg_for_each_attr(cur, attr, rem) {
+        if (blobmsg_type(cur) == BLOBMSG_TYPE_STRING)
+            output.push_back(blobmsg_get_string(cur));
+    }
+}
+
+Json::CharReaderBuilder jsonReaderBuilder;
+int sectionsPerPackage = DEFAULT_SECTIONS;
+
+/* {"value": "OptionValue"} or {"value": ["ListValue1", ...]}: _get() of an option */
+void jsonOption(struct blob_attr *msg, decoded_t &out)
+{
+    Json::Value jRoot;
+    if (!formatAndParse(jsonReaderBuilder, msg, jRoot) || !jRoot.isMember("value")) {
+        return;
+    }
+    if (jRoot["value"].isArray()) {
+        for (auto &elem : jRoot["value"]) {
+            out.push_back(elem.asString());
+        }
+    } else if (jRoot["value"].isString()) {
+        out.push_back(jRoot["value"].asString());
+    }
+}
+
+void blobmsgOption(struct blob_attr *msg, decoded_t &out)
+{
+    struct blob_attr *attr = replyField(msg, "value", BLOBMSG_TYPE_UNSPEC);
+    if (attr) {
+        blobmsgStrings(attr, out);
+    }
+}
+
+/* {"values": {".type": "SectionType", ...}}: _get() of a section */
+void jsonSection(struct blob_attr *msg, decoded_t &out)
+{
+    Json::Value jRoot;
+    if (!formatAndParse(jsonReaderBuilder, msg, jRoot) || !jRoot.isMember("values") || !jRoot["values"].isObject()
+        || !jRoot["values"].isMember(".type")) {
+        return;
+    }
+    out.push_back(jRoot["values"][".type"].asString());
+}
+
+void blobmsgSection(struct blob_attr *msg, decoded_t &out)
+{
+    struct blob_attr *attr = tableField(replyField(msg, "values", BLOBMSG_TYPE_TABLE), ".type", BLOBMSG_TYPE_STRING);
+    if (attr) {
+        out.push_back(blobmsg_get_string(attr));
+    }
+}
+
+/* {"values": {"SectionName": {".type": "SectionType", ".index": 0, "OptionName": "OptionValue", ...}}}: _getPackage() */
+void jsonPackage(struct blob_attr *msg, decoded_t &out)
+{
+    Json::Value jRoot;
+    if (!formatAndParse(jsonReaderBuilder, msg, jRoot) || !jRoot.isMember("values") || !jRoot["values"].isObject()) {
+        return;
+    }
+
+    const Json::Value &jValues = jRoot["values"];
+    for (auto secIt = jValues.begin(); secIt != jValues.end(); ++secIt) {
+        const std::string secName = secIt.name();
+        if (!secIt->isObject() || !(*secIt)[".type"].isString()) {
+            continue;
+        }
+        out.push_back(secName + "=" + (*secIt)[".type"].asString());
+
+        for (auto optIt = secIt->begin(); optIt != secIt->end(); ++optIt) {
+            const std::string optName = optIt.name();
+            if (optName.empty() || optName[0] == '.') {
+                continue;
+            }
+            if (optIt->isArray()) {
+                for (auto &elem : *optIt) {
+                    if (elem.isString())
+                        out.push_back(secName + "." + optName + "=" + elem.asString());
+                }
+            } else if (optIt->isString()) {
+                out.push_back(secName + "." + optName + "=" + optIt->asString());
+            }
+        }
+    }
+}
+
+void blobmsgPackage(struct blob_attr *msg, decoded_t &out)
+{
+    struct blob_attr *values = replyField(msg, "values", BLOBMSG_TYPE_TABLE);
+    struct blob_attr *sec, *opt;
+    size_t secRem, optRem;
+
+    if (!values) {
+        return;
+    }
+
+    blobmsg_for_each_attr(sec, values, secRem) {
+        if (blobmsg_type(sec) != BLOBMSG_TYPE_TABLE) {
+            continue;
+        }
+        struct blob_attr *typeAttr = tableField(sec, ".type", BLOBMSG_TYPE_STRING);
+        if (!typeAttr) {
+            continue;
+        }
+
+        const std::string secName = blobmsg_name(sec);
+        out.push_back(secName + "=" + blobmsg_get_string(typeAttr));
+
+        blobmsg_for_each_attr(opt, sec, optRem) {
+            const char *optName = blobmsg_name(opt);
+            if (optName[0] == '\0' || optName[0] == '.') {
+                continue;
+            }
+            decoded_t values;
+            blobmsgStrings(opt, values);
+            for (auto &value : values) {
+                out.push_back(secName + "." + optName + "=" + value);
+            }
+        }
+    }
+}
+
+/* a section of the reply to 'uci get' of a package, or of a section */
+void addSection(struct blob_buf *b, const char *name, int index)
+{
+    std::string secName = "cfg" + std::to_string(index) + "0a1b2c";
+
+    blobmsg_add_u8(b, ".anonymous", 1);
+    blobmsg_add_string(b, ".type", name);
+    blobmsg_add_string(b, ".name", secName.c_str());
+    blobmsg_add_u32(b, ".index", index);
+    blobmsg_add_string(b, "enabled", "1");
+    blobmsg_add_string(b, "name", ("Gatt Server " + std::to_string(index)).c_str());
+    blobmsg_add_string(b, "timeout", "3000");
+    void *list = blobmsg_open_array(b, "uuid");
+    blobmsg_add_string(b, nullptr, "0000180a-0000-1000-8000-00805f9b34fb");
+    blobmsg_add_string(b, nullptr, "0000180f-0000-1000-8000-00805f9b34fb");
+    blobmsg_close_array(b, list);
+}
+
+const reply_kind_t replyKinds[] = {
+    { "option", [](struct blob_buf *b, int i) {
+        blobmsg_add_string(b, "value", ("Device name " + std::to_string(i)).c_str());
+    }, jsonOption, blobmsgOption },
+
+    { "list", [](struct blob_buf *b, int i) {
+        void *list = blobmsg_open_array(b, "value");
+        for (int j = 0; j < 4; j++) {
+            blobmsg_add_string(b, nullptr, ("192.168." + std::to_string(i % 256) + "." + std::to_string(j)).c_str());
+        }
+        blobmsg_close_array(b, list);
+    }, jsonOption, blobmsgOption },
+
+    { "section", [](struct blob_buf *b, int i) {
+        void *values = blobmsg_open_table(b, "values");
+        addSection(b, "gattserver", i % 16);
+        blobmsg_close_table(b, values);
+    }, jsonSection, blobmsgSection },
+
+    { "package", [](struct blob_buf *b, int i) {
+        void *values = blobmsg_open_table(b, "values");
+        for (int s = 0; s < sectionsPerPackage; s++) {
+            std::string secName = "cfg" + std::to_string(s) + "0a1b2c";
+            void *sec = blobmsg_open_table(b, secName.c_str());
+            addSection(b, s % 2 ? "service" : "gattserver", s);
+            blobmsg_close_table(b, sec);
+        }
+        (void) i;
+        blobmsg_close_table(b, values);
+    }, jsonPackage, blobmsgPackage },
+};
+
+/* decode every reply and return the time per reply, in nanoseconds */
+double timeDecoder(const std::vector<struct blob_buf> &replies, const decoder_t &decoder, std::vector<decoded_t> &decoded)
+{
+    decoded.assign(replies.size(), decoded_t());
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < replies.size(); i++) {
+        decoder(replies[i].head, decoded[i]);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / replies.size();
+}
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+    int replyCount = argc > 1 ? atoi(argv[1]) : DEFAULT_REPLIES;
+    sectionsPerPackage = argc > 2 ? atoi(argv[2]) : DEFAULT_SECTIONS;
+    int kindCount = sizeof(replyKinds) / sizeof(replyKinds[0]);
+    int mismatches = 0;
+
+    if (replyCount < kindCount || sectionsPerPackage < 1) {
+        fprintf(stderr, "Usage: %s [replies] [sections per package]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d replies (%d of each kind), %d sections per package\n", replyCount, replyCount / kindCount, sectionsPerPackage);
+    printf("  %-8s %8s %14s %14s %8s\n", "kind", "bytes", "json ns", "blobmsg ns", "speedup");
+
+    for (const reply_kind_t &kind : replyKinds) {
+        std::vector<struct blob_buf> replies(replyCount / kindCount);
+        std::vector<decoded_t> jsonDecoded, blobmsgDecoded;
+
+        for (size_t i = 0; i < replies.size(); i++) {
+            replies[i] = {};
+            blob_buf_init(&replies[i], 0);
+            kind.fill(&replies[i], static_cast<int>(i));
+        }
+
+        /* warm up, then time each path */
+        timeDecoder(replies, kind.json, jsonDecoded);
+        timeDecoder(replies, kind.blobmsg, blobmsgDecoded);
+        double jsonNS = timeDecoder(replies, kind.json, jsonDecoded);
+        double blobmsgNS = timeDecoder(replies, kind.blobmsg, blobmsgDecoded);
+
+        /* a Json::Value keeps object members sorted by name, so sections may come out in another order */
+        for (size_t i = 0; i < replies.size(); i++) {
+            std::sort(jsonDecoded[i].begin(), jsonDecoded[i].end());
+            std::sort(blobmsgDecoded[i].begin(), blobmsgDecoded[i].end());
+            if (jsonDecoded[i].empty() || jsonDecoded[i] != blobmsgDecoded[i]) {
+                mismatches++;
+            }
+        }
+
+        printf("  %-8s %8u %14.0f %14.0f %7.1fx\n", kind.name, blob_pad_len(replies[0].head), jsonNS, blobmsgNS,
+            jsonNS / blobmsgNS);
+
+        for (auto &b : replies) {
+            blob_buf_free(&b);
+        }
+    }
+
+    if (mismatches) {
+        printf("%d replies decoded differently\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
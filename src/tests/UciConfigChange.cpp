@@ -0,0 +1,202 @@
+/*
+ * 'config.change' event decoding test
+ *
+ * Stands in for ubusd: builds event messages with libubox the way ubusd delivers them to an event handler, in each format a
+ * commit is reported in, and checks which package Context::configChangePackage() finds in them and which packages a
+ * PackageCache then drops. Also checks that a cached package is dropped when its file is changed without an event, as
+ * 'uci commit' on the command line does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <functional>
+#include <string>
+
+#include "../NtcUci.h"
+
+using uci::Context;
+using uci::PackageCache;
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const std::string &what)
+{
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+/* build an event message with fill() and return the package found in it */
+std::string decode(const std::function<void(struct blob_buf *)> &fill)
+{
+    struct blob_buf b = {};
+    std::string pkg;
+
+    blob_buf_init(&b, 0);
+    fill(&b);
+    pkg = Context::configChangePackage(b.head);
+    blob_buf_free(&b);
+
+    return pkg;
+}
+
+void testFormats()
+{
+    /* rpcd: the data of its procd 'service event' */
+    check(decode([](struct blob_buf *b) {
+        blobmsg_add_string(b, "package", "gattserver");
+    }) == "gattserver", "{\"package\": ...}");
+
+    /* a forwarded procd 'service event' message */
+    check(decode([](struct blob_buf *b) {
+        blobmsg_add_string(b, "type", "config.change");
+        void *data = blobmsg_open_table(b, "data");
+        blobmsg_add_string(b, "package", "network");
+        blobmsg_close_table(b, data);
+    }) == "network", "{\"type\": \"config.change\", \"data\": {\"package\": ...}}");
+
+    /* older senders */
+    check(decode([](struct blob_buf *b) {
+        blobmsg_add_string(b, "config", "wireless");
+    }) == "wireless", "{\"config\": ...}");
+
+    /* "package" wins over "config" */
+    check(decode([](struct blob_buf *b) {
+        blobmsg_add_string(b, "config", "wireless");
+        blobmsg_add_string(b, "package", "system");
+    }) == "system", "{\"config\": ..., \"package\": ...}");
+
+    /* nothing usable: every package is treated as changed */
+    check(decode([](struct blob_buf *b) {
+        (void) b;
+    }) == "", "{}");
+    check(decode([](struct blob_buf *b) {
+        blobmsg_add_u32(b, "package", 5);
+    }) == "", "{\"package\": 5}");
+    check(decode([](struct blob_buf *b) {
+        blobmsg_add_string(b, "data", "network");
+    }) == "", "{\"data\": \"network\"}");
+    check(decode([](struct blob_buf *b) {
+        void *data = blobmsg_open_table(b, "data");
+        blobmsg_add_u32(b, "package", 1);
+        blobmsg_close_table(b, data);
+    }) == "", "{\"data\": {\"package\": 1}}");
+    check(Context::configChangePackage(nullptr) == "", "no message");
+}
+
+void writeFile(const std::string &path, const char *contents)
+{
+    /* like 'uci commit': write a temporary file and rename it over the package file */
+    std::string tmp = path + ".tmp";
+    FILE *file = fopen(tmp.c_str(), "w");
+    if (file) {
+        fputs(contents, file);
+        fclose(file);
+    }
+    rename(tmp.c_str(), path.c_str());
+}
+
+/* what the listener does with an event: drop the package it names from the cache */
+void testInvalidation(const std::string &dir)
+{
+    PackageCache cache(dir);
+    PackageCache::Entry entry;
+
+    auto fill = [&cache, &dir]() {
+        for (const char *pkg : {"gattserver", "network"}) {
+            PackageCache::Package package;
+            writeFile(dir + "/" + pkg, "config config\n");
+            cache.stamp(pkg, package);
+            package.entries["config"] = PackageCache::Entry{false, {"gattserver"}};
+            package.entries["config.adv_name"] = PackageCache::Entry{false, {"ntc"}};
+            cache.store(pkg, std::move(package), cache.getGeneration());
+        }
+    };
+
+    cache.setEnabled(true);
+    fill();
+    check(cache.lookup("gattserver", "config", "adv_name", entry) == PackageCache::LookupResult::FOUND, "cached before event");
+
+    cache.invalidate(decode([](struct blob_buf *b) {
+        blobmsg_add_string(b, "package", "gattserver");
+    }));
+    check(cache.lookup("gattserver", "config", "adv_name", entry) == PackageCache::LookupResult::NOT_CACHED,
+          "named package dropped");
+    check(cache.lookup("network", "config", "adv_name", entry) == PackageCache::LookupResult::FOUND, "other package kept");
+
+    cache.invalidate(decode([](struct blob_buf *b) {
+        (void) b;
+    }));
+    check(cache.lookup("network", "config", "adv_name", entry) == PackageCache::LookupResult::NOT_CACHED,
+          "unnamed event drops every package");
+}
+
+/* a package is cached only as long as its file is unchanged and it is younger than the maximum age */
+void testStaleness(const std::string &dir)
+{
+    std::string path = dir + "/gattserver";
+    PackageCache cache(dir);
+    PackageCache expired(dir, std::chrono::seconds(0));
+    PackageCache::Entry entry;
+
+    auto fill = [](PackageCache &c) {
+        PackageCache::Package package;
+        if (!c.stamp("gattserver", package)) {
+            return false;
+        }
+        package.entries["config.adv_name"] = PackageCache::Entry{false, {"ntc"}};
+        c.store("gattserver", std::move(package), c.getGeneration());
+        return true;
+    };
+
+    cache.setEnabled(true);
+    expired.setEnabled(true);
+    unlink(path.c_str());
+    check(!fill(cache), "no package file, not stamped");
+
+    writeFile(path, "config config\n\toption adv_name 'ntc'\n");
+    check(fill(cache), "package file stamped");
+    check(cache.lookup("gattserver", "config", "adv_name", entry) == PackageCache::LookupResult::FOUND, "unchanged file");
+
+    writeFile(path, "config config\n\toption adv_name 'ntc'\n");
+    check(cache.lookup("gattserver", "config", "adv_name", entry) == PackageCache::LookupResult::NOT_CACHED,
+          "file replaced without an event");
+
+    check(fill(cache), "package file stamped again");
+    unlink(path.c_str());
+    check(cache.lookup("gattserver", "config", "adv_name", entry) == PackageCache::LookupResult::NOT_CACHED, "file removed");
+
+    writeFile(path, "config config\n");
+    check(fill(expired), "package file stamped with no maximum age");
+    check(expired.lookup("gattserver", "config", "adv_name", entry) == PackageCache::LookupResult::NOT_CACHED,
+          "older than the maximum age");
+
+    unlink(path.c_str());
+}
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/UciConfigChange.XXXXXX";
+    const char *dir = mkdtemp(dirTemplate);
+    if (!dir) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    testFormats();
+    testInvalidation(dir);
+    testStaleness(dir);
+
+    for (const char *pkg : {"gattserver", "network"}) {
+        unlink((std::string(dir) + "/" + pkg).c_str());
+    }
+    rmdir(dir);
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * UCI 'config.change' listener test
+ *
+ * Subscribes to options of two packages against a fake ubusd (see FakeUbus.h) which answers 'uci get' from its own table of
+ * option values, then changes values and sends 'config.change' events through the listener's connection. Checks that the
+ * listener thread re-reads only the subscriptions of the package named in an event, that a subscriber is called only when its
+ * value actually changed, that an event without a package re-reads every subscription, and that after ubusd hangs up the
+ * listener reconnects and re-reads every subscription (changes may have been missed while it was away).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "FakeUbus.h"
+
+using uci::Context;
+using uci::UciHandle;
+using uci::UciOptNameType;
+
+#define TIMEOUT std::chrono::seconds(10)
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const std::string &what)
+{
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+/* wait until done() returns true, or the timeout expires */
+bool waitFor(const std::function<bool()> &done)
+{
+    auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/* the fake ubusd's UCI options: "package.section.option" = value */
+std::mutex uciMutex;
+std::map<std::string, std::string> uciValues;
+
+void setValue(const std::string &name, const std::string &value)
+{
+    std::lock_guard<std::mutex> guard(uciMutex);
+    uciValues[name] = value;
+}
+
+/* 'uci get' of an option: {"value": "OptionValue"} */
+int answerUci(const fakeubus::Call &call, struct blob_buf *reply)
+{
+    if (call.method != "get") {
+        return UBUS_STATUS_OK;
+    }
+
+    std::lock_guard<std::mutex> guard(uciMutex);
+    auto it = uciValues.find(call.field("config") + "." + call.field("section") + "." + call.field("option"));
+    if (call.field("option").empty() || it == uciValues.end()) {
+        return UBUS_STATUS_NOT_FOUND;
+    }
+    blobmsg_add_string(reply, "value", it->second.c_str());
+    return UBUS_STATUS_OK;
+}
+
+/* the number of 'uci get' calls made so far for a package */
+int gets(const std::string &pkg)
+{
+    int count = 0;
+
+    for (auto &call : fakeubus::calls("uci")) {
+        if (call.method == "get" && call.field("config") == pkg)
+            count++;
+    }
+    return count;
+}
+
+void sendChange(const std::string &pkg)
+{
+    check(fakeubus::sendEvent([&pkg](struct blob_buf *b) {
+        if (!pkg.empty())
+            blobmsg_add_string(b, "package", pkg.c_str());
+    }), "event for '" + pkg + "' sent");
+}
+
+std::atomic<int> networkCalls(0);
+std::atomic<int> wirelessCalls(0);
+
+void testEvents()
+{
+    UciHandle uci;
+
+    setValue("network.wan.proto", "dhcp");
+    setValue("wireless.radio0.channel", "11");
+    fakeubus::setHandler(answerUci);
+
+    uci.subscribe(UciOptNameType("network", "wan", "proto"), [] { networkCalls++; });
+    uci.subscribe(UciOptNameType("wireless", "radio0", "channel"), [] { wirelessCalls++; });
+    check(fakeubus::eventHandlerRegistered(), "listener started by subscribe()");
+
+    /* only the named package is re-read, and its subscriber called */
+    fakeubus::clearCalls();
+    setValue("network.wan.proto", "static");
+    sendChange("network");
+    check(waitFor([] { return networkCalls == 1; }), "network subscriber called on a change of network");
+    check(gets("wireless") == 0, "wireless not re-read on a change of network");
+    check(wirelessCalls == 0, "wireless subscriber not called on a change of network");
+
+    /* an event without a change calls no one; events are handled in order, so the next one shows it has been handled */
+    fakeubus::clearCalls();
+    sendChange("network");
+    setValue("wireless.radio0.channel", "6");
+    sendChange("wireless");
+    check(waitFor([] { return wirelessCalls == 1; }), "wireless subscriber called on a change of wireless");
+    check(gets("network") > 0, "network re-read on its event");
+    check(networkCalls == 1, "network subscriber not called when its value is unchanged");
+
+    /* an event without a package re-reads every subscription */
+    fakeubus::clearCalls();
+    setValue("network.wan.proto", "pppoe");
+    setValue("wireless.radio0.channel", "1");
+    sendChange("");
+    check(waitFor([] { return networkCalls == 2 && wirelessCalls == 2; }), "every subscriber called on an event without a package");
+}
+
+void testReconnect()
+{
+    int connects = fakeubus::connects();
+
+    /* a change which raises no event is picked up once the listener has reconnected */
+    setValue("wireless.radio0.channel", "36");
+    fakeubus::dropEventConnection();
+    check(waitFor([connects] { return fakeubus::connects() > connects && fakeubus::eventHandlerRegistered(); }),
+        "listener reconnected after ubusd hung up");
+    check(waitFor([] { return wirelessCalls == 3; }), "subscriptions re-read after reconnecting");
+    check(networkCalls == 2, "unchanged subscriber not called after reconnecting");
+
+    /* events are handled on the new connection */
+    setValue("network.wan.proto", "dhcp");
+    sendChange("network");
+    check(waitFor([] { return networkCalls == 3; }), "network subscriber called on an event after reconnecting");
+}
+} // unnamed namespace
+
+int main()
+{
+    testEvents();
+    testReconnect();
+
+    Context::getInstance().stopConfigListener();
+    check(!fakeubus::eventHandlerRegistered(), "listener disconnected when stopped");
+
+    printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
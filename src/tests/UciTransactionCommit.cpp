@@ -0,0 +1,201 @@
+/*
+ * UciTransaction::commit() test
+ *
+ * Commits transactions against a fake ubusd (see FakeUbus.h) and checks the 'uci' calls they make: the changes are sent in
+ * order, options set in a section one after the other are sent with a single 'uci set' (but not across an added or deleted
+ * section or option), and a failed 'set' or 'commit' is followed by a 'uci revert' of the package, leaving the transaction
+ * to be retried.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FakeUbus.h"
+
+using uci::UciTransaction;
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const std::string &what)
+{
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+/* a blobmsg field as text: "value", "[v1,v2]" or "{name=value,...}", without the session id */
+std::string format(struct blob_attr *attr, bool inTable)
+{
+    struct blob_attr *cur;
+    size_t rem;
+    std::string text;
+
+    if (inTable) {
+        text = std::string(blobmsg_name(attr)) + "=";
+    }
+
+    switch (blobmsg_type(attr)) {
+        case BLOBMSG_TYPE_STRING:
+            return text + blobmsg_get_string(attr);
+
+        case BLOBMSG_TYPE_ARRAY:
+        case BLOBMSG_TYPE_TABLE:
+            text += blobmsg_type(attr) == BLOBMSG_TYPE_ARRAY ? "[" : "{";
+            blobmsg_for_each_attr(cur, attr, rem) {
+                if (blobmsg_type(attr) == BLOBMSG_TYPE_TABLE && std::string(blobmsg_name(cur)) == "ubus_rpc_session") {
+                    continue;
+                }
+                if (text.back() != '[' && text.back() != '{') {
+                    text += ",";
+                }
+                text += format(cur, blobmsg_type(attr) == BLOBMSG_TYPE_TABLE);
+            }
+            return text + (blobmsg_type(attr) == BLOBMSG_TYPE_ARRAY ? "]" : "}");
+
+        default:
+            return text + "?";
+    }
+}
+
+/* the 'uci' calls made so far, as "method {field=value,...}" */
+std::vector<std::string> uciCalls()
+{
+    std::vector<std::string> result;
+
+    for (auto &call : fakeubus::calls("uci")) {
+        struct blob_attr *cur;
+        size_t rem;
+        std::string text = call.method + " {";
+
+        blob_for_each_attr(cur, call.attr(), rem) {
+            if (std::string(blobmsg_name(cur)) == "ubus_rpc_session") {
+                continue;
+            }
+            if (text.back() != '{') {
+                text += ",";
+            }
+            text += format(cur, true);
+        }
+        result.push_back(text + "}");
+        check(call.field("ubus_rpc_session") == FAKEUBUS_SESSION_ID, call.method + " sent with the session id");
+    }
+    return result;
+}
+
+void checkCalls(const std::vector<std::string> &expected, const std::string &what)
+{
+    std::vector<std::string> actual = uciCalls();
+
+    check(actual == expected, what);
+    if (actual != expected) {
+        for (auto &call : actual) {
+            fprintf(stderr, "    %s\n", call.c_str());
+        }
+    }
+}
+
+/* answer every 'uci' call with OK, except the failNth call of method */
+void failCall(const std::string &method, int failNth)
+{
+    auto count = std::make_shared<int>(0); // the handler is copied for each call
+
+    fakeubus::setHandler([method, failNth, count](const fakeubus::Call &call, struct blob_buf *reply) {
+        (void) reply;
+        if (call.method == method && ++*count == failNth) {
+            return (int) UBUS_STATUS_PERMISSION_DENIED;
+        }
+        return (int) UBUS_STATUS_OK;
+    });
+}
+
+/* options set one after the other are merged per section, until a section or option is added or deleted */
+UciTransaction mixedTransaction()
+{
+    UciTransaction trans("gattserver");
+
+    trans.set("s1", "a", "1").set("s1", "b", std::vector<std::string>{"x", "y"}).set("s2", "c", "3").set("s1", "d", "4")
+        .addSection("service", "s3")
+        .set("s1", "e", "5").deleteElem("s2", "c").set("s2", "f", "6")
+        .deleteElem("s3").addSection("service");
+    return trans;
+}
+
+const std::vector<std::string> mixedCalls = {
+    "set {config=gattserver,section=s1,values={a=1,b=[x,y],d=4}}",
+    "set {config=gattserver,section=s2,values={c=3}}",
+    "add {config=gattserver,type=service,name=s3}",
+    "set {config=gattserver,section=s1,values={e=5}}",
+    "delete {config=gattserver,section=s2,option=c}",
+    "set {config=gattserver,section=s2,values={f=6}}",
+    "delete {config=gattserver,section=s3}",
+    "add {config=gattserver,type=service}",
+};
+
+void testApply()
+{
+    UciTransaction trans = mixedTransaction();
+    std::vector<std::string> expected = mixedCalls;
+
+    failCall("", 0);
+    fakeubus::clearCalls();
+    check(trans.commit(), "transaction committed");
+    check(trans.empty(), "committed transaction emptied");
+
+    expected.push_back("commit {config=gattserver}");
+    checkCalls(expected, "changes sent in order, then committed");
+
+    fakeubus::clearCalls();
+    check(UciTransaction("gattserver").commit(), "empty transaction committed");
+    checkCalls({}, "nothing sent for an empty transaction");
+}
+
+void testSetFails()
+{
+    UciTransaction trans = mixedTransaction();
+
+    failCall("set", 2);
+    fakeubus::clearCalls();
+    check(!trans.commit(), "transaction with a failed set not committed");
+    check(!trans.empty(), "failed transaction kept");
+    checkCalls({mixedCalls[0], mixedCalls[1], "revert {config=gattserver}"}, "failed set reverted, not committed");
+
+    /* the kept changes are sent again */
+    std::vector<std::string> expected = mixedCalls;
+    expected.push_back("commit {config=gattserver}");
+
+    failCall("", 0);
+    fakeubus::clearCalls();
+    check(trans.commit(), "retried transaction committed");
+    checkCalls(expected, "retried changes sent in order, then committed");
+}
+
+void testCommitFails()
+{
+    UciTransaction trans = mixedTransaction();
+    std::vector<std::string> expected = mixedCalls;
+    expected.push_back("commit {config=gattserver}");
+    expected.push_back("revert {config=gattserver}");
+
+    failCall("commit", 1);
+    fakeubus::clearCalls();
+    check(!trans.commit(), "transaction with a failed commit not committed");
+    check(!trans.empty(), "failed transaction kept");
+    checkCalls(expected, "failed commit reverted");
+}
+} // unnamed namespace
+
+int main()
+{
+    testApply();
+    testSetFails();
+    testCommitFails();
+
+    printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
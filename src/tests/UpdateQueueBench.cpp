@@ -0,0 +1,188 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Producer/consumer micro-benchmark for the update queue, including the cost of waking the server thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// A number of producer threads push entries while a single consumer drains them, the same way services push updates while the
+// server thread processes them. Entries go onto a mutex-protected deque, as in the update queue. Two ways of waking the consumer
+// are measured:
+//
+//     gated     - Only the push that finds no wake pending writes to the eventfd (see `wakeUpdateQueue()`); the consumer blocks
+//                 reading the eventfd, clears the pending flag and then drains everything it can
+//     ungated   - Every push writes to the eventfd, under a mutex
+//
+// The queue only ever sees the pointers it is given, so the benchmark hands it addresses of plain cells rather than real
+// characteristics.
+//
+// Usage: UpdateQueueBench [producers] [pushes per producer]
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ggk { struct GattCharacteristic; };
+
+using namespace ggk;
+
+static const size_t kCells = 256;
+static const int kDefaultProducers = 4;
+static const long kDefaultPushes = 1000000;
+
+// Stand-ins for characteristics; only their addresses are used
+static char cells[kCells];
+
+static const GattCharacteristic *cellFor(long i)
+{
+    return reinterpret_cast<const GattCharacteristic *>(&cells[i % kCells]);
+}
+
+// The consumer's wakeup: an eventfd and the flag that says a write to it is already pending
+struct Waker
+{
+    int fd = eventfd(0, EFD_CLOEXEC);
+    std::atomic<bool> pending{false};
+    std::mutex mutex;
+
+    ~Waker() { close(fd); }
+
+    // Wakes the consumer unless a wake is already pending
+    void wake()
+    {
+        if (!pending.exchange(true))
+        {
+            signal();
+        }
+    }
+
+    // Wakes the consumer on every call, under a mutex
+    void wakeUngated()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        signal();
+    }
+
+    void signal()
+    {
+        uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) < 0) { perror("write"); }
+    }
+
+    // Blocks until woken, then clears the pending flag so the next push wakes us again
+    void wait()
+    {
+        uint64_t counter;
+        if (read(fd, &counter, sizeof(counter)) < 0) { perror("read"); }
+        pending.exchange(false);
+    }
+};
+
+// Runs `producers` threads calling `push` while the calling thread waits on `waker` and calls `pop` until every entry has been
+// consumed
+//
+// Returns the elapsed time in seconds
+template<typename Push, typename Pop>
+static double run(int producers, long pushes, Waker &waker, Push push, Pop pop)
+{
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]()
+        {
+            while (!go) { std::this_thread::yield(); }
+            for (long i = 0; i < pushes; ++i)
+            {
+                push(cellFor(p + i));
+            }
+        });
+    }
+
+    long expected = producers * pushes;
+    long consumed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+
+    while (consumed < expected)
+    {
+        waker.wait();
+        consumed += pop();
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    for (std::thread &thread : threads) { thread.join(); }
+
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+static void report(const char *pName, int producers, long pushes, double seconds)
+{
+    double total = static_cast<double>(producers) * pushes;
+    printf("%-8s %2d producers  %10ld pushes  %8.3f s  %8.1f ns/op  %8.2f Mops/s\n",
+        pName, producers, static_cast<long>(total), seconds, seconds * 1e9 / total, total / seconds / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    int producers = argc > 1 ? atoi(argv[1]) : kDefaultProducers;
+    long pushes = argc > 2 ? atol(argv[2]) : kDefaultPushes;
+    if (producers <= 0 || pushes <= 0)
+    {
+        fprintf(stderr, "Usage: %s [producers] [pushes per producer]\n", argv[0]);
+        return 1;
+    }
+
+    for (bool gated : { true, false })
+    {
+        std::deque<const GattCharacteristic *> queue;
+        std::mutex mutex;
+        Waker waker;
+
+        double seconds = run(producers, pushes, waker,
+            [&](const GattCharacteristic *pCharacteristic)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    queue.push_front(pCharacteristic);
+                }
+                if (gated) { waker.wake(); } else { waker.wakeUngated(); }
+            },
+            [&]()
+            {
+                std::deque<const GattCharacteristic *> batch;
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    batch.swap(queue);
+                }
+                return static_cast<long>(batch.size());
+            });
+
+        report(gated ? "gated" : "ungated", producers, pushes, seconds);
+    }
+
+    return 0;
+}
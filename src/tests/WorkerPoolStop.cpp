@@ -0,0 +1,279 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Stops the worker pool with jobs still queued and checks that every job is either run or cancelled, exactly once
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Async characteristic handlers hand the worker pool a job that owns a method call (see `GattCharacteristic::dispatchAsync()`.)
+// A queued job that is dropped without its cancel path leaks the call and leaves the method call unanswered, so this test fills
+// the pool, stops it part way through and then accounts for every job:
+//
+//     Busy jobs     - One per worker, blocked until the pool has started stopping; each must run to completion
+//     Queued jobs   - Waiting behind the busy jobs when the pool stops; each must be cancelled and never run
+//     Refused jobs  - Submitted while the pool is stopping; each must be refused, and neither run nor cancelled
+//
+// The pool is then used again, to check that it restarts after a stop.
+//
+// The same is then done with real ReadValue calls to an async characteristic over a private D-Bus connection (see TestBus.h),
+// stopping the server the way `runServerThread()` does once its main loop has returned. Every call must be answered with
+// org.bluez.Error.Failed: those still queued by the pool, and those whose handler returned but whose completion never ran on the
+// main loop. The characteristic must then accept calls up to its concurrency limit again.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "../DBusObject.h"
+#include "../GattCharacteristic.h"
+#include "../GattService.h"
+#include "../Logger.h"
+#include "../Server.h"
+#include "../Utils.h"
+#include "../WorkerPool.h"
+#include "TestBus.h"
+
+using namespace ggk;
+
+static const int kQueuedJobs = static_cast<int>(WorkerPool::kMaxQueuedJobs) - 2;
+static const std::chrono::seconds kTimeout(10);
+
+static int failures = 0;
+
+// Swallow everything that gets logged
+static void logSink(const char *) {}
+
+static void check(bool condition, const char *pDescription)
+{
+    if (!condition)
+    {
+        failures += 1;
+        fprintf(stderr, "FAIL: %s\n", pDescription);
+    }
+}
+
+// Stops the pool with plain jobs queued behind busy ones
+static void testPool()
+{
+    WorkerPool &pool = WorkerPool::getInstance();
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    int busyStarted = 0;
+    bool releaseBusy = false;
+
+    std::atomic<int> busyRun(0);
+    std::atomic<int> busyCancelled(0);
+    std::atomic<int> queuedRun(0);
+    std::atomic<int> queuedCancelled(0);
+    std::atomic<int> refusedCalled(0);
+
+    // Occupy every worker
+    for (int i = 0; i < WorkerPool::kWorkerCount; ++i)
+    {
+        bool submitted = pool.submit([&]()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            busyStarted += 1;
+            changed.notify_all();
+            changed.wait(lock, [&] { return releaseBusy; });
+            busyRun += 1;
+        },
+        [&]() { busyCancelled += 1; });
+        check(submitted, "busy job submitted");
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        check(changed.wait_for(lock, kTimeout, [&] { return busyStarted == WorkerPool::kWorkerCount; }), "every worker busy");
+    }
+
+    // Queue more jobs than there are free workers (none)
+    for (int i = 0; i < kQueuedJobs; ++i)
+    {
+        check(pool.submit([&]() { queuedRun += 1; }, [&]() { queuedCancelled += 1; }), "queued job submitted");
+    }
+
+    // Stop on another thread; it cancels the queued jobs and then waits for the busy ones
+    std::future<void> stopped = std::async(std::launch::async, [&]() { pool.stop(); });
+
+    auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    while (queuedCancelled < kQueuedJobs && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(queuedCancelled == kQueuedJobs, "queued jobs cancelled while busy jobs run");
+
+    // The pool is still stopping (the busy jobs haven't returned), so new jobs are refused
+    check(!pool.submit([&]() { refusedCalled += 1; }, [&]() { refusedCalled += 1; }), "job refused while stopping");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        releaseBusy = true;
+    }
+    changed.notify_all();
+
+    check(stopped.wait_for(kTimeout) == std::future_status::ready, "stop returned");
+    stopped.get();
+
+    check(busyRun == WorkerPool::kWorkerCount, "busy jobs ran to completion");
+    check(busyCancelled == 0, "busy jobs not cancelled");
+    check(queuedRun == 0, "queued jobs not run");
+    check(queuedCancelled == kQueuedJobs, "queued jobs cancelled once");
+    check(refusedCalled == 0, "refused job neither run nor cancelled");
+
+    // The pool starts again on the next job
+    std::promise<void> ran;
+    check(pool.submit([&]() { ran.set_value(); }), "job submitted after stop");
+    check(ran.get_future().wait_for(kTimeout) == std::future_status::ready, "job run after stop");
+    pool.stop();
+}
+
+// Gate for the async ReadValue handler below
+static std::mutex gateMutex;
+static std::condition_variable gateChanged;
+static int handlersStarted = 0;
+static bool gateOpen = false;
+
+static const int kCalls = WorkerPool::kWorkerCount + 3;
+
+// The services of this test's server, in place of plugins/mainServicePlugin.cpp
+void Server::registerServicePlugins()
+{
+    objects.back().gattServiceBegin("service", "00000001-1E3C-FAD4-74E2-97A033F1BFAA")
+        .gattCharacteristicBegin("slow", "00000002-1E3C-FAD4-74E2-97A033F1BFAA", {"read"})
+            .asyncConcurrency(kCalls)
+            .onReadValueAsync(CHARACTERISTIC_ASYNC_READ_CALLBACK_LAMBDA
+            {
+                std::unique_lock<std::mutex> lock(gateMutex);
+                handlersStarted += 1;
+                gateChanged.notify_all();
+                gateChanged.wait(lock, [] { return gateOpen; });
+                return Utils::gvariantFromByteArray("slow");
+            }, false)
+        .gattCharacteristicEnd()
+        .gattCharacteristicBegin("fast", "00000003-1E3C-FAD4-74E2-97A033F1BFAA", {"read"})
+            .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+            {
+                self.methodReturnValue(pInvocation, "fast", true);
+            }, false)
+        .gattCharacteristicEnd()
+    .gattServiceEnd();
+}
+
+// Stops the server with async method calls busy, queued and waiting for the main loop
+static void testAsyncCalls()
+{
+    TheServer = std::make_shared<Server>("test", "Test", "Test", nullptr, nullptr);
+    TestBus bus;
+    check(bus.isConnected(), "test bus connected");
+    if (!bus.isConnected())
+    {
+        return;
+    }
+
+    const std::string slowPath = "/com/test/service/slow";
+    std::vector<std::shared_ptr<TestBus::Reply>> replies;
+    for (int i = 0; i < kCalls; ++i)
+    {
+        replies.push_back(bus.callAsync(slowPath, "org.bluez.GattCharacteristic1", "ReadValue", TestBus::emptyOptions()));
+    }
+
+    // Calls are dispatched in order, so once a later call is answered every slow call has been handed to the pool
+    check(bus.readValue("/com/test/service/fast")->pValue != nullptr, "fast call answered");
+    {
+        std::unique_lock<std::mutex> lock(gateMutex);
+        check(gateChanged.wait_for(lock, kTimeout, [] { return handlersStarted == WorkerPool::kWorkerCount; }),
+            "every worker busy with a slow call");
+    }
+
+    // The main loop has "returned": nothing iterates the main context until the server has been stopped. The busy handlers are
+    // let go while the pool is stopping, so they post completions that will never run.
+    std::future<void> stopped = std::async(std::launch::async, [] { WorkerPool::getInstance().stop(); });
+
+    // Once a job is refused the pool is stopping, and has taken the queued calls to cancel them
+    auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    while (WorkerPool::getInstance().submit([] {}) && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    {
+        std::lock_guard<std::mutex> lock(gateMutex);
+        gateOpen = true;
+    }
+    gateChanged.notify_all();
+    check(stopped.wait_for(kTimeout) == std::future_status::ready, "pool stopped");
+    stopped.get();
+    GattCharacteristic::cancelAsyncCalls();
+
+    TestBus::waitFor([&replies]
+    {
+        for (const std::shared_ptr<TestBus::Reply> &reply : replies)
+        {
+            if (!reply->done) { return false; }
+        }
+        return true;
+    });
+
+    int failedCalls = 0;
+    for (const std::shared_ptr<TestBus::Reply> &reply : replies)
+    {
+        failedCalls += reply->done && reply->error == "org.bluez.Error.Failed" ? 1 : 0;
+    }
+    check(failedCalls == kCalls, "every slow call answered with org.bluez.Error.Failed");
+    check(handlersStarted == WorkerPool::kWorkerCount, "queued slow calls never run");
+
+    // Every call was released, so the characteristic takes a full set of calls again
+    replies.clear();
+    for (int i = 0; i < kCalls; ++i)
+    {
+        replies.push_back(bus.callAsync(slowPath, "org.bluez.GattCharacteristic1", "ReadValue", TestBus::emptyOptions()));
+    }
+    TestBus::waitFor([&replies]
+    {
+        for (const std::shared_ptr<TestBus::Reply> &reply : replies)
+        {
+            if (!reply->done) { return false; }
+        }
+        return true;
+    });
+
+    int answeredCalls = 0;
+    for (const std::shared_ptr<TestBus::Reply> &reply : replies)
+    {
+        answeredCalls += reply->done && reply->pValue != nullptr ? 1 : 0;
+    }
+    check(answeredCalls == kCalls, "slow calls accepted up to the limit after the stop");
+
+    WorkerPool::getInstance().stop();
+}
+
+int main()
+{
+    Logger::registerDebugReceiver(logSink);
+    Logger::registerWarnReceiver(logSink);
+
+    testPool();
+    testAsyncCalls();
+    TheServer = nullptr;
+
+    printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}